@@ -0,0 +1,45 @@
+/************************************************************************************************//**
+* @file cmsis_nvic_virtual.h
+*
+* @brief Header file replacing the NVIC functions of CMSIS used by the middleware, it is included by
+*        core_cm4.h when CMSIS_NVIC_VIRTUAL is defined, as the benchmark does.
+*
+* Public Functions:
+*       - void Bench_System_Reset(void)
+*/
+
+#ifndef CMSIS_NVIC_VIRTUAL_H
+#define CMSIS_NVIC_VIRTUAL_H
+
+#include <setjmp.h>
+
+#define NVIC_SetPriorityGrouping    __NVIC_SetPriorityGrouping
+#define NVIC_GetPriorityGrouping    __NVIC_GetPriorityGrouping
+#define NVIC_EnableIRQ              __NVIC_EnableIRQ
+#define NVIC_GetEnableIRQ           __NVIC_GetEnableIRQ
+#define NVIC_DisableIRQ             __NVIC_DisableIRQ
+#define NVIC_GetPendingIRQ          __NVIC_GetPendingIRQ
+#define NVIC_SetPendingIRQ          __NVIC_SetPendingIRQ
+#define NVIC_ClearPendingIRQ        __NVIC_ClearPendingIRQ
+#define NVIC_GetActive              __NVIC_GetActive
+#define NVIC_SetPriority            __NVIC_SetPriority
+#define NVIC_GetPriority            __NVIC_GetPriority
+/** @brief The reset requested by the DFU class ends the benchmark or the input of the fuzz target,
+ *         the rest of the functions are the ones of CMSIS */
+#define NVIC_SystemReset            Bench_System_Reset
+
+/** @brief Where a system reset returns to, the process is terminated while it is NULL */
+extern jmp_buf* bench_reset_jump;
+
+/***************************************************************************************************/
+/*                                       APIs Supported                                            */
+/***************************************************************************************************/
+
+/**
+ * @brief Function for terminating the benchmark when the device requests a system reset, or
+ *        returning to @ref bench_reset_jump if it is set.
+ * @return void
+ */
+__attribute__((noreturn)) void Bench_System_Reset(void);
+
+#endif /* CMSIS_NVIC_VIRTUAL_H */
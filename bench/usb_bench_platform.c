@@ -0,0 +1,144 @@
+/************************************************************************************************//**
+* @file usb_bench_platform.c
+*
+* @brief File containing the host implementation of the modules used by the USB middleware which
+*        need the hardware of the device: the logger, the cycle counter and the power driver.
+*
+* Public Functions:
+*       - void log_error(char const* const format, ...)
+*       - void log_info(char const* const format, ...)
+*       - void log_debug(char const* const format, ...)
+*       - void log_debug_array(char const* const label, void const* array, uint16_t const len)
+*       - void Cycle_Counter_Init(void)
+*       - uint32_t Cycle_Counter_Get(void)
+*       - void Power_Init(void)
+*       - uint32_t Power_Enter_Low_Power(PowerMode_t mode)
+*       - void Bench_System_Reset(void)
+*
+* @note
+*       For further information about functions refer to the corresponding header file.
+**/
+
+#include "logger.h"
+#include "cycle_counter.h"
+#include "power_driver.h"
+#include "clock_driver.h"
+#include "system_stm32f4xx.h"
+#include "stm32f4xx.h"
+#include <setjmp.h>
+#include <time.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+/** @brief Only the errors are logged, to stderr, so the log does not weigh on the measurements */
+log_level_t system_log_level = LOG_LEVEL_ERROR;
+/** @brief The cycles of the host clock are counted at the frequency of the device */
+uint32_t SystemCoreClock = CLOCK_SYSCLK_HZ;
+/** @brief Set by the fuzz target, a reset of the device only ends its input */
+jmp_buf* bench_reset_jump = NULL;
+
+/***************************************************************************************************/
+/*                                       Static Function Prototypes                                */
+/***************************************************************************************************/
+
+/**
+ * @brief Function for printing a message to stderr if its level is enabled.
+ * @param[in] log_level is the level of the message.
+ * @param[in] label is the label printed before the message.
+ * @param[in] format is a string with the information to be printed.
+ * @param[in] args are the arguments of the format.
+ * @return void
+ */
+static void bench_log(log_level_t log_level, char const* label, char const* format, va_list args);
+
+/***************************************************************************************************/
+/*                                       Public API Definitions                                    */
+/***************************************************************************************************/
+
+void log_error(char const* const format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    bench_log(LOG_LEVEL_ERROR, "ERROR", format, args);
+    va_end(args);
+}
+
+void log_info(char const* const format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    bench_log(LOG_LEVEL_INFO, "INFO", format, args);
+    va_end(args);
+}
+
+void log_debug(char const* const format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    bench_log(LOG_LEVEL_DEBUG, "DEBUG", format, args);
+    va_end(args);
+}
+
+void log_debug_array(char const* const label, void const* array, uint16_t const len)
+{
+    if(LOG_LEVEL_DEBUG > system_log_level){
+        return;
+    }
+
+    fprintf(stderr, "[DEBUG] %s[%d]:", label, len);
+    for(uint16_t i = 0; i < len; i++){
+        fprintf(stderr, " 0x%02X", ((uint8_t const*)array)[i]);
+    }
+    fprintf(stderr, "\n");
+}
+
+void Cycle_Counter_Init(void)
+{
+    /* The host clock is always running */
+}
+
+uint32_t Cycle_Counter_Get(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint32_t)(((uint64_t)now.tv_sec*1000000000ULL + now.tv_nsec)*
+                      (SystemCoreClock/1000000)/1000);
+}
+
+void Power_Init(void)
+{
+    /* The host is never put to sleep */
+}
+
+uint32_t Power_Enter_Low_Power(__attribute__((unused)) PowerMode_t mode)
+{
+    /* The simulated core signals the wakeup at once */
+    return 0;
+}
+
+void Bench_System_Reset(void)
+{
+    if(bench_reset_jump != NULL){
+        longjmp(*bench_reset_jump, 1);
+    }
+    fprintf(stderr, "The device requested a system reset\n");
+    exit(EXIT_FAILURE);
+}
+
+/***************************************************************************************************/
+/*                                       Static Function Definitions                               */
+/***************************************************************************************************/
+
+static void bench_log(log_level_t log_level, char const* label, char const* format, va_list args)
+{
+    if(log_level > system_log_level){
+        return;
+    }
+
+    fprintf(stderr, "[%s] ", label);
+    vfprintf(stderr, format, args);
+    fprintf(stderr, "\n");
+}
@@ -0,0 +1,644 @@
+/************************************************************************************************//**
+* @file usb_benchmark.c
+*
+* @brief File containing the main function of the host benchmark of the USB stack.
+*
+* @note
+*       The unmodified USB driver and middleware run against the simulated OTG core, which plays the
+*       host. Each scenario is timed with the monotonic clock of the host and also counts the polls
+*       of the device, which do not depend on the host and so show the regressions of the protocol
+*       handling too. The results are written as JSON to the file given as argument, or to stdout.
+*
+*       Usage: usb_benchmark [<output json file>]
+**/
+
+#include "usb_sim_core.h"
+#include "usb_middleware.h"
+#include "usb_device_config.h"
+#include "usb_cdc_standards.h"
+#include "usb_hid.h"
+#include "usb_cdc_class.h"
+#include "usb_hid_class.h"
+#include "usb_telemetry_class.h"
+#include "helper_math.h"
+#include <time.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** @brief Number of enumerations measured */
+#define BENCH_ENUMERATIONS          10000
+/** @brief Number of control transfers measured for each request */
+#define BENCH_CONTROL_TRANSFERS     100000
+/** @brief Number of reports measured on the interrupt endpoint */
+#define BENCH_REPORTS               1000000
+/** @brief Number of batches of records sent through the telemetry endpoint */
+#define BENCH_TELEMETRY_BATCHES     10000
+/** @brief Number of records of each telemetry batch */
+#define BENCH_TELEMETRY_RECORDS     100
+/** @brief Size of the payload of each telemetry record, the framed record does not divide the
+           packets so the batches end at any offset of the ring buffer */
+#define BENCH_TELEMETRY_RECORD_SIZE 11
+/** @brief Number of bytes transferred for each packet size of the bulk endpoints */
+#define BENCH_BULK_BYTES            (4UL*1024UL*1024UL)
+/** @brief Number of IN tokens NAKed before a bulk or interrupt transfer is given up */
+#define BENCH_NAK_LIMIT             1000
+/** @brief Address set by the host during the enumeration */
+#define BENCH_DEVICE_ADDRESS        7
+
+/**
+ * @brief Struct with a control request measured by the benchmark.
+ */
+typedef struct
+{
+    char const* name;           /**< @brief Name of the request in the results */
+    USB_Request_t request;      /**< @brief SETUP packet of the request */
+    uint8_t const* data;        /**< @brief Data sent with an OUT request, NULL for the rest */
+}Bench_Control_t;
+
+/**
+ * @brief Struct with the measurement of a scenario.
+ */
+typedef struct
+{
+    uint64_t elapsed_ns;        /**< @brief Time taken by the scenario on the host */
+    uint32_t polls;             /**< @brief Polls of the device during the scenario */
+}Bench_Measure_t;
+
+/***************************************************************************************************/
+/*                                       Static Function Prototypes                                */
+/***************************************************************************************************/
+
+/**
+ * @brief Function for starting a measurement.
+ * @param[out] measure is the measurement to be started.
+ * @return void
+ */
+static void bench_start(Bench_Measure_t* measure);
+
+/**
+ * @brief Function for stopping a measurement.
+ * @param[in,out] measure is the measurement started by bench_start.
+ * @return void
+ */
+static void bench_stop(Bench_Measure_t* measure);
+
+/**
+ * @brief Function for terminating the benchmark when the device does not answer as expected.
+ * @param[in] message is the description of the failure.
+ * @return void
+ */
+static void bench_fail(char const* message);
+
+/**
+ * @brief Function for running a control transfer which must not be stalled.
+ * @param[in] request is the SETUP packet of the request.
+ * @param[in] data is the buffer of the DATA stage.
+ * @return the number of bytes of the DATA stage.
+ */
+static uint16_t bench_control(USB_Request_t const* request, void* data);
+
+/**
+ * @brief Function for enumerating the device as a host does: reset, descriptors, address and
+ *        configuration.
+ * @return void
+ */
+static void bench_enumerate(void);
+
+/**
+ * @brief Function for receiving the next packet of an IN endpoint, polling the device while it
+ *        NAKs.
+ * @param[in] endpoint_number is the number of the IN endpoint.
+ * @param[out] packet is the buffer for the packet.
+ * @return the size of the packet.
+ */
+static uint16_t bench_in_packet(uint8_t endpoint_number, void* packet);
+
+/**
+ * @brief Function for measuring the enumeration of the device.
+ * @param[in] output is the stream of the results.
+ * @return void
+ */
+static void bench_enumeration(FILE* output);
+
+/**
+ * @brief Function for measuring the round trip of some control transfers.
+ * @param[in] output is the stream of the results.
+ * @return void
+ */
+static void bench_control_transfers(FILE* output);
+
+/**
+ * @brief Function for measuring the rate of the reports of the HID interrupt endpoint.
+ * @param[in] output is the stream of the results.
+ * @return void
+ */
+static void bench_interrupt_reports(FILE* output);
+
+/**
+ * @brief Function for measuring the rate of the records of the telemetry endpoint. The host takes
+ *        a packet after each record is written and the batch is flushed after its last record, so
+ *        the packets straddle the end of the ring buffer at every offset. Only the last packet of
+ *        each batch may be short.
+ * @param[in] output is the stream of the results.
+ * @return void
+ */
+static void bench_telemetry(FILE* output);
+
+/**
+ * @brief Function for checking the records of a telemetry batch received by the host.
+ * @param[in] batch is the data of the batch.
+ * @param[in] size is the size of the batch in bytes.
+ * @param[in,out] sequence is the sequence number of the first record, it is updated with the one
+ *                following the batch.
+ * @param[in,out] offset is the offset of the payload of the first record in the benchmark data,
+ *                it is updated with the one following the batch.
+ * @return void
+ */
+static void bench_check_telemetry_batch(uint8_t const* batch, uint32_t size, uint8_t* sequence,
+                                        uint32_t* offset);
+
+/**
+ * @brief Function for measuring the throughput of the CDC bulk endpoints for each packet size.
+ * @param[in] output is the stream of the results.
+ * @return void
+ */
+static void bench_bulk_transfers(FILE* output);
+
+/**
+ * @brief Function for sending data from the device through the CDC bulk IN endpoint.
+ * @param[in] packet_size is the size of the data written by the application at a time, each write
+ *            is sent as one packet.
+ * @return void
+ */
+static void bench_bulk_in(uint16_t packet_size);
+
+/**
+ * @brief Function for sending data to the device through the CDC bulk OUT endpoint.
+ * @param[in] packet_size is the size of the packets sent by the host.
+ * @return void
+ */
+static void bench_bulk_out(uint16_t packet_size);
+
+/**
+ * @brief Function for printing the result of a bulk measurement.
+ * @param[in] output is the stream of the results.
+ * @param[in] endpoint_address is the address of the measured endpoint.
+ * @param[in] packet_size is the size of the packets.
+ * @param[in] measure is the measurement.
+ * @param[in] last is true for the last result of the list.
+ * @return void
+ */
+static void bench_print_bulk(FILE* output, uint8_t endpoint_address, uint16_t packet_size,
+                             Bench_Measure_t const* measure, bool last);
+
+/***************************************************************************************************/
+/*                                       Static Variables                                          */
+/***************************************************************************************************/
+
+/** @brief Control state of the device */
+static USB_Device_t usb_device;
+/** @brief Buffer of the SETUP packets and the DATA OUT stages of the device */
+static uint32_t buffer[8];
+/** @brief Line coding sent by the SET_LINE_CODING request: 115200 bauds, 8N1 */
+static uint8_t const bench_line_coding[7] = {0x00, 0xC2, 0x01, 0x00, 0x00, 0x00, 0x08};
+/** @brief Control requests measured, after the enumeration */
+static Bench_Control_t const bench_controls[] = {
+    {
+        "GET_STATUS",
+        {USB_BM_REQUEST_TYPE_DIRECTION_TOHOST, USB_STANDARD_GET_STATUS, 0, 0, 2},
+        NULL
+    },
+    {
+        "GET_DESCRIPTOR(DEVICE)",
+        {USB_BM_REQUEST_TYPE_DIRECTION_TOHOST, USB_STANDARD_GET_DESCRIPTOR,
+         USB_DESCRIPTOR_TYPE_DEVICE << 8, 0, sizeof(USB_StdDeviceDescriptor_t)},
+        NULL
+    },
+    {
+        "GET_DESCRIPTOR(CONFIGURATION)",
+        {USB_BM_REQUEST_TYPE_DIRECTION_TOHOST, USB_STANDARD_GET_DESCRIPTOR,
+         USB_DESCRIPTOR_TYPE_CONFIGURATION << 8, 0, UINT16_MAX},
+        NULL
+    },
+    {
+        "SET_IDLE",
+        {USB_BM_REQUEST_TYPE_TYPE_CLASS | USB_BM_REQUEST_TYPE_RECIPIENT_INTERFACE,
+         USB_HID_SETIDLE, 0, USB_INTERFACE_HID, 0},
+        NULL
+    },
+    {
+        "SET_LINE_CODING",
+        {USB_BM_REQUEST_TYPE_TYPE_CLASS | USB_BM_REQUEST_TYPE_RECIPIENT_INTERFACE,
+         USB_CDC_SET_LINE_CODING, 0, USB_INTERFACE_CDC_COMM, sizeof(bench_line_coding)},
+        bench_line_coding
+    },
+};
+/** @brief Packet sizes of the bulk measurements, up to the maximum packet size of full speed */
+static uint16_t const bench_packet_sizes[] = {8, 16, 32, 64};
+/** @brief Data of the bulk transfers */
+static uint8_t bench_data[BENCH_BULK_BYTES];
+
+/***************************************************************************************************/
+/*                                       Main Function                                             */
+/***************************************************************************************************/
+
+int main(int argc, char* argv[])
+{
+    FILE* output = stdout;
+
+    if(argc > 2){
+        fprintf(stderr, "Usage: %s [<output json file>]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    if(argc == 2){
+        output = fopen(argv[1], "w");
+        if(output == NULL){
+            perror(argv[1]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    for(uint32_t i = 0; i < BENCH_BULK_BYTES; i++){
+        bench_data[i] = i*7 + 3;
+    }
+
+    USB_Sim_Init();
+    usb_device.ptr_out_buffer = &buffer;
+    USB_Device_Init(&usb_device);
+
+    fprintf(output, "{\n");
+    bench_enumeration(output);
+    bench_control_transfers(output);
+    bench_interrupt_reports(output);
+    bench_telemetry(output);
+    bench_bulk_transfers(output);
+    fprintf(output, "}\n");
+
+    if(output != stdout){
+        fclose(output);
+    }
+    return EXIT_SUCCESS;
+}
+
+/***************************************************************************************************/
+/*                                       Static Function Definitions                               */
+/***************************************************************************************************/
+
+static void bench_start(Bench_Measure_t* measure)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    measure->elapsed_ns = (uint64_t)now.tv_sec*1000000000ULL + now.tv_nsec;
+    measure->polls = USB_Sim_Get_Polls();
+}
+
+static void bench_stop(Bench_Measure_t* measure)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    measure->elapsed_ns = (uint64_t)now.tv_sec*1000000000ULL + now.tv_nsec - measure->elapsed_ns;
+    measure->polls = USB_Sim_Get_Polls() - measure->polls;
+}
+
+static void bench_fail(char const* message)
+{
+    fprintf(stderr, "Benchmark: %s\n", message);
+    exit(EXIT_FAILURE);
+}
+
+static uint16_t bench_control(USB_Request_t const* request, void* data)
+{
+    int32_t size = USB_Sim_Control_Transfer(request, data);
+
+    if(size < 0){
+        bench_fail("control transfer stalled");
+    }
+
+    return size;
+}
+
+static void bench_enumerate(void)
+{
+    static uint8_t descriptor[1024];
+    USB_StdDeviceDescriptor_t device_descriptor;
+    USB_Request_t request = {USB_BM_REQUEST_TYPE_DIRECTION_TOHOST, USB_STANDARD_GET_DESCRIPTOR,
+                             USB_DESCRIPTOR_TYPE_DEVICE << 8, 0, 64};
+    uint8_t string_indexes[3];
+    uint16_t total_length;
+
+    USB_Sim_Bus_Reset();
+
+    /* The first request only reads the maximum packet size of the endpoint 0 */
+    bench_control(&request, descriptor);
+
+    request = (USB_Request_t){USB_BM_REQUEST_TYPE_DIRECTION_TODEVICE, USB_STANDARD_SET_ADDRESS,
+                              BENCH_DEVICE_ADDRESS, 0, 0};
+    bench_control(&request, NULL);
+
+    request = (USB_Request_t){USB_BM_REQUEST_TYPE_DIRECTION_TOHOST, USB_STANDARD_GET_DESCRIPTOR,
+                              USB_DESCRIPTOR_TYPE_DEVICE << 8, 0, sizeof(device_descriptor)};
+    if(bench_control(&request, &device_descriptor) != sizeof(device_descriptor)){
+        bench_fail("short device descriptor");
+    }
+
+    /* The header of the configuration descriptor gives the length of the whole set */
+    request.wValue = USB_DESCRIPTOR_TYPE_CONFIGURATION << 8;
+    request.wLength = sizeof(USB_StdCfgDescriptor_t);
+    bench_control(&request, descriptor);
+    total_length = ((USB_StdCfgDescriptor_t const*)descriptor)->wTotalLength;
+    request.wLength = MIN(total_length, sizeof(descriptor));
+    if(bench_control(&request, descriptor) != total_length){
+        bench_fail("short configuration descriptor");
+    }
+
+    /* The languages and then the strings of the device descriptor */
+    request.wValue = USB_DESCRIPTOR_TYPE_STRING << 8;
+    request.wLength = UINT8_MAX;
+    bench_control(&request, descriptor);
+    string_indexes[0] = device_descriptor.iManufacturer;
+    string_indexes[1] = device_descriptor.iProduct;
+    string_indexes[2] = device_descriptor.iSerialNumber;
+    for(uint8_t i = 0; i < sizeof(string_indexes); i++){
+        if(string_indexes[i] == 0){
+            continue;
+        }
+        request.wValue = (USB_DESCRIPTOR_TYPE_STRING << 8) | string_indexes[i];
+        request.wIndex = 0x0409;
+        bench_control(&request, descriptor);
+    }
+
+    request = (USB_Request_t){USB_BM_REQUEST_TYPE_DIRECTION_TODEVICE, USB_STANDARD_SET_CONFIG,
+                              1, 0, 0};
+    bench_control(&request, NULL);
+    if(usb_device.device_state != USB_DEVICE_STATE_CONFIGURED){
+        bench_fail("device not configured");
+    }
+}
+
+static uint16_t bench_in_packet(uint8_t endpoint_number, void* packet)
+{
+    for(uint32_t i = 0; i < BENCH_NAK_LIMIT; i++){
+        int32_t size = USB_Sim_In_Token(endpoint_number, packet);
+
+        if(size >= 0){
+            return size;
+        }
+        if(size == USB_SIM_STALL){
+            bench_fail("IN endpoint stalled");
+        }
+        USB_Sim_Poll(0);
+    }
+
+    bench_fail("IN endpoint NAKed until the host gave up");
+    return 0;
+}
+
+static void bench_enumeration(FILE* output)
+{
+    Bench_Measure_t measure;
+
+    bench_start(&measure);
+    for(uint32_t i = 0; i < BENCH_ENUMERATIONS; i++){
+        bench_enumerate();
+    }
+    bench_stop(&measure);
+
+    fprintf(output, "  \"enumeration\": {\"iterations\": %u, \"time_us\": %.3f, \"polls\": %.1f},\n",
+            BENCH_ENUMERATIONS, measure.elapsed_ns/1000.0/BENCH_ENUMERATIONS,
+            (double)measure.polls/BENCH_ENUMERATIONS);
+}
+
+static void bench_control_transfers(FILE* output)
+{
+    static uint8_t data[1024];
+    uint8_t count = sizeof(bench_controls)/sizeof(bench_controls[0]);
+
+    fprintf(output, "  \"control_transfers\": [\n");
+    for(uint8_t i = 0; i < count; i++){
+        Bench_Control_t const* control = &bench_controls[i];
+        Bench_Measure_t measure;
+        uint16_t size = 0;
+
+        if(control->data != NULL){
+            memcpy(data, control->data, control->request.wLength);
+        }
+        bench_start(&measure);
+        for(uint32_t j = 0; j < BENCH_CONTROL_TRANSFERS; j++){
+            size = bench_control(&control->request, data);
+        }
+        bench_stop(&measure);
+
+        fprintf(output, "    {\"request\": \"%s\", \"data_bytes\": %u, \"iterations\": %u, "
+                "\"round_trip_us\": %.3f, \"polls\": %.1f}%s\n",
+                control->name, size, BENCH_CONTROL_TRANSFERS,
+                measure.elapsed_ns/1000.0/BENCH_CONTROL_TRANSFERS,
+                (double)measure.polls/BENCH_CONTROL_TRANSFERS, (i + 1 < count) ? "," : "");
+    }
+    fprintf(output, "  ],\n");
+}
+
+static void bench_interrupt_reports(FILE* output)
+{
+    uint8_t report[64];
+    Bench_Measure_t measure;
+
+    /* A report is sent in every frame, the demo of the mouse adds its own reports to them */
+    bench_start(&measure);
+    for(uint32_t i = 0; i < BENCH_REPORTS; i++){
+        USB_Sim_Start_Of_Frame();
+        USB_HID_Mouse_Update(1, 0, 0);
+        if(bench_in_packet(USB_ENDPOINT_NUMBER(USB_HID_IN_ENDPOINT), report) == 0){
+            bench_fail("empty HID report");
+        }
+    }
+    bench_stop(&measure);
+
+    fprintf(output, "  \"interrupt_reports\": {\"endpoint\": \"0x%02X\", \"reports\": %u, "
+            "\"reports_per_s\": %.0f, \"polls\": %.1f},\n",
+            USB_HID_IN_ENDPOINT, BENCH_REPORTS, BENCH_REPORTS*1e9/measure.elapsed_ns,
+            (double)measure.polls/BENCH_REPORTS);
+}
+
+static void bench_telemetry(FILE* output)
+{
+    static uint8_t batch[BENCH_TELEMETRY_RECORDS*
+                         (USB_TELEMETRY_RECORD_HEADER_SIZE + BENCH_TELEMETRY_RECORD_SIZE) + 64];
+    uint8_t endpoint_number = USB_ENDPOINT_NUMBER(USB_TELEMETRY_IN_ENDPOINT);
+    uint32_t write_offset = 0;
+    uint32_t check_offset = 0;
+    uint8_t sequence = 0;
+    Bench_Measure_t measure;
+
+    bench_start(&measure);
+    for(uint32_t i = 0; i < BENCH_TELEMETRY_BATCHES; i++){
+        uint32_t size = 0;
+        int32_t packet;
+
+        for(uint32_t j = 0; j < BENCH_TELEMETRY_RECORDS; j++){
+            if(!USB_Telemetry_Write(&bench_data[write_offset], BENCH_TELEMETRY_RECORD_SIZE)){
+                bench_fail("telemetry record dropped");
+            }
+            write_offset += BENCH_TELEMETRY_RECORD_SIZE;
+
+            packet = USB_Sim_In_Token(endpoint_number, &batch[size]);
+            if(packet == USB_SIM_STALL){
+                bench_fail("IN endpoint stalled");
+            }
+            if(packet >= 0){
+                if(packet < 64){
+                    bench_fail("short telemetry packet in the middle of a batch");
+                }
+                size += packet;
+            }
+        }
+
+        USB_Telemetry_Flush();
+        do{
+            packet = bench_in_packet(endpoint_number, &batch[size]);
+            size += packet;
+        }while(packet == 64);
+
+        bench_check_telemetry_batch(batch, size, &sequence, &check_offset);
+        if(write_offset > BENCH_BULK_BYTES - sizeof(batch)){
+            write_offset = 0;
+            check_offset = 0;
+        }
+    }
+    bench_stop(&measure);
+
+    fprintf(output, "  \"telemetry\": {\"endpoint\": \"0x%02X\", \"records\": %u, "
+            "\"record_size\": %u, \"records_per_s\": %.0f, \"polls\": %.2f},\n",
+            USB_TELEMETRY_IN_ENDPOINT, BENCH_TELEMETRY_BATCHES*BENCH_TELEMETRY_RECORDS,
+            BENCH_TELEMETRY_RECORD_SIZE,
+            BENCH_TELEMETRY_BATCHES*BENCH_TELEMETRY_RECORDS*1e9/measure.elapsed_ns,
+            (double)measure.polls/(BENCH_TELEMETRY_BATCHES*BENCH_TELEMETRY_RECORDS));
+}
+
+static void bench_check_telemetry_batch(uint8_t const* batch, uint32_t size, uint8_t* sequence,
+                                        uint32_t* offset)
+{
+    uint32_t position = 0;
+
+    if(size != BENCH_TELEMETRY_RECORDS*
+               (USB_TELEMETRY_RECORD_HEADER_SIZE + BENCH_TELEMETRY_RECORD_SIZE)){
+        bench_fail("telemetry batch of unexpected size");
+    }
+
+    while(position < size){
+        if((batch[position] != BENCH_TELEMETRY_RECORD_SIZE) || (batch[position + 1] != *sequence) ||
+           (memcmp(&batch[position + USB_TELEMETRY_RECORD_HEADER_SIZE], &bench_data[*offset],
+                   BENCH_TELEMETRY_RECORD_SIZE) != 0)){
+            bench_fail("telemetry record received by the host differs");
+        }
+        position += USB_TELEMETRY_RECORD_HEADER_SIZE + BENCH_TELEMETRY_RECORD_SIZE;
+        *offset += BENCH_TELEMETRY_RECORD_SIZE;
+        (*sequence)++;
+    }
+}
+
+static void bench_bulk_transfers(FILE* output)
+{
+    uint8_t count = sizeof(bench_packet_sizes)/sizeof(bench_packet_sizes[0]);
+
+    fprintf(output, "  \"bulk_transfers\": [\n");
+    for(uint8_t i = 0; i < count; i++){
+        Bench_Measure_t measure;
+
+        bench_start(&measure);
+        bench_bulk_in(bench_packet_sizes[i]);
+        bench_stop(&measure);
+        bench_print_bulk(output, USB_CDC_IN_ENDPOINT, bench_packet_sizes[i], &measure, false);
+    }
+    for(uint8_t i = 0; i < count; i++){
+        Bench_Measure_t measure;
+
+        bench_start(&measure);
+        bench_bulk_out(bench_packet_sizes[i]);
+        bench_stop(&measure);
+        bench_print_bulk(output, USB_CDC_OUT_ENDPOINT, bench_packet_sizes[i], &measure,
+                         i + 1 == count);
+    }
+    fprintf(output, "  ]\n");
+}
+
+static void bench_bulk_in(uint16_t packet_size)
+{
+    static uint8_t received[BENCH_BULK_BYTES + 64];
+    uint8_t endpoint_number = USB_ENDPOINT_NUMBER(USB_CDC_IN_ENDPOINT);
+    uint32_t sent = 0;
+    uint32_t size = 0;
+
+    while(sent < BENCH_BULK_BYTES){
+        uint8_t* data;
+        uint16_t packet;
+
+        if(USB_CDC_Write_Acquire(&data) < packet_size){
+            bench_fail("CDC transmission ring full");
+        }
+        memcpy(data, &bench_data[sent], packet_size);
+        USB_CDC_Write_Commit(packet_size);
+        sent += packet_size;
+
+        /* A transfer ending with a full packet is terminated by a zero length packet */
+        do{
+            packet = bench_in_packet(endpoint_number, &received[size]);
+            size += packet;
+        }while((size < sent) || (packet == 64));
+    }
+
+    if((size != sent) || (memcmp(received, bench_data, sent) != 0)){
+        bench_fail("CDC data received by the host differs");
+    }
+}
+
+static void bench_bulk_out(uint16_t packet_size)
+{
+    static uint8_t received[BENCH_BULK_BYTES];
+    uint8_t endpoint_number = USB_ENDPOINT_NUMBER(USB_CDC_OUT_ENDPOINT);
+    uint32_t sent = 0;
+    uint32_t size = 0;
+
+    while(size < BENCH_BULK_BYTES){
+        uint8_t const* data;
+        uint32_t available;
+        int32_t result = USB_Sim_Out_Packet(endpoint_number, &bench_data[sent], packet_size);
+
+        if(result == USB_SIM_STALL){
+            bench_fail("OUT endpoint stalled");
+        }
+        if(result == USB_SIM_NAK){
+            USB_Sim_Poll(0);
+        }
+        else{
+            sent += packet_size;
+        }
+
+        /* The application reads the data as soon as it is received */
+        while((available = USB_CDC_Read_Acquire(&data)) > 0){
+            memcpy(&received[size], data, available);
+            size += available;
+            USB_CDC_Read_Release(available);
+        }
+    }
+
+    if((size != sent) || (memcmp(received, bench_data, size) != 0)){
+        bench_fail("CDC data received by the device differs");
+    }
+}
+
+static void bench_print_bulk(FILE* output, uint8_t endpoint_address, uint16_t packet_size,
+                             Bench_Measure_t const* measure, bool last)
+{
+    uint32_t packets = BENCH_BULK_BYTES/packet_size;
+
+    fprintf(output, "    {\"endpoint\": \"0x%02X\", \"packet_size\": %u, \"bytes\": %lu, "
+            "\"mb_per_s\": %.3f, \"polls_per_packet\": %.2f}%s\n",
+            endpoint_address, packet_size, BENCH_BULK_BYTES,
+            BENCH_BULK_BYTES*1e3/measure->elapsed_ns, (double)measure->polls/packets,
+            last ? "" : ",");
+}
@@ -0,0 +1,253 @@
+/************************************************************************************************//**
+* @file usb_fuzz.c
+*
+* @brief File containing the fuzz target of the SETUP packet handling of the USB stack.
+*
+* Public Functions:
+*       - int LLVMFuzzerTestOneInput(uint8_t const* data, size_t size)
+*
+* @note
+*       The unmodified USB driver and middleware run against the simulated OTG core, as in the
+*       benchmark, and every input is a sequence of host actions played on the bus from a bus reset.
+*       Each action starts with a byte which selects it (@ref USB_FUZZ_ACTIONS, modulo their
+*       number), followed by its arguments:
+*       - control transfer: the 8 bytes of the SETUP packet, followed by the wLength bytes of the
+*         DATA stage of the host to device requests.
+*       - bus reset, start of frame, suspend and resume: no arguments.
+*       - IN token: the endpoint number (1 to 5).
+*       - OUT packet: the endpoint number (1 to 5), the size (up to the maximum packet size) and the
+*         data of the packet.
+*       - idle: the number of polls without events.
+*       The bytes missing at the end of the input are zeros. The sanitizers catch the memory errors,
+*       and the simulated core aborts when the device breaks the protocol (e.g. it NAKs a control
+*       transfer until the host gives up).
+*
+*       It is built by "waf fuzz", which runs it over the seed inputs of bench/fuzz_seeds. Without
+*       USB_FUZZ_LIBFUZZER it has its own main function, which runs the files given as arguments, or
+*       stdin, as the inputs of AFL. With it the main function is the one of libFuzzer, whose inputs
+*       keep the state of the class drivers left by the previous ones, so a crash should be run
+*       again alone to be reproduced.
+*
+*       Usage: usb_fuzz [<input file>]...
+**/
+
+#include "usb_sim_core.h"
+#include "usb_middleware.h"
+#include "helper_math.h"
+#include "stm32f4xx.h"
+#include <setjmp.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** @brief Number of endpoints of the core in each direction */
+#define USB_FUZZ_ENDPOINTS          6
+/** @brief Maximum size of an input read by the main function, as the default of libFuzzer */
+#define USB_FUZZ_MAX_INPUT          4096
+
+/**
+ * @defgroup USB_FUZZ_ACTIONS Host actions of the inputs of the fuzz target.
+ * @{
+ */
+#define USB_FUZZ_CONTROL            0
+#define USB_FUZZ_BUS_RESET          1
+#define USB_FUZZ_START_OF_FRAME     2
+#define USB_FUZZ_IN_TOKEN           3
+#define USB_FUZZ_OUT_PACKET         4
+#define USB_FUZZ_SUSPEND            5
+#define USB_FUZZ_RESUME             6
+#define USB_FUZZ_IDLE               7
+#define USB_FUZZ_ACTION_COUNT       8
+/** @} */
+
+/**
+ * @brief Struct with the input being played.
+ */
+typedef struct
+{
+    uint8_t const* data;        /**< @brief Data of the input */
+    size_t size;                /**< @brief Size of the input in bytes */
+    size_t position;            /**< @brief Position of the next byte to be read */
+}USB_Fuzz_Input_t;
+
+/***************************************************************************************************/
+/*                                       Static Function Prototypes                                */
+/***************************************************************************************************/
+
+/**
+ * @brief Function for reading bytes from the input, the bytes past its end are zeros.
+ * @param[in,out] input is the input being played.
+ * @param[out] buffer is the buffer for the bytes.
+ * @param[in] size is the number of bytes to be read.
+ * @return void
+ */
+static void fuzz_read(USB_Fuzz_Input_t* input, void* buffer, size_t size);
+
+/**
+ * @brief Function for reading one byte from the input.
+ * @param[in,out] input is the input being played.
+ * @return the byte, 0 past the end of the input.
+ */
+static uint8_t fuzz_read_byte(USB_Fuzz_Input_t* input);
+
+/**
+ * @brief Function for playing the next action of the input.
+ * @param[in,out] input is the input being played.
+ * @return void
+ */
+static void fuzz_action(USB_Fuzz_Input_t* input);
+
+#ifndef USB_FUZZ_LIBFUZZER
+/**
+ * @brief Function for running a file as an input.
+ * @param[in] file is the stream of the input.
+ * @return void
+ */
+static void fuzz_run_file(FILE* file);
+#endif
+
+/***************************************************************************************************/
+/*                                       Static Variables                                          */
+/***************************************************************************************************/
+
+/** @brief Control state of the device */
+static USB_Device_t usb_device;
+/** @brief Buffer of the SETUP packets and the DATA OUT stages of the device */
+static uint32_t buffer[8];
+/** @brief Data of the DATA stages of the control transfers, up to the largest wLength */
+static uint8_t fuzz_control_data[UINT16_MAX];
+/** @brief Data of the packets of the non control endpoints, up to the largest packet of the core */
+static uint8_t fuzz_packet[_FLD2VAL(USB_OTG_DIEPCTL_MPSIZ, USB_OTG_DIEPCTL_MPSIZ)];
+
+/***************************************************************************************************/
+/*                                       Public API Definitions                                    */
+/***************************************************************************************************/
+
+int LLVMFuzzerTestOneInput(uint8_t const* data, size_t size)
+{
+    USB_Fuzz_Input_t input = {data, size, 0};
+    jmp_buf reset_jump;
+
+    USB_Sim_Init();
+    memset(&usb_device, 0, sizeof(usb_device));
+    usb_device.ptr_out_buffer = &buffer;
+    USB_Device_Init(&usb_device);
+
+    /* A system reset requested by the device (e.g. at the end of a DFU download) ends the input */
+    bench_reset_jump = &reset_jump;
+    if(setjmp(reset_jump) == 0){
+        USB_Sim_Bus_Reset();
+        while(input.position < input.size){
+            fuzz_action(&input);
+        }
+    }
+    bench_reset_jump = NULL;
+
+    return 0;
+}
+
+#ifndef USB_FUZZ_LIBFUZZER
+/***************************************************************************************************/
+/*                                       Main Function                                             */
+/***************************************************************************************************/
+
+int main(int argc, char* argv[])
+{
+    if(argc == 1){
+        fuzz_run_file(stdin);
+    }
+
+    for(int i = 1; i < argc; i++){
+        FILE* file = fopen(argv[i], "rb");
+
+        if(file == NULL){
+            perror(argv[i]);
+            return EXIT_FAILURE;
+        }
+        fuzz_run_file(file);
+        fclose(file);
+    }
+
+    return EXIT_SUCCESS;
+}
+#endif
+
+/***************************************************************************************************/
+/*                                       Static Function Definitions                               */
+/***************************************************************************************************/
+
+static void fuzz_read(USB_Fuzz_Input_t* input, void* buffer, size_t size)
+{
+    size_t available = MIN(size, input->size - input->position);
+
+    memcpy(buffer, input->data + input->position, available);
+    memset((uint8_t*)buffer + available, 0, size - available);
+    input->position += available;
+}
+
+static uint8_t fuzz_read_byte(USB_Fuzz_Input_t* input)
+{
+    uint8_t byte = 0;
+
+    fuzz_read(input, &byte, sizeof(byte));
+    return byte;
+}
+
+static void fuzz_action(USB_Fuzz_Input_t* input)
+{
+    USB_Request_t request;
+    uint8_t endpoint_number = 0;
+    uint16_t size = 0;
+
+    switch(fuzz_read_byte(input) % USB_FUZZ_ACTION_COUNT){
+        case USB_FUZZ_CONTROL:
+            fuzz_read(input, &request, sizeof(request));
+            if(!(request.bmRequestType & USB_BM_REQUEST_TYPE_DIRECTION_TOHOST)){
+                fuzz_read(input, fuzz_control_data, request.wLength);
+            }
+            USB_Sim_Control_Transfer(&request, fuzz_control_data);
+            break;
+        case USB_FUZZ_BUS_RESET:
+            USB_Sim_Bus_Reset();
+            break;
+        case USB_FUZZ_START_OF_FRAME:
+            USB_Sim_Start_Of_Frame();
+            break;
+        case USB_FUZZ_IN_TOKEN:
+            endpoint_number = 1 + (fuzz_read_byte(input) % (USB_FUZZ_ENDPOINTS - 1));
+            USB_Sim_In_Token(endpoint_number, fuzz_packet);
+            break;
+        case USB_FUZZ_OUT_PACKET:
+            endpoint_number = 1 + (fuzz_read_byte(input) % (USB_FUZZ_ENDPOINTS - 1));
+            size = fuzz_read_byte(input) % (USB_Sim_Get_Out_Packet_Size(endpoint_number) + 1);
+            fuzz_read(input, fuzz_packet, size);
+            USB_Sim_Out_Packet(endpoint_number, fuzz_packet, size);
+            break;
+        case USB_FUZZ_SUSPEND:
+            USB_Sim_Poll(USB_OTG_GINTSTS_USBSUSP);
+            break;
+        case USB_FUZZ_RESUME:
+            USB_Sim_Poll(USB_OTG_GINTSTS_WKUINT);
+            break;
+        case USB_FUZZ_IDLE:
+            for(uint8_t polls = fuzz_read_byte(input); polls > 0; polls--){
+                USB_Sim_Poll(0);
+            }
+            break;
+        default:
+            /* do nothing */
+            break;
+    }
+}
+
+#ifndef USB_FUZZ_LIBFUZZER
+static void fuzz_run_file(FILE* file)
+{
+    static uint8_t data[USB_FUZZ_MAX_INPUT];
+    size_t size = fread(data, 1, sizeof(data), file);
+
+    LLVMFuzzerTestOneInput(data, size);
+}
+#endif
@@ -0,0 +1,557 @@
+/************************************************************************************************//**
+* @file usb_sim_core.c
+*
+* @brief File containing the APIs of the simulated OTG core.
+*
+* Public Functions:
+*       - void USB_Sim_Init(void)
+*       - void USB_Sim_Poll(uint32_t events)
+*       - void USB_Sim_Bus_Reset(void)
+*       - void USB_Sim_Start_Of_Frame(void)
+*       - int32_t USB_Sim_Control_Transfer(USB_Request_t const* request, void* data)
+*       - int32_t USB_Sim_In_Token(uint8_t endpoint_number, void* packet)
+*       - int32_t USB_Sim_Out_Packet(uint8_t endpoint_number, void const* packet, uint16_t size)
+*       - uint16_t USB_Sim_Get_Out_Packet_Size(uint8_t endpoint_number)
+*       - uint32_t USB_Sim_Get_Polls(void)
+*       - uint32_t USB_Sim_FIFO_Pop(uint32_t const volatile* fifo)
+*       - void USB_Sim_FIFO_Push(uint32_t volatile* fifo, uint32_t data)
+*
+* @note
+*       For further information about functions refer to the corresponding header file.
+**/
+
+#include "usb_sim_core.h"
+#include "usb_middleware.h"
+#include "usb_driver.h"
+#include "flash_driver.h"
+#include "helper_math.h"
+#include "stm32f4xx.h"
+#include <sys/mman.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** @brief Peripherals reached by the driver and the middleware: the flash interface, the RCC and
+ *         the OTG HS core */
+#define USB_SIM_PERIPHERALS_BASE    0x40000000UL
+#define USB_SIM_PERIPHERALS_SIZE    0x00080000UL
+/** @brief Page of the unique device ID, read for the serial number string */
+#define USB_SIM_UID_PAGE            (UID_BASE & ~0xFFFUL)
+#define USB_SIM_UID_PAGE_SIZE       0x1000UL
+/** @brief Both banks of the flash, which the DFU class erases, programs and reads back */
+#define USB_SIM_FLASH_SIZE          (2*FLASH_BANK_SIZE)
+/** @brief Number of endpoints of the core in each direction */
+#define USB_SIM_ENDPOINTS           6
+/** @brief Size in words of the simulated FIFOs, larger than any FIFO configured by the driver */
+#define USB_SIM_FIFO_WORDS          1024
+/** @brief Number of polls of a NAKing device before a stage of a control transfer is given up */
+#define USB_SIM_NAK_LIMIT           1000
+
+/**
+ * @defgroup USB_SIM_PACKET_STATUS Status of the packets pushed into the RxFIFO (GRXSTSP PKTSTS).
+ * @{
+ */
+#define USB_SIM_OUT_DATA            0x02
+#define USB_SIM_OUT_COMPLETED       0x03
+#define USB_SIM_SETUP_COMPLETED     0x04
+#define USB_SIM_SETUP_DATA          0x06
+/** @} */
+
+/**
+ * @brief Struct with a simulated FIFO of words.
+ */
+typedef struct
+{
+    uint32_t words[USB_SIM_FIFO_WORDS]; /**< @brief Words of the FIFO */
+    uint16_t head;                      /**< @brief Index of the next word to be popped */
+    uint16_t tail;                      /**< @brief Index of the next word to be pushed */
+}USB_Sim_FIFO_t;
+
+/***************************************************************************************************/
+/*                                       Static Function Prototypes                                */
+/***************************************************************************************************/
+
+/**
+ * @brief Function for getting the registers of an IN endpoint.
+ * @param[in] endpoint_number is the number of the IN endpoint.
+ * @return a pointer to the registers of the endpoint.
+ */
+static USB_OTG_INEndpointTypeDef* sim_in_endpoint(uint8_t endpoint_number);
+
+/**
+ * @brief Function for getting the registers of an OUT endpoint.
+ * @param[in] endpoint_number is the number of the OUT endpoint.
+ * @return a pointer to the registers of the endpoint.
+ */
+static USB_OTG_OUTEndpointTypeDef* sim_out_endpoint(uint8_t endpoint_number);
+
+/**
+ * @brief Function for mapping memory at a fixed address for the registers of the device.
+ * @param[in] address is the address of the memory.
+ * @param[in] size is the size of the memory in bytes.
+ * @return void
+ */
+static void sim_map(uintptr_t address, size_t size);
+
+/**
+ * @brief Function for aborting the process when the device does not behave as the host expects,
+ *        so the fuzzers report it as a crash.
+ * @param[in] message is the description of the failure.
+ * @return void
+ */
+static void sim_fail(char const* message);
+
+/**
+ * @brief Function for applying the flushes of the FIFOs requested by the driver, and updating the
+ *        space available in the TxFIFOs.
+ * @return void
+ */
+static void sim_update_fifos(void);
+
+/**
+ * @brief Function for signaling an interrupt of an endpoint.
+ * @param[in] endpoint_number is the number of the endpoint.
+ * @param[in] in is true for an IN endpoint and false for an OUT endpoint.
+ * @param[in] flags are the flags of the DIEPINT or DOEPINT register.
+ * @return void
+ */
+static void sim_endpoint_interrupt(uint8_t endpoint_number, bool in, uint32_t flags);
+
+/**
+ * @brief Function for pushing a packet into the RxFIFO and polling the device until it is popped.
+ * @param[in] endpoint_number is the number of the OUT endpoint which received the packet.
+ * @param[in] status is the @ref USB_SIM_PACKET_STATUS of the packet.
+ * @param[in] data is the data of the packet, NULL if size is 0.
+ * @param[in] size is the size of the packet in bytes.
+ * @return void
+ */
+static void sim_receive(uint8_t endpoint_number, uint8_t status, void const* data, uint16_t size);
+
+/**
+ * @brief Function for taking the next packet of an enabled IN endpoint from its TxFIFO.
+ * @param[in] endpoint_number is the number of the IN endpoint.
+ * @param[in] packet is the buffer for the packet, NULL to drop it.
+ * @return the size of the packet, or @ref USB_SIM_NAK if the endpoint is not enabled or its packet
+ *         is not in the TxFIFO yet.
+ */
+static int32_t sim_transmit(uint8_t endpoint_number, void* packet);
+
+/**
+ * @brief Function for polling the device while an endpoint NAKs.
+ * @param[in] ready is the function which returns whether the endpoint does not NAK anymore.
+ * @param[in] endpoint_number is the number of the endpoint.
+ * @return true if the endpoint is ready, false if the device gave up.
+ */
+static bool sim_wait(bool (*ready)(uint8_t endpoint_number), uint8_t endpoint_number);
+
+/**
+ * @brief Function for checking whether the TxFIFO of an IN endpoint holds the next packet.
+ * @param[in] endpoint_number is the number of the IN endpoint.
+ * @return true if the packet can be sent.
+ */
+static bool sim_in_ready(uint8_t endpoint_number);
+
+/**
+ * @brief Function for checking whether an OUT endpoint is enabled for receiving.
+ * @param[in] endpoint_number is the number of the OUT endpoint.
+ * @return true if the packet can be received.
+ */
+static bool sim_out_ready(uint8_t endpoint_number);
+
+/***************************************************************************************************/
+/*                                       Static Variables                                          */
+/***************************************************************************************************/
+
+/** @brief RxFIFO shared by all OUT endpoints */
+static USB_Sim_FIFO_t sim_rx_fifo;
+/** @brief TxFIFOs of the IN endpoints */
+static USB_Sim_FIFO_t sim_tx_fifo[USB_SIM_ENDPOINTS];
+/** @brief Number of polls of the device */
+static uint32_t sim_polls;
+
+/***************************************************************************************************/
+/*                                       Public API Definitions                                    */
+/***************************************************************************************************/
+
+void USB_Sim_Init(void)
+{
+    static bool mapped = false;
+
+    if(!mapped){
+        sim_map(USB_SIM_PERIPHERALS_BASE, USB_SIM_PERIPHERALS_SIZE);
+        sim_map(USB_SIM_UID_PAGE, USB_SIM_UID_PAGE_SIZE);
+        sim_map(FLASH_BASE, USB_SIM_FLASH_SIZE);
+        memset((void*)FLASH_BASE, 0xFF, USB_SIM_FLASH_SIZE);
+        mapped = true;
+    }
+    /* The registers are reset at each initialization, the fuzz target starts every input with it */
+    memset((void*)USB_SIM_PERIPHERALS_BASE, 0, USB_SIM_PERIPHERALS_SIZE);
+
+    /* A fixed unique device ID, so the serial number string is always the same */
+    ((uint32_t*)UID_BASE)[0] = 0x00430038;
+    ((uint32_t*)UID_BASE)[1] = 0x31385118;
+    ((uint32_t*)UID_BASE)[2] = 0x34303330;
+
+    memset(&sim_rx_fifo, 0, sizeof(sim_rx_fifo));
+    memset(sim_tx_fifo, 0, sizeof(sim_tx_fifo));
+    sim_polls = 0;
+}
+
+void USB_Sim_Poll(uint32_t events)
+{
+    USB_OTG_HS->GINTSTS = events;
+    USB_Device_Poll();
+    /* The driver clears the flags by writing ones, which the memory would keep */
+    USB_OTG_HS->GINTSTS = 0;
+    sim_polls++;
+
+    sim_update_fifos();
+}
+
+void USB_Sim_Bus_Reset(void)
+{
+    sim_rx_fifo.head = sim_rx_fifo.tail = 0;
+    for(uint8_t i = 0; i < USB_SIM_ENDPOINTS; i++){
+        sim_tx_fifo[i].head = sim_tx_fifo[i].tail = 0;
+    }
+
+    USB_Sim_Poll(USB_OTG_GINTSTS_USBRST);
+    USB_Sim_Poll(USB_OTG_GINTSTS_ENUMDNE);
+}
+
+void USB_Sim_Start_Of_Frame(void)
+{
+    USB_Sim_Poll(USB_OTG_GINTSTS_SOF);
+}
+
+int32_t USB_Sim_Control_Transfer(USB_Request_t const* request, void* data)
+{
+    uint8_t packet_size = _FLD2VAL(USB_OTG_DIEPCTL_MPSIZ, sim_in_endpoint(0)->DIEPCTL);
+    uint8_t packet_data[_FLD2VAL(USB_OTG_DIEPCTL_MPSIZ, USB_OTG_DIEPCTL_MPSIZ)];
+    int32_t size = 0;
+
+    /* A SETUP packet is always accepted, it clears the halt of the endpoint 0 */
+    CLEAR_BIT(sim_in_endpoint(0)->DIEPCTL, USB_OTG_DIEPCTL_STALL);
+    CLEAR_BIT(sim_out_endpoint(0)->DOEPCTL, USB_OTG_DOEPCTL_STALL);
+    sim_receive(0, USB_SIM_SETUP_DATA, request, sizeof(USB_Request_t));
+    sim_receive(0, USB_SIM_SETUP_COMPLETED, NULL, 0);
+
+    if(request->bmRequestType & USB_BM_REQUEST_TYPE_DIRECTION_TOHOST){
+        /* DATA IN stage, until a short packet or wLength bytes */
+        while(size < request->wLength){
+            if(!sim_wait(sim_in_ready, 0)){
+                return USB_SIM_STALL;
+            }
+            int32_t packet = sim_transmit(0, packet_data);
+            if(packet > (request->wLength - size)){
+                sim_fail("more data than requested in the DATA stage");
+            }
+            memcpy((uint8_t*)data + size, packet_data, packet);
+            size += packet;
+            sim_endpoint_interrupt(0, true, USB_OTG_DIEPINT_XFRC);
+            if(packet < packet_size){
+                break;
+            }
+        }
+        /* STATUS OUT stage */
+        if(!sim_wait(sim_out_ready, 0)){
+            return USB_SIM_STALL;
+        }
+        USB_Sim_Out_Packet(0, NULL, 0);
+    }
+    else{
+        /* DATA OUT stage */
+        while(size < request->wLength){
+            uint16_t packet = MIN(request->wLength - size, packet_size);
+
+            if(!sim_wait(sim_out_ready, 0)){
+                return USB_SIM_STALL;
+            }
+            USB_Sim_Out_Packet(0, (uint8_t const*)data + size, packet);
+            size += packet;
+        }
+        /* STATUS IN stage, a zero length packet */
+        if(!sim_wait(sim_in_ready, 0)){
+            return USB_SIM_STALL;
+        }
+        if(sim_transmit(0, NULL) != 0){
+            sim_fail("data sent in the STATUS stage");
+        }
+        sim_endpoint_interrupt(0, true, USB_OTG_DIEPINT_XFRC);
+    }
+
+    return size;
+}
+
+int32_t USB_Sim_In_Token(uint8_t endpoint_number, void* packet)
+{
+    USB_OTG_INEndpointTypeDef* in_endpoint = sim_in_endpoint(endpoint_number);
+    int32_t size;
+
+    if(in_endpoint->DIEPCTL & USB_OTG_DIEPCTL_STALL){
+        return USB_SIM_STALL;
+    }
+    size = sim_transmit(endpoint_number, packet);
+    if(size == USB_SIM_NAK){
+        return USB_SIM_NAK;
+    }
+
+    /* The transfer completes with its last packet, otherwise the driver may refill the TxFIFO */
+    if(!(in_endpoint->DIEPCTL & USB_OTG_DIEPCTL_EPENA)){
+        sim_endpoint_interrupt(endpoint_number, true, USB_OTG_DIEPINT_XFRC);
+    }
+    else if(USB_OTG_HS_DEVICE->DIEPEMPMSK & (1 << endpoint_number)){
+        sim_endpoint_interrupt(endpoint_number, true, USB_OTG_DIEPINT_TXFE);
+    }
+
+    return size;
+}
+
+int32_t USB_Sim_Out_Packet(uint8_t endpoint_number, void const* packet, uint16_t size)
+{
+    USB_OTG_OUTEndpointTypeDef* out_endpoint = sim_out_endpoint(endpoint_number);
+    uint32_t transfer_size = _FLD2VAL(USB_OTG_DOEPTSIZ_XFRSIZ, out_endpoint->DOEPTSIZ);
+    uint32_t packet_count = _FLD2VAL(USB_OTG_DOEPTSIZ_PKTCNT, out_endpoint->DOEPTSIZ);
+    uint16_t packet_size = USB_Sim_Get_Out_Packet_Size(endpoint_number);
+
+    if(out_endpoint->DOEPCTL & USB_OTG_DOEPCTL_STALL){
+        return USB_SIM_STALL;
+    }
+    if(!sim_out_ready(endpoint_number)){
+        return USB_SIM_NAK;
+    }
+    if((size > transfer_size) || (size > packet_size)){
+        sim_fail("OUT packet larger than the transfer");
+    }
+
+    transfer_size -= size;
+    packet_count--;
+    MODIFY_REG(
+        out_endpoint->DOEPTSIZ,
+        USB_OTG_DOEPTSIZ_PKTCNT | USB_OTG_DOEPTSIZ_XFRSIZ,
+        _VAL2FLD(USB_OTG_DOEPTSIZ_PKTCNT, packet_count) |
+        _VAL2FLD(USB_OTG_DOEPTSIZ_XFRSIZ, transfer_size)
+    );
+    sim_receive(endpoint_number, USB_SIM_OUT_DATA, packet, size);
+
+    /* The transfer completes with its last packet or a short packet */
+    if((packet_count == 0) || (size < packet_size)){
+        CLEAR_BIT(out_endpoint->DOEPCTL, USB_OTG_DOEPCTL_EPENA);
+        sim_receive(endpoint_number, USB_SIM_OUT_COMPLETED, NULL, 0);
+        sim_endpoint_interrupt(endpoint_number, false, USB_OTG_DOEPINT_XFRC);
+    }
+
+    return size;
+}
+
+uint16_t USB_Sim_Get_Out_Packet_Size(uint8_t endpoint_number)
+{
+    return (endpoint_number == 0) ?
+           _FLD2VAL(USB_OTG_DIEPCTL_MPSIZ, sim_in_endpoint(0)->DIEPCTL) :
+           _FLD2VAL(USB_OTG_DOEPCTL_MPSIZ, sim_out_endpoint(endpoint_number)->DOEPCTL);
+}
+
+uint32_t USB_Sim_Get_Polls(void)
+{
+    return sim_polls;
+}
+
+uint32_t USB_Sim_FIFO_Pop(__attribute__((unused)) uint32_t const volatile* fifo)
+{
+    if(sim_rx_fifo.head == sim_rx_fifo.tail){
+        sim_fail("RxFIFO popped while empty");
+    }
+
+    return sim_rx_fifo.words[sim_rx_fifo.head++];
+}
+
+void USB_Sim_FIFO_Push(uint32_t volatile* fifo, uint32_t data)
+{
+    uint8_t endpoint_number = ((uintptr_t)fifo - (USB_OTG_HS_PERIPH_BASE + USB_OTG_FIFO_BASE))/
+                              USB_OTG_FIFO_SIZE;
+    USB_Sim_FIFO_t* tx_fifo = &sim_tx_fifo[endpoint_number];
+
+    /* A flush requested before this push has already happened on the device */
+    sim_update_fifos();
+    if(_FLD2VAL(USB_OTG_DTXFSTS_INEPTFSAV, sim_in_endpoint(endpoint_number)->DTXFSTS) == 0){
+        sim_fail("TxFIFO pushed while full");
+    }
+
+    tx_fifo->words[tx_fifo->tail++] = data;
+    sim_update_fifos();
+}
+
+/***************************************************************************************************/
+/*                                       Static Function Definitions                               */
+/***************************************************************************************************/
+
+static USB_OTG_INEndpointTypeDef* sim_in_endpoint(uint8_t endpoint_number)
+{
+    return (USB_OTG_INEndpointTypeDef*)(USB_OTG_HS_PERIPH_BASE + USB_OTG_IN_ENDPOINT_BASE +
+                                        (endpoint_number * 0x20));
+}
+
+static USB_OTG_OUTEndpointTypeDef* sim_out_endpoint(uint8_t endpoint_number)
+{
+    return (USB_OTG_OUTEndpointTypeDef*)(USB_OTG_HS_PERIPH_BASE + USB_OTG_OUT_ENDPOINT_BASE +
+                                         (endpoint_number * 0x20));
+}
+
+static void sim_map(uintptr_t address, size_t size)
+{
+    void* memory = mmap((void*)address, size, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+
+    if(memory != (void*)address){
+        fprintf(stderr, "The registers at 0x%08lX can not be mapped\n", (unsigned long)address);
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void sim_fail(char const* message)
+{
+    fprintf(stderr, "Simulated core: %s\n", message);
+    abort();
+}
+
+static void sim_update_fifos(void)
+{
+    uint32_t reset_control = USB_OTG_HS->GRSTCTL;
+
+    /* The flushes complete at once */
+    if(reset_control & USB_OTG_GRSTCTL_RXFFLSH){
+        sim_rx_fifo.head = sim_rx_fifo.tail = 0;
+    }
+    if(reset_control & USB_OTG_GRSTCTL_TXFFLSH){
+        uint8_t flushed = _FLD2VAL(USB_OTG_GRSTCTL_TXFNUM, reset_control);
+
+        /* The number 0x10 flushes all the TxFIFOs */
+        for(uint8_t i = 0; i < USB_SIM_ENDPOINTS; i++){
+            if((flushed == 0x10) || (flushed == i)){
+                sim_tx_fifo[i].head = sim_tx_fifo[i].tail = 0;
+            }
+        }
+    }
+    CLEAR_BIT(USB_OTG_HS->GRSTCTL, USB_OTG_GRSTCTL_RXFFLSH | USB_OTG_GRSTCTL_TXFFLSH);
+
+    for(uint8_t i = 0; i < USB_SIM_ENDPOINTS; i++){
+        uint16_t depth = (i == 0) ? _FLD2VAL(USB_OTG_TX0FD, USB_OTG_HS->DIEPTXF0_HNPTXFSIZ) :
+                                    _FLD2VAL(USB_OTG_NPTXFD, USB_OTG_HS->DIEPTXF[i - 1]);
+        uint16_t used = sim_tx_fifo[i].tail - sim_tx_fifo[i].head;
+
+        /* The words taken from the TxFIFO are moved out, so the FIFO never wraps */
+        if(sim_tx_fifo[i].head > 0){
+            memmove(sim_tx_fifo[i].words, &sim_tx_fifo[i].words[sim_tx_fifo[i].head],
+                    used*sizeof(uint32_t));
+            sim_tx_fifo[i].head = 0;
+            sim_tx_fifo[i].tail = used;
+        }
+        WRITE_REG(sim_in_endpoint(i)->DTXFSTS, (depth > used) ? (depth - used) : 0);
+    }
+}
+
+static void sim_endpoint_interrupt(uint8_t endpoint_number, bool in, uint32_t flags)
+{
+    if(in){
+        USB_OTG_HS_DEVICE->DAINT = 1 << endpoint_number;
+        sim_in_endpoint(endpoint_number)->DIEPINT = flags;
+        USB_Sim_Poll(USB_OTG_GINTSTS_IEPINT);
+        sim_in_endpoint(endpoint_number)->DIEPINT = 0;
+    }
+    else{
+        USB_OTG_HS_DEVICE->DAINT = 1 << 16 << endpoint_number;
+        sim_out_endpoint(endpoint_number)->DOEPINT = flags;
+        USB_Sim_Poll(USB_OTG_GINTSTS_OEPINT);
+        sim_out_endpoint(endpoint_number)->DOEPINT = 0;
+    }
+    USB_OTG_HS_DEVICE->DAINT = 0;
+}
+
+static void sim_receive(uint8_t endpoint_number, uint8_t status, void const* data, uint16_t size)
+{
+    sim_rx_fifo.head = sim_rx_fifo.tail = 0;
+    for(uint16_t i = 0; i < size; i += 4){
+        uint32_t word = 0;
+
+        memcpy(&word, (uint8_t const*)data + i, MIN(size - i, 4));
+        sim_rx_fifo.words[sim_rx_fifo.tail++] = word;
+    }
+
+    USB_OTG_HS->GRXSTSP = _VAL2FLD(USB_OTG_GRXSTSP_EPNUM, endpoint_number) |
+                          _VAL2FLD(USB_OTG_GRXSTSP_BCNT, size) |
+                          _VAL2FLD(USB_OTG_GRXSTSP_PKTSTS, status);
+    USB_Sim_Poll(USB_OTG_GINTSTS_RXFLVL);
+
+    if(sim_rx_fifo.head != sim_rx_fifo.tail){
+        sim_fail("packet not popped from the RxFIFO");
+    }
+}
+
+static int32_t sim_transmit(uint8_t endpoint_number, void* packet)
+{
+    USB_OTG_INEndpointTypeDef* in_endpoint = sim_in_endpoint(endpoint_number);
+    USB_Sim_FIFO_t* tx_fifo = &sim_tx_fifo[endpoint_number];
+    uint32_t transfer_size = _FLD2VAL(USB_OTG_DIEPTSIZ_XFRSIZ, in_endpoint->DIEPTSIZ);
+    uint32_t packet_count = _FLD2VAL(USB_OTG_DIEPTSIZ_PKTCNT, in_endpoint->DIEPTSIZ);
+    uint16_t size = MIN(transfer_size, _FLD2VAL(USB_OTG_DIEPCTL_MPSIZ, in_endpoint->DIEPCTL));
+    uint16_t words = (size + 3)/4;
+
+    if(!sim_in_ready(endpoint_number)){
+        return USB_SIM_NAK;
+    }
+
+    if(packet != NULL){
+        memcpy(packet, &tx_fifo->words[tx_fifo->head], size);
+    }
+    tx_fifo->head += words;
+    sim_update_fifos();
+
+    transfer_size -= size;
+    packet_count--;
+    MODIFY_REG(
+        in_endpoint->DIEPTSIZ,
+        USB_OTG_DIEPTSIZ_PKTCNT | USB_OTG_DIEPTSIZ_XFRSIZ,
+        _VAL2FLD(USB_OTG_DIEPTSIZ_PKTCNT, packet_count) |
+        _VAL2FLD(USB_OTG_DIEPTSIZ_XFRSIZ, transfer_size)
+    );
+    if(packet_count == 0){
+        CLEAR_BIT(in_endpoint->DIEPCTL, USB_OTG_DIEPCTL_EPENA);
+    }
+
+    return size;
+}
+
+static bool sim_wait(bool (*ready)(uint8_t endpoint_number), uint8_t endpoint_number)
+{
+    for(uint32_t i = 0; i < USB_SIM_NAK_LIMIT; i++){
+        if((sim_in_endpoint(endpoint_number)->DIEPCTL & USB_OTG_DIEPCTL_STALL) ||
+           (sim_out_endpoint(endpoint_number)->DOEPCTL & USB_OTG_DOEPCTL_STALL)){
+            return false;
+        }
+        if(ready(endpoint_number)){
+            return true;
+        }
+        USB_Sim_Poll(0);
+    }
+
+    sim_fail("endpoint NAKed until the host gave up");
+    return false;
+}
+
+static bool sim_in_ready(uint8_t endpoint_number)
+{
+    USB_OTG_INEndpointTypeDef* in_endpoint = sim_in_endpoint(endpoint_number);
+    USB_Sim_FIFO_t const* tx_fifo = &sim_tx_fifo[endpoint_number];
+    uint16_t size = MIN(_FLD2VAL(USB_OTG_DIEPTSIZ_XFRSIZ, in_endpoint->DIEPTSIZ),
+                        _FLD2VAL(USB_OTG_DIEPCTL_MPSIZ, in_endpoint->DIEPCTL));
+
+    return (in_endpoint->DIEPCTL & USB_OTG_DIEPCTL_EPENA) &&
+           ((tx_fifo->tail - tx_fifo->head)*4 >= size);
+}
+
+static bool sim_out_ready(uint8_t endpoint_number)
+{
+    return sim_out_endpoint(endpoint_number)->DOEPCTL & USB_OTG_DOEPCTL_EPENA;
+}
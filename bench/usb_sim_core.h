@@ -0,0 +1,135 @@
+/************************************************************************************************//**
+* @file usb_sim_core.h
+*
+* @brief Header file containing the prototypes of the APIs of the simulated OTG core, which runs the
+*        unmodified USB driver and middleware on the host for the benchmark.
+*
+* Public Functions:
+*       - void USB_Sim_Init(void)
+*       - void USB_Sim_Poll(uint32_t events)
+*       - void USB_Sim_Bus_Reset(void)
+*       - void USB_Sim_Start_Of_Frame(void)
+*       - int32_t USB_Sim_Control_Transfer(USB_Request_t const* request, void* data)
+*       - int32_t USB_Sim_In_Token(uint8_t endpoint_number, void* packet)
+*       - int32_t USB_Sim_Out_Packet(uint8_t endpoint_number, void const* packet, uint16_t size)
+*       - uint16_t USB_Sim_Get_Out_Packet_Size(uint8_t endpoint_number)
+*       - uint32_t USB_Sim_Get_Polls(void)
+*       - uint32_t USB_Sim_FIFO_Pop(uint32_t const volatile* fifo)
+*       - void USB_Sim_FIFO_Push(uint32_t volatile* fifo, uint32_t data)
+*
+* @note
+*       The registers of the core are plain memory mapped at their addresses on the device, the
+*       simulated core sets the interrupt and status registers before each poll of the device and
+*       plays the host side of the bus. The data FIFOs are the only registers which can not be
+*       plain memory, so this header is included in every source of the benchmark and replaces the
+*       FIFO accesses of the driver.
+*/
+
+#ifndef USB_SIM_CORE_H
+#define USB_SIM_CORE_H
+
+#include "usb_standards.h"
+#include <stdint.h>
+
+/** @brief The FIFO accesses of the driver go through the simulated FIFOs */
+#define USB_FIFO_POP(fifo)          USB_Sim_FIFO_Pop(fifo)
+#define USB_FIFO_PUSH(fifo, data)   USB_Sim_FIFO_Push(fifo, data)
+
+/**
+ * @defgroup USB_SIM_RESULTS Results of the host side transactions which are not a packet size.
+ * @{
+ */
+#define USB_SIM_NAK                 (-1)    /**< @brief The endpoint is not ready */
+#define USB_SIM_STALL               (-2)    /**< @brief The endpoint is halted */
+/** @} */
+
+/***************************************************************************************************/
+/*                                       APIs Supported                                            */
+/***************************************************************************************************/
+
+/**
+ * @brief Function for mapping the registers of the core and the flash, and resetting the registers
+ *        and the simulated FIFOs.
+ * @return void
+ * @note The memory is only mapped by the first call, the process is terminated if it can not be
+ *       mapped at the device addresses.
+ */
+void USB_Sim_Init(void);
+
+/**
+ * @brief Function for polling the device once with a set of interrupts of the core pending.
+ * @param[in] events is the value of the GINTSTS register during the poll, 0 for a poll without
+ *            events.
+ * @return void
+ */
+void USB_Sim_Poll(uint32_t events);
+
+/**
+ * @brief Function for signaling a bus reset followed by the enumeration of the full speed.
+ * @return void
+ */
+void USB_Sim_Bus_Reset(void);
+
+/**
+ * @brief Function for signaling the start of a frame.
+ * @return void
+ */
+void USB_Sim_Start_Of_Frame(void);
+
+/**
+ * @brief Function for running a whole control transfer from the host: SETUP, DATA and STATUS
+ *        stages, the device is polled while it NAKs.
+ * @param[in] request is the SETUP packet sent by the host.
+ * @param[in] data is the buffer for the DATA stage, it is received into for device to host
+ *            requests and sent for the rest, it is unused if wLength is 0.
+ * @return the number of bytes of the DATA stage, or @ref USB_SIM_STALL if the request is stalled.
+ * @note The process is aborted if the device does not complete a stage.
+ */
+int32_t USB_Sim_Control_Transfer(USB_Request_t const* request, void* data);
+
+/**
+ * @brief Function for sending an IN token to a non control endpoint.
+ * @param[in] endpoint_number is the number of the IN endpoint.
+ * @param[in] packet is the buffer for receiving the packet, of the maximum packet size at least.
+ * @return the size of the packet received, @ref USB_SIM_NAK or @ref USB_SIM_STALL.
+ */
+int32_t USB_Sim_In_Token(uint8_t endpoint_number, void* packet);
+
+/**
+ * @brief Function for sending an OUT packet to a non control endpoint.
+ * @param[in] endpoint_number is the number of the OUT endpoint.
+ * @param[in] packet is the data of the packet.
+ * @param[in] size is the size of the packet, up to the maximum packet size of the endpoint.
+ * @return the size of the packet when it is accepted, @ref USB_SIM_NAK or @ref USB_SIM_STALL.
+ */
+int32_t USB_Sim_Out_Packet(uint8_t endpoint_number, void const* packet, uint16_t size);
+
+/**
+ * @brief Function for getting the maximum packet size of an OUT endpoint.
+ * @param[in] endpoint_number is the number of the OUT endpoint.
+ * @return the maximum packet size configured by the driver, 0 if the endpoint is not configured.
+ */
+uint16_t USB_Sim_Get_Out_Packet_Size(uint8_t endpoint_number);
+
+/**
+ * @brief Function for getting the number of polls of the device since the initialization.
+ * @return the number of polls.
+ */
+uint32_t USB_Sim_Get_Polls(void);
+
+/**
+ * @brief Function for popping a word from the RxFIFO, it is used by the driver.
+ * @param[in] fifo is the address of the FIFO accessed by the driver.
+ * @return the word popped.
+ */
+uint32_t USB_Sim_FIFO_Pop(uint32_t const volatile* fifo);
+
+/**
+ * @brief Function for pushing a word into the TxFIFO of an endpoint, it is used by the driver.
+ * @param[in] fifo is the address of the FIFO of the endpoint accessed by the driver.
+ * @param[in] data is the word pushed.
+ * @return void
+ */
+void USB_Sim_FIFO_Push(uint32_t volatile* fifo, uint32_t data);
+
+#endif /* USB_SIM_CORE_H */
@@ -0,0 +1,124 @@
+/************************************************************************************************//**
+* @file clock_driver.c
+*
+* @brief File containing the APIs for configuring the clock profile of the device.
+*
+* Public Functions:
+*       - void Clock_Init(void)
+*
+* @note
+*       For further information about functions refer to the corresponding header file.
+**/
+
+#include "clock_driver.h"
+#include "stm32f4xx.h"
+#include <stdint.h>
+
+_Static_assert(CLOCK_SYSCLK_HZ <= CLOCK_SYSCLK_MAX_HZ, "The system clock is above 180 MHz");
+_Static_assert(CLOCK_PLLP != 0,
+               "No PLL configuration gives the system clock and 48 MHz for the USB core, e.g. 180 "
+               "MHz needs a VCO of 360 MHz which can not be divided into 48 MHz");
+_Static_assert((CLOCK_HSE_HZ % CLOCK_VCO_INPUT_HZ) == 0, "The HSE can not be divided into 2 MHz");
+_Static_assert((CLOCK_PLLM >= 2) && (CLOCK_PLLM <= 63), "PLLM is out of range");
+_Static_assert((CLOCK_PLLN >= 50) && (CLOCK_PLLN <= 432), "PLLN is out of range");
+_Static_assert((CLOCK_PLLQ >= 2) && (CLOCK_PLLQ <= 15), "PLLQ is out of range");
+_Static_assert(CLOCK_FLASH_LATENCY <= 7, "The flash latency is out of range");
+
+/** @brief Value of the PPRE fields of the RCC_CFGR register for a division of the clock */
+#define CLOCK_PPRE(divider)         (((divider) == 1) ? 0 : ((divider) == 2) ? 4 :                  \
+                                     ((divider) == 4) ? 5 : ((divider) == 8) ? 6 : 7)
+/** @brief Value of the VOS field of the PWR_CR register for a voltage scale */
+#define CLOCK_VOS(scale)            (4 - (scale))
+
+/***************************************************************************************************/
+/*                                       Static Function Prototypes                                */
+/***************************************************************************************************/
+
+/**
+ * @brief Function for setting the flash wait states of the clock profile and enabling the ART
+ *        accelerator, the prefetch and the instruction and data caches.
+ * @return void
+ */
+static void Clock_Configure_Flash(void);
+
+/***************************************************************************************************/
+/*                                       Public API Definitions                                    */
+/***************************************************************************************************/
+
+void Clock_Init(void)
+{
+    /* The voltage scale is applied once the PLL is enabled */
+    SET_BIT(RCC->APB1ENR, RCC_APB1ENR_PWREN);
+    MODIFY_REG(PWR->CR, PWR_CR_VOS, _VAL2FLD(PWR_CR_VOS, CLOCK_VOS(CLOCK_VOLTAGE_SCALE)));
+
+    /* Enable HSE */
+    SET_BIT(RCC->CR, RCC_CR_HSEON);
+
+    /* Wait until HSE is stable */
+    while(!READ_BIT(RCC->CR, RCC_CR_HSERDY));
+
+    /* Configure PLL, P is encoded as P/2 - 1 */
+    MODIFY_REG(
+        RCC->PLLCFGR,
+        RCC_PLLCFGR_PLLM | RCC_PLLCFGR_PLLN | RCC_PLLCFGR_PLLQ | RCC_PLLCFGR_PLLSRC |
+        RCC_PLLCFGR_PLLP,
+        _VAL2FLD(RCC_PLLCFGR_PLLM, CLOCK_PLLM) | _VAL2FLD(RCC_PLLCFGR_PLLN, CLOCK_PLLN) |
+        _VAL2FLD(RCC_PLLCFGR_PLLQ, CLOCK_PLLQ) | _VAL2FLD(RCC_PLLCFGR_PLLSRC, 1) |
+        _VAL2FLD(RCC_PLLCFGR_PLLP, CLOCK_PLLP/2 - 1));
+
+    /* Enable PLL */
+    SET_BIT(RCC->CR, RCC_CR_PLLON);
+
+    /* Wait until PLL is stable */
+    while(!READ_BIT(RCC->CR, RCC_CR_PLLRDY));
+
+#if CLOCK_OVERDRIVE
+    /* The over-drive is enabled while the system clock is not the PLL, then the regulator is
+       switched to it */
+    SET_BIT(PWR->CR, PWR_CR_ODEN);
+    while(!READ_BIT(PWR->CSR, PWR_CSR_ODRDY));
+    SET_BIT(PWR->CR, PWR_CR_ODSWEN);
+    while(!READ_BIT(PWR->CSR, PWR_CSR_ODSWRDY));
+#endif
+
+    /* The flash must be slowed down before the system clock is increased */
+    Clock_Configure_Flash();
+
+    /* Configure PPRE1 and PPRE2 */
+    MODIFY_REG(
+        RCC->CFGR,
+        RCC_CFGR_PPRE1 | RCC_CFGR_PPRE2,
+        _VAL2FLD(RCC_CFGR_PPRE1, CLOCK_PPRE(CLOCK_APB1_DIVIDER)) |
+        _VAL2FLD(RCC_CFGR_PPRE2, CLOCK_PPRE(CLOCK_APB2_DIVIDER))
+    );
+
+    /* Switch system clock to PLL */
+    MODIFY_REG(RCC->CFGR, RCC_CFGR_SW, _VAL2FLD(RCC_CFGR_SW, RCC_CFGR_SW_PLL));
+
+    /* Wait until PLL is used */
+    while(READ_BIT(RCC->CFGR, RCC_CFGR_SWS) != RCC_CFGR_SWS_PLL);
+
+    /* Disable HSI */
+    CLEAR_BIT(RCC->CR, RCC_CR_HSION);
+}
+
+/***************************************************************************************************/
+/*                                       Static Function Definitions                               */
+/***************************************************************************************************/
+
+static void Clock_Configure_Flash(void)
+{
+    /* Configure FLASH latency, and wait until it is applied */
+    MODIFY_REG(FLASH->ACR, FLASH_ACR_LATENCY, _VAL2FLD(FLASH_ACR_LATENCY, CLOCK_FLASH_LATENCY));
+    while(_FLD2VAL(FLASH_ACR_LATENCY, READ_REG(FLASH->ACR)) != CLOCK_FLASH_LATENCY);
+
+    /* The caches can only be reset while they are disabled, e.g. when waking up from stop mode
+       they are still enabled */
+    if(!READ_BIT(FLASH->ACR, FLASH_ACR_ICEN | FLASH_ACR_DCEN)){
+        SET_BIT(FLASH->ACR, FLASH_ACR_ICRST | FLASH_ACR_DCRST);
+        CLEAR_BIT(FLASH->ACR, FLASH_ACR_ICRST | FLASH_ACR_DCRST);
+    }
+
+    /* Enable the ART accelerator */
+    SET_BIT(FLASH->ACR, FLASH_ACR_PRFTEN | FLASH_ACR_ICEN | FLASH_ACR_DCEN);
+}
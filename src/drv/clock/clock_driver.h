@@ -0,0 +1,85 @@
+/************************************************************************************************//**
+* @file clock_driver.h
+*
+* @brief Header file containing the clock profile of the device and the prototypes of the APIs for
+*        configuring it.
+*
+* Public Functions:
+*       - void Clock_Init(void)
+*
+* @note
+*       The clock profile is computed at compile time from the requested system clock
+*       (CLOCK_SYSCLK_HZ, set with the waf option --sysclk): the PLL dividers, which must also give
+*       the 48 MHz of the USB core, the flash wait states, the bus prescalers, the voltage scale and
+*       the over-drive. A system clock which can not be reached stops the build.
+*/
+
+#ifndef CLOCK_DRIVER_H
+#define CLOCK_DRIVER_H
+
+#include <stdint.h>
+
+/** @brief Frequency of the HSE crystal of the board */
+#define CLOCK_HSE_HZ                8000000UL
+#ifndef CLOCK_SYSCLK_HZ
+/** @brief Requested frequency of the system clock */
+#define CLOCK_SYSCLK_HZ             168000000UL
+#endif
+/** @brief Frequency of the clock of the USB core, taken from the Q output of the PLL */
+#define CLOCK_USB_HZ                48000000UL
+
+/**
+ * @defgroup CLOCK_LIMITS Limits of the clock tree of the STM32F429.
+ * @{
+ */
+#define CLOCK_VCO_INPUT_HZ          2000000UL   /* Recommended for limiting the PLL jitter */
+#define CLOCK_VCO_MIN_HZ            100000000UL
+#define CLOCK_VCO_MAX_HZ            432000000UL
+#define CLOCK_SYSCLK_MAX_HZ         180000000UL
+#define CLOCK_OVERDRIVE_MIN_HZ      168000000UL /* Higher system clocks need the over-drive */
+#define CLOCK_APB1_MAX_HZ           45000000UL
+#define CLOCK_APB2_MAX_HZ           90000000UL
+#define CLOCK_FLASH_WAIT_STATE_HZ   30000000UL  /* Supply from 2.7 V to 3.6 V */
+/** @} */
+
+/** @brief Macro for checking whether the P divider of the PLL gives the system clock and a VCO
+ *         frequency in range which can be divided into the clock of the USB core */
+#define CLOCK_PLLP_VALID(p)                                                                     \
+    (((CLOCK_SYSCLK_HZ*(p)) >= CLOCK_VCO_MIN_HZ) &&                                             \
+     ((CLOCK_SYSCLK_HZ*(p)) <= CLOCK_VCO_MAX_HZ) &&                                             \
+     (((CLOCK_SYSCLK_HZ*(p)) % CLOCK_USB_HZ) == 0) &&                                           \
+     (((CLOCK_SYSCLK_HZ*(p)) % CLOCK_VCO_INPUT_HZ) == 0))
+
+/**
+ * @defgroup CLOCK_PROFILE Clock profile computed from the requested system clock.
+ * @{
+ */
+#define CLOCK_PLLP                  (CLOCK_PLLP_VALID(2) ? 2 : CLOCK_PLLP_VALID(4) ? 4 :            \
+                                     CLOCK_PLLP_VALID(6) ? 6 : CLOCK_PLLP_VALID(8) ? 8 : 0)
+#define CLOCK_VCO_HZ                (CLOCK_SYSCLK_HZ*CLOCK_PLLP)
+#define CLOCK_PLLM                  (CLOCK_HSE_HZ/CLOCK_VCO_INPUT_HZ)
+#define CLOCK_PLLN                  (CLOCK_VCO_HZ/CLOCK_VCO_INPUT_HZ)
+#define CLOCK_PLLQ                  (CLOCK_VCO_HZ/CLOCK_USB_HZ)
+#define CLOCK_FLASH_LATENCY         ((CLOCK_SYSCLK_HZ - 1)/CLOCK_FLASH_WAIT_STATE_HZ)
+#define CLOCK_APB1_DIVIDER          ((CLOCK_SYSCLK_HZ <= CLOCK_APB1_MAX_HZ) ? 1 :                   \
+                                     (CLOCK_SYSCLK_HZ <= 2*CLOCK_APB1_MAX_HZ) ? 2 :                 \
+                                     (CLOCK_SYSCLK_HZ <= 4*CLOCK_APB1_MAX_HZ) ? 4 : 8)
+#define CLOCK_APB2_DIVIDER          ((CLOCK_SYSCLK_HZ <= CLOCK_APB2_MAX_HZ) ? 1 :                   \
+                                     (CLOCK_SYSCLK_HZ <= 2*CLOCK_APB2_MAX_HZ) ? 2 : 4)
+#define CLOCK_VOLTAGE_SCALE         ((CLOCK_SYSCLK_HZ > 144000000UL) ? 1 :                          \
+                                     (CLOCK_SYSCLK_HZ > 120000000UL) ? 2 : 3)
+#define CLOCK_OVERDRIVE             (CLOCK_SYSCLK_HZ > CLOCK_OVERDRIVE_MIN_HZ)
+/** @} */
+
+/***************************************************************************************************/
+/*                                       APIs Supported                                            */
+/***************************************************************************************************/
+
+/**
+ * @brief Function for switching the system clock to the PLL with the clock profile, the flash
+ *        wait states, the ART accelerator and the over-drive are configured before.
+ * @return void
+ */
+void Clock_Init(void);
+
+#endif /* CLOCK_DRIVER_H */
@@ -0,0 +1,154 @@
+/************************************************************************************************//**
+* @file flash_driver.c
+*
+* @brief File containing the APIs for the embedded flash memory.
+*
+* Public Functions:
+*       - void Flash_Unlock(void)
+*       - void Flash_Lock(void)
+*       - bool Flash_Is_Busy(void)
+*       - uint32_t Flash_Get_Errors(void)
+*       - bool Flash_Get_Sector(uint32_t address, Flash_Sector_t* sector)
+*       - void Flash_Start_Sector_Erase(Flash_Sector_t const* sector)
+*       - void Flash_Start_Program_Word(uint32_t address, uint32_t word)
+*       - void Flash_Toggle_Boot_Bank(void)
+*
+* @note
+*       For further information about functions refer to the corresponding header file.
+**/
+
+#include "flash_driver.h"
+#include "stm32f4xx.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/** @brief Keys for unlocking the flash control register */
+#define FLASH_KEY1              0x45670123UL
+#define FLASH_KEY2              0xCDEF89ABUL
+/** @brief Keys for unlocking the option control register */
+#define FLASH_OPT_KEY1          0x08192A3BUL
+#define FLASH_OPT_KEY2          0x4C5D6E7FUL
+
+/** @brief Error flags of the status register */
+#define FLASH_SR_ERRORS         (FLASH_SR_WRPERR | FLASH_SR_PGAERR | FLASH_SR_PGPERR | \
+                                 FLASH_SR_PGSERR | FLASH_SR_RDERR)
+
+/** @brief Sizes of the sectors of a bank: four of 16 KB, one of 64 KB and seven of 128 KB */
+#define FLASH_SMALL_SECTOR_SIZE 0x4000UL
+#define FLASH_MEDIUM_SECTOR_SIZE 0x10000UL
+#define FLASH_LARGE_SECTOR_SIZE 0x20000UL
+/** @brief Offset of the SNB encoding of the sectors of the bank 2 */
+#define FLASH_BANK2_SECTOR_BASE 0x10
+
+/***************************************************************************************************/
+/*                                       Public API Definitions                                    */
+/***************************************************************************************************/
+
+void Flash_Unlock(void)
+{
+    if(READ_BIT(FLASH->CR, FLASH_CR_LOCK)){
+        WRITE_REG(FLASH->KEYR, FLASH_KEY1);
+        WRITE_REG(FLASH->KEYR, FLASH_KEY2);
+    }
+}
+
+void Flash_Lock(void)
+{
+    CLEAR_BIT(FLASH->CR, FLASH_CR_PG | FLASH_CR_SER);
+    SET_BIT(FLASH->CR, FLASH_CR_LOCK);
+}
+
+bool Flash_Is_Busy(void)
+{
+    return READ_BIT(FLASH->SR, FLASH_SR_BSY) != 0;
+}
+
+uint32_t Flash_Get_Errors(void)
+{
+    uint32_t errors = READ_BIT(FLASH->SR, FLASH_SR_ERRORS);
+
+    /* The flags are cleared writing them to 1 */
+    WRITE_REG(FLASH->SR, errors);
+    return errors;
+}
+
+bool Flash_Get_Sector(uint32_t address, Flash_Sector_t* sector)
+{
+    uint32_t offset = address - FLASH_BASE;
+    uint32_t bank_offset = offset % FLASH_BANK_SIZE;
+    uint8_t index = 0;
+    bool physical_bank2 = (offset >= FLASH_BANK_SIZE);
+
+    if((address < FLASH_BASE) || (address > FLASH_END)){
+        return false;
+    }
+
+    /* The sector numbers refer to the physical banks, which are swapped when booting from bank 2 */
+    if(READ_BIT(SYSCFG->MEMRMP, SYSCFG_MEMRMP_UFB_MODE)){
+        physical_bank2 = !physical_bank2;
+    }
+
+    if(bank_offset < (4*FLASH_SMALL_SECTOR_SIZE)){
+        index = bank_offset/FLASH_SMALL_SECTOR_SIZE;
+        sector->size = FLASH_SMALL_SECTOR_SIZE;
+    }
+    else if(bank_offset < FLASH_LARGE_SECTOR_SIZE){
+        index = 4;
+        sector->size = FLASH_MEDIUM_SECTOR_SIZE;
+    }
+    else{
+        index = 4 + bank_offset/FLASH_LARGE_SECTOR_SIZE;
+        sector->size = FLASH_LARGE_SECTOR_SIZE;
+    }
+
+    sector->address = address - (bank_offset % sector->size);
+    sector->number = physical_bank2 ? (FLASH_BANK2_SECTOR_BASE + index) : index;
+    return true;
+}
+
+void Flash_Start_Sector_Erase(Flash_Sector_t const* sector)
+{
+    /* The data cache of the ART accelerator may keep the old contents of the sector, it can only be
+       reset while disabled */
+    if(READ_BIT(FLASH->ACR, FLASH_ACR_DCEN)){
+        CLEAR_BIT(FLASH->ACR, FLASH_ACR_DCEN);
+        SET_BIT(FLASH->ACR, FLASH_ACR_DCRST);
+        CLEAR_BIT(FLASH->ACR, FLASH_ACR_DCRST);
+        SET_BIT(FLASH->ACR, FLASH_ACR_DCEN);
+    }
+
+    /* Erase with 32 bit parallelism (supply voltage from 2.7 V to 3.6 V) */
+    MODIFY_REG(
+        FLASH->CR,
+        FLASH_CR_PG | FLASH_CR_SNB | FLASH_CR_PSIZE,
+        FLASH_CR_SER | _VAL2FLD(FLASH_CR_SNB, sector->number) | FLASH_CR_PSIZE_1
+    );
+    SET_BIT(FLASH->CR, FLASH_CR_STRT);
+}
+
+void Flash_Start_Program_Word(uint32_t address, uint32_t word)
+{
+    MODIFY_REG(FLASH->CR, FLASH_CR_SER | FLASH_CR_PSIZE, FLASH_CR_PG | FLASH_CR_PSIZE_1);
+
+    /* Writing the word starts the programming */
+    *(volatile uint32_t*)address = word;
+}
+
+void Flash_Toggle_Boot_Bank(void)
+{
+    WRITE_REG(FLASH->OPTKEYR, FLASH_OPT_KEY1);
+    WRITE_REG(FLASH->OPTKEYR, FLASH_OPT_KEY2);
+
+    while(Flash_Is_Busy()){
+        /* wait for the ongoing operation */
+    }
+
+    FLASH->OPTCR ^= FLASH_OPTCR_BFB2;
+    SET_BIT(FLASH->OPTCR, FLASH_OPTCR_OPTSTRT);
+
+    while(Flash_Is_Busy()){
+        /* wait for the option bytes to be programmed */
+    }
+
+    SET_BIT(FLASH->OPTCR, FLASH_OPTCR_OPTLOCK);
+}
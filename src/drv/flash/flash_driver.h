@@ -0,0 +1,107 @@
+/************************************************************************************************//**
+* @file flash_driver.h
+*
+* @brief Header file containing the prototypes of the APIs for the embedded flash memory.
+*
+* Public Functions:
+*       - void Flash_Unlock(void)
+*       - void Flash_Lock(void)
+*       - bool Flash_Is_Busy(void)
+*       - uint32_t Flash_Get_Errors(void)
+*       - bool Flash_Get_Sector(uint32_t address, Flash_Sector_t* sector)
+*       - void Flash_Start_Sector_Erase(Flash_Sector_t const* sector)
+*       - void Flash_Start_Program_Word(uint32_t address, uint32_t word)
+*       - void Flash_Toggle_Boot_Bank(void)
+*
+* @note
+*       The 2 MB flash memory is made of two banks of 1 MB. The bank not holding the running firmware
+*       can be erased and programmed while the code keeps being fetched from the other one, so the
+*       erase and program operations are only started here and their end is polled with
+*       Flash_Is_Busy.
+*/
+
+#ifndef FLASH_DRIVER_H
+#define FLASH_DRIVER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/** @brief Size of a flash bank in bytes */
+#define FLASH_BANK_SIZE                 0x00100000UL
+/** @brief Address of the bank which is not running the firmware, the banks are swapped on boot so
+ *         the running firmware is always mapped at the start of the flash */
+#define FLASH_INACTIVE_BANK_ADDRESS     (0x08000000UL + FLASH_BANK_SIZE)
+
+/**
+ * @brief Struct with the location of a flash sector.
+ */
+typedef struct
+{
+    /** @brief Address of the first byte of the sector */
+    uint32_t address;
+    /** @brief Size of the sector in bytes */
+    uint32_t size;
+    /** @brief Number of the sector with the encoding of the SNB field (bank 2 starts at 0x10) */
+    uint8_t number;
+}Flash_Sector_t;
+
+/***************************************************************************************************/
+/*                                       APIs Supported                                            */
+/***************************************************************************************************/
+
+/**
+ * @brief Function for unlocking the flash control register, so it can be erased and programmed.
+ * @return void
+ */
+void Flash_Unlock(void);
+
+/**
+ * @brief Function for locking the flash control register again.
+ * @return void
+ */
+void Flash_Lock(void);
+
+/**
+ * @brief Function for checking if an erase or program operation is ongoing.
+ * @return true if the flash memory is busy, false otherwise.
+ */
+bool Flash_Is_Busy(void);
+
+/**
+ * @brief Function for getting and clearing the errors of the finished operations.
+ * @return the error flags of the status register, 0 if there are no errors.
+ */
+uint32_t Flash_Get_Errors(void);
+
+/**
+ * @brief Function for getting the sector which holds an address.
+ * @param[in] address is the address inside the flash memory.
+ * @param[out] sector is a pointer where the location of the sector is returned.
+ * @return true if the address is inside the flash memory, false otherwise.
+ */
+bool Flash_Get_Sector(uint32_t address, Flash_Sector_t* sector);
+
+/**
+ * @brief Function for starting the erase of a sector, the flash must be unlocked and not busy.
+ * @param[in] sector is a pointer to the sector to be erased.
+ * @return void
+ */
+void Flash_Start_Sector_Erase(Flash_Sector_t const* sector);
+
+/**
+ * @brief Function for starting the programming of a 32 bit word, the flash must be unlocked and not
+ *        busy.
+ * @param[in] address is the address of the word, it must be aligned to 4 bytes and erased.
+ * @param[in] word is the value to be programmed.
+ * @return void
+ */
+void Flash_Start_Program_Word(uint32_t address, uint32_t word);
+
+/**
+ * @brief Function for selecting the other bank for booting, it takes effect on the next reset.
+ * @return void
+ * @note It blocks until the option bytes are programmed.
+ */
+void Flash_Toggle_Boot_Bank(void);
+
+#endif /* FLASH_DRIVER_H */
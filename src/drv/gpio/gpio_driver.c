@@ -5,6 +5,7 @@
 *
 * Public Functions:
 *       - void GPIO_Init(void)
+*       - bool GPIO_Read_User_Button(void)
 *
 * @note
 *       For further information about functions refer to the corresponding header file.
@@ -13,9 +14,17 @@
 #include "gpio_driver.h"
 #include "stm32f4xx.h"
 #include <stdint.h>
+#include <stdbool.h>
 
 void GPIO_Init(void)
 {
+    /* Enable GPIOA Clock */
+    SET_BIT(RCC->AHB1ENR, RCC_AHB1ENR_GPIOAEN);
+
+    /* Configure the user button pin PA0 as input, the board has its pull-down resistor */
+    CLEAR_BIT(GPIOA->MODER, GPIO_MODER_MODER0);
+    CLEAR_BIT(GPIOA->PUPDR, GPIO_PUPDR_PUPD0);
+
     /* Enable GPIOB Clock */
     SET_BIT(RCC->AHB1ENR, RCC_AHB1ENR_GPIOBEN);
 
@@ -32,4 +41,9 @@ void GPIO_Init(void)
         GPIO_MODER_MODER14 | GPIO_MODER_MODER15,
         _VAL2FLD(GPIO_MODER_MODER14, 2) | _VAL2FLD(GPIO_MODER_MODER15, 2)
     );
+}
+
+bool GPIO_Read_User_Button(void)
+{
+    return READ_BIT(GPIOA->IDR, GPIO_IDR_ID0) != 0;
 }
\ No newline at end of file
@@ -5,10 +5,19 @@
 *
 * Public Functions:
 *       - void GPIO_Init(void)
+*       - bool GPIO_Read_User_Button(void)
 */
 
+#include <stdbool.h>
+
 /**
  * @brief Function for initializing the GPIOs.
  * @return void.
  */
-void GPIO_Init(void);
\ No newline at end of file
+void GPIO_Init(void);
+
+/**
+ * @brief Function for reading the user button (PA0) of the board.
+ * @return true if the button is pressed.
+ */
+bool GPIO_Read_User_Button(void);
\ No newline at end of file
@@ -0,0 +1,114 @@
+/************************************************************************************************//**
+* @file power_driver.c
+*
+* @brief File containing the APIs for the low power modes.
+*
+* Public Functions:
+*       - void Power_Init(void)
+*       - uint32_t Power_Enter_Low_Power(PowerMode_t mode)
+*
+* @note
+*       For further information about functions refer to the corresponding header file.
+**/
+
+#include "power_driver.h"
+#include "cycle_counter.h"
+#include "system_stm32f4xx.h"
+#include "stm32f4xx.h"
+#include <stdint.h>
+
+/** @brief Frequency of the HSI oscillator, which clocks the core when it wakes up */
+#define POWER_HSI_FREQUENCY         16000000UL
+/** @brief EXTI line of the wakeup event of the USB OTG HS core */
+#define POWER_USB_WAKEUP_LINE       EXTI_IMR_MR20
+/** @brief EXTI line of the user button (PA0), the application input wakes the device up too */
+#define POWER_BUTTON_WAKEUP_LINE    EXTI_IMR_MR0
+
+/***************************************************************************************************/
+/*                                       Static Function Prototypes                                */
+/***************************************************************************************************/
+
+/**
+ * @brief Function for switching the system clock to the HSI and stopping the PLL and the HSE.
+ * @return void
+ */
+static void Power_Drop_System_Clock(void);
+
+/***************************************************************************************************/
+/*                                       Public API Definitions                                    */
+/***************************************************************************************************/
+
+void Power_Init(void)
+{
+    /* Enable the clock of the power controller */
+    SET_BIT(RCC->APB1ENR, RCC_APB1ENR_PWREN);
+
+    /* The stop mode turns the regulator to low power mode, and never enters the standby mode */
+    MODIFY_REG(PWR->CR, PWR_CR_PDDS | PWR_CR_LPDS, PWR_CR_LPDS);
+
+    /* The USB core and the user button wake the device up from the stop mode through the rising
+       edge of their lines, PA0 is the default source of the EXTI line 0 */
+    SET_BIT(EXTI->IMR, POWER_USB_WAKEUP_LINE | POWER_BUTTON_WAKEUP_LINE);
+    SET_BIT(EXTI->RTSR, POWER_USB_WAKEUP_LINE | POWER_BUTTON_WAKEUP_LINE);
+}
+
+uint32_t Power_Enter_Low_Power(PowerMode_t mode)
+{
+    uint32_t wakeup_cycles;
+
+    /* The core wakes up on the enabled lines, but their handlers are not run while masked */
+    __disable_irq();
+    NVIC_EnableIRQ(OTG_HS_IRQn);
+    NVIC_EnableIRQ(OTG_HS_WKUP_IRQn);
+    NVIC_EnableIRQ(EXTI0_IRQn);
+
+    if(mode == POWER_MODE_STOP){
+        SET_BIT(SCB->SCR, SCB_SCR_SLEEPDEEP_Msk);
+    }
+    else{
+        Power_Drop_System_Clock();
+    }
+
+    __DSB();
+    __WFI();
+
+    /* The core runs from the HSI until SystemInit switches it back to the PLL */
+    wakeup_cycles = Cycle_Counter_Get();
+    CLEAR_BIT(SCB->SCR, SCB_SCR_SLEEPDEEP_Msk);
+    SystemInit();
+    wakeup_cycles = Cycle_Counter_Get() - wakeup_cycles;
+
+    /* The wakeup event is served by polling the USB core and the user button */
+    WRITE_REG(EXTI->PR, POWER_USB_WAKEUP_LINE | POWER_BUTTON_WAKEUP_LINE);
+    NVIC_DisableIRQ(OTG_HS_IRQn);
+    NVIC_DisableIRQ(OTG_HS_WKUP_IRQn);
+    NVIC_DisableIRQ(EXTI0_IRQn);
+    NVIC_ClearPendingIRQ(OTG_HS_IRQn);
+    NVIC_ClearPendingIRQ(OTG_HS_WKUP_IRQn);
+    NVIC_ClearPendingIRQ(EXTI0_IRQn);
+    __enable_irq();
+
+    return wakeup_cycles/(POWER_HSI_FREQUENCY/1000000UL);
+}
+
+/***************************************************************************************************/
+/*                                       Static Function Definitions                               */
+/***************************************************************************************************/
+
+static void Power_Drop_System_Clock(void)
+{
+    /* Enable HSI */
+    SET_BIT(RCC->CR, RCC_CR_HSION);
+
+    /* Wait until HSI is stable */
+    while(!READ_BIT(RCC->CR, RCC_CR_HSIRDY));
+
+    /* Switch system clock to HSI */
+    MODIFY_REG(RCC->CFGR, RCC_CFGR_SW, _VAL2FLD(RCC_CFGR_SW, RCC_CFGR_SW_HSI));
+
+    /* Wait until HSI is used */
+    while(READ_BIT(RCC->CFGR, RCC_CFGR_SWS) != RCC_CFGR_SWS_HSI);
+
+    /* Disable PLL and HSE, SystemInit enables them again */
+    CLEAR_BIT(RCC->CR, RCC_CR_PLLON | RCC_CR_HSEON);
+}
@@ -0,0 +1,54 @@
+/************************************************************************************************//**
+* @file power_driver.h
+*
+* @brief Header file containing the prototypes of the APIs for the low power modes.
+*
+* Public Functions:
+*       - void Power_Init(void)
+*       - uint32_t Power_Enter_Low_Power(PowerMode_t mode)
+*
+* @note
+*       The firmware polls its peripherals instead of taking their interrupts, so the low power
+*       modes are entered with the interrupts masked and the lines able to wake the device up
+*       enabled only while sleeping: the core wakes up on them but no handler is run, and the event
+*       is served by the next poll. The wakeup sources are the USB core with its EXTI line, and the
+*       user button which is the application input able to wake the host up.
+*/
+
+#ifndef POWER_DRIVER_H
+#define POWER_DRIVER_H
+
+#include <stdint.h>
+
+/**
+ * @brief List of the low power modes.
+ */
+typedef enum
+{
+    /** @brief Sleep mode: the core is stopped and the system clock is dropped to the HSI */
+    POWER_MODE_SLEEP,
+    /** @brief Stop mode: all the clocks are stopped and the regulator is in low power mode */
+    POWER_MODE_STOP
+}PowerMode_t;
+
+/***************************************************************************************************/
+/*                                       APIs Supported                                            */
+/***************************************************************************************************/
+
+/**
+ * @brief Function for initializing the power controller and the wakeup lines of the USB core and
+ *        the user button.
+ * @return void
+ */
+void Power_Init(void);
+
+/**
+ * @brief Function for entering a low power mode until the USB core signals a wakeup or the
+ *        user button is pressed. The system clock configured by SystemInit is restored before
+ *        returning.
+ * @param[in] mode is the low power mode to be entered.
+ * @return the time in us from the wakeup of the core until the system clock is restored.
+ */
+uint32_t Power_Enter_Low_Power(PowerMode_t mode);
+
+#endif /* POWER_DRIVER_H */
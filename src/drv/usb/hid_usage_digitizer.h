@@ -0,0 +1,21 @@
+/************************************************************************************************//**
+* @file hid_usage_digitizer.h
+*
+* @brief Header file containing the usages of the HID digitizer page used by the device, from the
+*        HID Usage Tables.
+*/
+
+#ifndef HID_USAGE_DIGITIZER_H
+#define HID_USAGE_DIGITIZER_H
+
+#define HID_PAGE_DIGITIZER                      0x0D
+
+#define HID_DIGITIZER_TOUCH_SCREEN              0x04    /* CA Touch screen */
+#define HID_DIGITIZER_FINGER                    0x22    /* CL Finger */
+#define HID_DIGITIZER_TIP_SWITCH                0x42    /* MC Finger touching the surface */
+#define HID_DIGITIZER_CONTACT_IDENTIFIER        0x51    /* DV Identifier of a contact */
+#define HID_DIGITIZER_CONTACT_COUNT             0x54    /* DV Number of contacts of a frame */
+#define HID_DIGITIZER_CONTACT_COUNT_MAXIMUM     0x55    /* SV Maximum number of contacts */
+#define HID_DIGITIZER_SCAN_TIME                 0x56    /* DV Time of the frame */
+
+#endif /* HID_USAGE_DIGITIZER_H */
@@ -0,0 +1,112 @@
+/************************************************************************************************//**
+* @file usb_cdc_standards.h
+*
+* @brief Header file containing the typedef and definitions of the USB CDC standard (Abstract
+*        Control Model subclass).
+*/
+
+#ifndef USB_CDC_STANDARDS_H
+#define USB_CDC_STANDARDS_H
+
+#include <stdint.h>
+
+#define USB_CLASS_CDC                       0x02
+#define USB_CLASS_CDC_DATA                  0x0A
+#define USB_SUBCLASS_CDC_ACM                0x02
+#define USB_PROTOCOL_CDC_AT_V250            0x01
+
+/**
+ * @defgroup USB_CDC_DESCRIPTOR_SUBTYPES USB CDC functional descriptor subtypes.
+ * @{
+ */
+#define USB_CDC_SUBTYPE_HEADER              0x00
+#define USB_CDC_SUBTYPE_CALL_MANAGEMENT     0x01
+#define USB_CDC_SUBTYPE_ACM                 0x02
+#define USB_CDC_SUBTYPE_UNION               0x06
+/** @} */
+
+/**
+ * @defgroup USB_CDC_REQUESTS USB CDC ACM class requests.
+ * @{
+ */
+#define USB_CDC_SEND_ENCAPSULATED_COMMAND   0x00
+#define USB_CDC_GET_ENCAPSULATED_RESPONSE   0x01
+#define USB_CDC_SET_LINE_CODING             0x20
+#define USB_CDC_GET_LINE_CODING             0x21
+#define USB_CDC_SET_CONTROL_LINE_STATE      0x22
+#define USB_CDC_SEND_BREAK                  0x23
+/** @} */
+
+/**
+ * @defgroup USB_CDC_NOTIFICATIONS USB CDC ACM notifications.
+ * @{
+ */
+#define USB_CDC_NOTIFICATION_SERIAL_STATE   0x20
+/** @} */
+
+/** @brief ACM capability: the device supports the line coding and control line state requests */
+#define USB_CDC_ACM_CAP_LINE_CODING         0x02
+
+/** @brief Control line state bit for the Data Terminal Ready signal */
+#define USB_CDC_CONTROL_LINE_DTR            0x01
+/** @brief Control line state bit for the Request To Send signal */
+#define USB_CDC_CONTROL_LINE_RTS            0x02
+
+/** @brief Serial state bit for the Data Carrier Detect signal */
+#define USB_CDC_SERIAL_STATE_DCD            0x01
+/** @brief Serial state bit for the Data Set Ready signal */
+#define USB_CDC_SERIAL_STATE_DSR            0x02
+
+typedef struct
+{
+    uint8_t bFunctionLength;
+    uint8_t bDescriptorType;
+    uint8_t bDescriptorSubtype;
+    uint16_t bcdCDC;
+} __attribute__((__packed__)) USB_CDC_HeaderDescriptor_t;
+
+typedef struct
+{
+    uint8_t bFunctionLength;
+    uint8_t bDescriptorType;
+    uint8_t bDescriptorSubtype;
+    uint8_t bmCapabilities;
+    uint8_t bDataInterface;
+} __attribute__((__packed__)) USB_CDC_CallManagementDescriptor_t;
+
+typedef struct
+{
+    uint8_t bFunctionLength;
+    uint8_t bDescriptorType;
+    uint8_t bDescriptorSubtype;
+    uint8_t bmCapabilities;
+} __attribute__((__packed__)) USB_CDC_ACMDescriptor_t;
+
+typedef struct
+{
+    uint8_t bFunctionLength;
+    uint8_t bDescriptorType;
+    uint8_t bDescriptorSubtype;
+    uint8_t bControlInterface;
+    uint8_t bSubordinateInterface0;
+} __attribute__((__packed__)) USB_CDC_UnionDescriptor_t;
+
+typedef struct
+{
+    uint32_t dwDTERate;
+    uint8_t bCharFormat;
+    uint8_t bParityType;
+    uint8_t bDataBits;
+} __attribute__((__packed__)) USB_CDC_LineCoding_t;
+
+typedef struct
+{
+    uint8_t bmRequestType;
+    uint8_t bNotification;
+    uint16_t wValue;
+    uint16_t wIndex;
+    uint16_t wLength;
+    uint16_t wData;
+} __attribute__((__packed__)) USB_CDC_SerialStateNotification_t;
+
+#endif /* USB_CDC_STANDARDS_H */
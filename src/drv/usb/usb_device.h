@@ -9,6 +9,14 @@
 
 #include "usb_standards.h"
 #include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief Function called once the DATA OUT stage of a control write transfer has been received.
+ * @param[in] request is a pointer to the request which started the control transfer.
+ * @param[in] size is the amount of bytes stored in the buffer given for the DATA OUT stage.
+ */
+typedef void(*USB_Control_Out_Callback_t)(USB_Request_t const* request, uint16_t size);
 
 /**
  * @brief Structure for managing the USB device.
@@ -16,12 +24,19 @@
 typedef struct
 {
     USBDeviceState_t device_state;
+    USBDeviceState_t resume_state;
     USBControlTransferStage_t control_transfer_stage;
     uint8_t configuration_value;
+    bool remote_wakeup_enabled;
     void const* ptr_out_buffer;
     uint32_t out_data_size;
     void const* ptr_in_buffer;
     uint32_t in_data_size;
+    bool in_zero_length_packet;
+    void* ptr_control_out_buffer;
+    uint32_t control_out_buffer_size;
+    uint32_t control_out_received;
+    USB_Control_Out_Callback_t control_out_callback;
 }USB_Device_t;
 
 #endif /* USB_DEVICE_H */
\ No newline at end of file
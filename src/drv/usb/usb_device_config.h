@@ -0,0 +1,67 @@
+/************************************************************************************************//**
+* @file usb_device_config.h
+*
+* @brief Header file containing the interface numbers and endpoint addresses of the USB device.
+*/
+
+#ifndef USB_DEVICE_CONFIG_H
+#define USB_DEVICE_CONFIG_H
+
+#include "usb_standards.h"
+
+/**
+ * @brief List of the modes of the device, each one is presented with its own descriptors.
+ */
+typedef enum
+{
+    USB_DEVICE_MODE_RUNTIME,        /**< @brief Composite device running the application */
+    USB_DEVICE_MODE_DFU,            /**< @brief Firmware upgrade (DFU mode) */
+    USB_DEVICE_MODE_COUNT
+}USBDeviceMode_t;
+
+/**
+ * @brief List of the interfaces of the composite device, sorted by interface number.
+ */
+typedef enum
+{
+    USB_INTERFACE_HID,
+    USB_INTERFACE_CDC_COMM,
+    USB_INTERFACE_CDC_DATA,
+    USB_INTERFACE_MSC,
+    USB_INTERFACE_TELEMETRY,
+    USB_INTERFACE_DFU_RUNTIME,
+    USB_INTERFACE_COUNT
+}USBInterfaceNumber_t;
+
+/**
+ * @brief List of the interfaces of the device in DFU mode.
+ */
+typedef enum
+{
+    USB_DFU_MODE_INTERFACE_DFU,
+    USB_DFU_MODE_INTERFACE_COUNT
+}USBDFUModeInterfaceNumber_t;
+
+/**
+ * @defgroup USB_ENDPOINT_ADDRESSES USB Endpoint Addresses.
+ * @brief Addresses and maximum packet sizes of the endpoints used by the functions of the device.
+ * @{
+ */
+#define USB_HID_IN_ENDPOINT         (USB_ENDPOINT_DIRECTION_IN | 3)
+#define USB_HID_IN_PACKET_SIZE      64
+
+#define USB_CDC_IN_ENDPOINT         (USB_ENDPOINT_DIRECTION_IN | 1)
+#define USB_CDC_OUT_ENDPOINT        1
+#define USB_CDC_DATA_PACKET_SIZE    64
+#define USB_CDC_NOTIFY_ENDPOINT     (USB_ENDPOINT_DIRECTION_IN | 2)
+#define USB_CDC_NOTIFY_PACKET_SIZE  16
+
+#define USB_MSC_IN_ENDPOINT         (USB_ENDPOINT_DIRECTION_IN | 4)
+#define USB_MSC_OUT_ENDPOINT        4
+#define USB_MSC_PACKET_SIZE         64
+
+#define USB_TELEMETRY_IN_ENDPOINT   (USB_ENDPOINT_DIRECTION_IN | 5)
+#define USB_TELEMETRY_PACKET_SIZE   64
+/** @} */
+
+#endif /* USB_DEVICE_CONFIG_H */
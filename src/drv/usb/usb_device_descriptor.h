@@ -8,21 +8,137 @@
 #define USB_DEVICE_DESCRIPTOR_H
 
 #include "usb_standards.h"
+#include "usb_device_config.h"
+#include "usb_driver.h"
+#include "usb_class.h"
+#include "usb_hid_class.h"
+#include "usb_hid_reports.h"
+#include "usb_cdc_class.h"
+#include "usb_msc_class.h"
+#include "usb_telemetry_class.h"
+#include "usb_dfu_class.h"
 #include "usb_hid_standards.h"
+#include "usb_cdc_standards.h"
+#include "usb_msc_standards.h"
+#include "usb_msos20_standards.h"
+#include "usb_dfu_standards.h"
 #include "usb_hid.h"
-#include "hid_usage_desktop.h"
-#include "hid_usage_button.h"
 #include <stdint.h>
+#include <stddef.h>
 
 /**
- * @brief Structure for managing the HID report.
+ * @brief List of the indexes of the string descriptors.
+ */
+typedef enum
+{
+    USB_STRING_INDEX_LANGID,
+    USB_STRING_INDEX_MANUFACTURER,
+    USB_STRING_INDEX_PRODUCT,
+    USB_STRING_INDEX_SERIAL_NUMBER,
+    USB_STRING_INDEX_COUNT
+}USBStringIndex_t;
+
+/** @brief Number of hexadecimal characters needed for printing the 96 bit unique ID */
+#define USB_SERIAL_NUMBER_LENGTH    24
+
+/**
+ * @brief Structure for the serial number string descriptor, filled in at boot.
+ */
+typedef struct
+{
+    uint8_t bLength;
+    uint8_t bDescriptorType;
+    uint16_t wString[USB_SERIAL_NUMBER_LENGTH];
+} __attribute__((__packed__)) USB_SerialNumberDescriptor_t;
+
+/** @brief Attributes of the runtime configuration, the board is powered from the ST-LINK connector
+ *         and the application input can wake the host up */
+#define USB_CONFIG_ATTRIBUTES       (USB_CONFIG_ATTR_RESERVED | USB_CONFIG_ATTR_SELF_POWERED | \
+                                     USB_CONFIG_ATTR_REMOTE_WAKEUP)
+/** @brief Attributes of the DFU mode configuration, which has no application input */
+#define USB_DFU_CONFIG_ATTRIBUTES   (USB_CONFIG_ATTR_RESERVED | USB_CONFIG_ATTR_SELF_POWERED)
+
+/** @brief Vendor request code (bRequest) for retrieving the MS OS 2.0 descriptor set */
+#define USB_MSOS20_VENDOR_CODE      0x20
+
+/** @brief Name of the registry property with the device interface GUIDs of a WinUSB interface */
+#define USB_WINUSB_GUIDS_NAME       "DeviceInterfaceGUIDs"
+/** @brief Device interface GUID (REG_MULTI_SZ) the host uses for opening the telemetry interface */
+#define USB_WINUSB_TELEMETRY_GUIDS  "{6E6C3B0A-8F2D-4C61-A7B5-2D94E1F0C3A8}\0"
+/** @brief Device interface GUID (REG_MULTI_SZ) the host uses for opening the DFU interface, both in
+ *         the runtime and in DFU mode */
+#define USB_WINUSB_DFU_GUIDS        "{3F3BDCD0-73C3-48AA-8628-D00ABE161456}\0"
+
+/* The WinUSB functions share one structure, sized for a single GUID */
+_Static_assert(sizeof(USB_WINUSB_TELEMETRY_GUIDS) == sizeof(USB_WINUSB_DFU_GUIDS),
+               "The device interface GUIDs have different lengths");
+
+/**
+ * @brief Structure combining the MS OS 2.0 descriptors of a function bound to WinUSB.
+ */
+typedef struct
+{
+    USB_MSOS20_FunctionSubsetHeader_t function_subset_header;
+    USB_MSOS20_CompatibleIdDescriptor_t compatible_id;
+    USB_MSOS20_REG_PROPERTY_T(USB_WINUSB_GUIDS_NAME, USB_WINUSB_TELEMETRY_GUIDS) interface_guids;
+} __attribute__((__packed__)) USB_MSOS20_WinUSBFunction_t;
+
+/**
+ * @brief Structure combining the MS OS 2.0 descriptor set.
  */
 typedef struct
 {
-    int8_t x;
-    int8_t y;
-    uint8_t buttons;
-} __attribute__((__packed__)) HID_Report_t;
+    USB_MSOS20_SetHeaderDescriptor_t set_header;
+    USB_MSOS20_ConfigurationSubsetHeader_t configuration_subset_header;
+    USB_MSOS20_WinUSBFunction_t telemetry_function;
+    USB_MSOS20_WinUSBFunction_t dfu_runtime_function;
+} __attribute__((__packed__)) USB_MSOS20_DescriptorSet_t;
+
+/**
+ * @brief Structure combining the MS OS 2.0 descriptor set of the device in DFU mode. It is not a
+ *        composite device, so the features apply to the whole device without subsets.
+ */
+typedef struct
+{
+    USB_MSOS20_SetHeaderDescriptor_t set_header;
+    USB_MSOS20_CompatibleIdDescriptor_t compatible_id;
+    USB_MSOS20_REG_PROPERTY_T(USB_WINUSB_GUIDS_NAME, USB_WINUSB_DFU_GUIDS) interface_guids;
+} __attribute__((__packed__)) USB_MSOS20_DFUDescriptorSet_t;
+
+/**
+ * @brief Structure combining the BOS descriptor and its device capabilities.
+ */
+typedef struct
+{
+    USB_BOSDescriptor_t bos_descriptor;
+    USB_USB20ExtensionDescriptor_t usb20_extension_descriptor;
+    USB_MSOS20_PlatformDescriptor_t msos20_platform_descriptor;
+} __attribute__((__packed__)) USB_BOSDescriptorCombination_t;
+
+/**
+ * @brief Macro for initializing the MS OS 2.0 descriptors binding an interface to WinUSB.
+ * @param[in] interface is the number of the (first) interface of the function.
+ * @param[in] guids is the string literal with the device interface GUID of the function.
+ */
+#define USB_MSOS20_WINUSB_FUNCTION(interface, guids)                                        \
+    {                                                                                       \
+        .function_subset_header = {                                                         \
+            .wLength = sizeof(USB_MSOS20_FunctionSubsetHeader_t),                           \
+            .wDescriptorType = USB_MSOS20_SUBSET_HEADER_FUNCTION,                           \
+            .bFirstInterface = (interface),                                                 \
+            .bReserved = 0,                                                                 \
+            .wSubsetLength = sizeof(USB_MSOS20_WinUSBFunction_t)                            \
+        },                                                                                  \
+        .compatible_id = {                                                                  \
+            .wLength = sizeof(USB_MSOS20_CompatibleIdDescriptor_t),                         \
+            .wDescriptorType = USB_MSOS20_FEATURE_COMPATIBLE_ID,                            \
+            .CompatibleID = "WINUSB",                                                       \
+            .SubCompatibleID = {0}                                                          \
+        },                                                                                  \
+        .interface_guids = USB_MSOS20_REG_PROPERTY(USB_MSOS20_PROPERTY_REG_MULTI_SZ,        \
+                                                   USB_WINUSB_GUIDS_NAME,                   \
+                                                   guids)                                   \
+    }
 
 /**
  * @brief Structure combining all descriptors.
@@ -33,8 +149,35 @@ typedef struct
     USB_InterfaceDescriptor_t usb_interface_descriptor;
     USB_HIDDescriptor_t usb_mouse_hid_descriptor;
     USB_EndpointDescriptor_t usb_mouse_endpoint_descriptor;
+    USB_InterfaceAssocDescriptor_t usb_cdc_interface_assoc_descriptor;
+    USB_InterfaceDescriptor_t usb_cdc_comm_interface_descriptor;
+    USB_CDC_HeaderDescriptor_t usb_cdc_header_descriptor;
+    USB_CDC_CallManagementDescriptor_t usb_cdc_call_management_descriptor;
+    USB_CDC_ACMDescriptor_t usb_cdc_acm_descriptor;
+    USB_CDC_UnionDescriptor_t usb_cdc_union_descriptor;
+    USB_EndpointDescriptor_t usb_cdc_notify_endpoint_descriptor;
+    USB_InterfaceDescriptor_t usb_cdc_data_interface_descriptor;
+    USB_EndpointDescriptor_t usb_cdc_out_endpoint_descriptor;
+    USB_EndpointDescriptor_t usb_cdc_in_endpoint_descriptor;
+    USB_InterfaceDescriptor_t usb_msc_interface_descriptor;
+    USB_EndpointDescriptor_t usb_msc_in_endpoint_descriptor;
+    USB_EndpointDescriptor_t usb_msc_out_endpoint_descriptor;
+    USB_InterfaceDescriptor_t usb_telemetry_interface_descriptor;
+    USB_EndpointDescriptor_t usb_telemetry_in_endpoint_descriptor;
+    USB_InterfaceDescriptor_t usb_dfu_runtime_interface_descriptor;
+    USB_DFU_FunctionalDescriptor_t usb_dfu_runtime_functional_descriptor;
 }USB_CfgDescriptorCombination_t;
 
+/**
+ * @brief Structure combining all descriptors of the device in DFU mode.
+ */
+typedef struct
+{
+    USB_StdCfgDescriptor_t usb_configuration_descriptor;
+    USB_InterfaceDescriptor_t usb_dfu_interface_descriptor;
+    USB_DFU_FunctionalDescriptor_t usb_dfu_functional_descriptor;
+}USB_DFUCfgDescriptorCombination_t;
+
 /***************************************************************************************************/
 /*                                       Variables                                                 */
 /***************************************************************************************************/
@@ -46,52 +189,59 @@ typedef struct
 const USB_StdDeviceDescriptor_t device_descriptor = {
     .bLength = sizeof(USB_StdDeviceDescriptor_t),
     .bDescriptorType = USB_DESCRIPTOR_TYPE_DEVICE,
-    .bcdUSB = 0x0200,
-    .bDeviceClass = USB_CLASS_PER_INTERFACE,
-    .bDeviceSubClass = USB_SUBCLASS_NONE,
-    .bDeviceProtocol = USB_PROTOCOL_NONE,
+    .bcdUSB = 0x0210,                       /* 2.01 or later makes the host ask for the BOS */
+    .bDeviceClass = USB_CLASS_IAD,          /* The CDC function is grouped with an IAD */
+    .bDeviceSubClass = USB_SUBCLASS_IAD,
+    .bDeviceProtocol = USB_PROTOCOL_IAD,
     .bMaxPacketSize0 = 8,
     .idVendor = 0x6666,
     .idProduct = 0x13AA,
     .bcdDevice = 0x0100,
-    .iManufacturer = 0,
-    .iProduct = 0,
-    .iSerialNumber = 0,
+    .iManufacturer = USB_STRING_INDEX_MANUFACTURER,
+    .iProduct = USB_STRING_INDEX_PRODUCT,
+    .iSerialNumber = USB_STRING_INDEX_SERIAL_NUMBER,
     .bNumConfigurations = 1
 };
 
 /**
- * @brief Array implementing the HID report descriptor.
+ * @brief Structure implementing the string descriptor zero with the supported languages.
+ * @showinitializer
+ */
+const USB_LangIdDescriptor_t langid_string_descriptor = {
+    .bLength = sizeof(USB_LangIdDescriptor_t),
+    .bDescriptorType = USB_DESCRIPTOR_TYPE_STRING,
+    .wLANGID0 = USB_LANGID_ENGLISH_US
+};
+
+/**
+ * @brief Structure implementing the manufacturer string descriptor.
+ * @showinitializer
+ */
+const USB_STRING_DESCRIPTOR_T("maherme") manufacturer_string_descriptor =
+    USB_STRING_DESCRIPTOR("maherme");
+
+/**
+ * @brief Structure implementing the product string descriptor.
+ * @showinitializer
+ */
+const USB_STRING_DESCRIPTOR_T("STM32F429I-DISC1 USB Device") product_string_descriptor =
+    USB_STRING_DESCRIPTOR("STM32F429I-DISC1 USB Device");
+
+/**
+ * @brief Structure implementing the serial number string descriptor, it is built at boot from the
+ *        unique ID of the device and cached in RAM.
+ */
+USB_SerialNumberDescriptor_t serial_number_string_descriptor;
+
+/**
+ * @brief Array implementing the HID report descriptor, compiled from usb_hid_reports.hidspec.
  * @showinitializer
  */
 const uint8_t hid_report_descriptor[] = {
-    HID_USAGE_PAGE(HID_PAGE_DESKTOP),
-    HID_USAGE(HID_DESKTOP_MOUSE),
-    HID_COLLECTION(HID_APPLICATION_COLLECTION),
-        HID_USAGE(HID_DESKTOP_POINTER),
-        HID_COLLECTION(HID_PHYSICAL_COLLECTION),
-            HID_USAGE(HID_DESKTOP_X),
-            HID_USAGE(HID_DESKTOP_Y),
-            HID_LOGICAL_MINIMUM(-127),
-            HID_LOGICAL_MAXIMUM(127),
-            HID_REPORT_SIZE(8),
-            HID_REPORT_COUNT(2),
-            HID_INPUT(HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_RELATIVE),
-
-            HID_USAGE_PAGE(HID_PAGE_BUTTON),
-            HID_USAGE_MINIMUM(1),
-            HID_USAGE_MAXIMUM(3),
-            HID_LOGICAL_MINIMUM(0),
-            HID_LOGICAL_MAXIMUM(1),
-            HID_REPORT_SIZE(1),
-            HID_REPORT_COUNT(3),
-            HID_INPUT(HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
-            HID_REPORT_SIZE(1),             /* Padding */
-            HID_REPORT_COUNT(5),            /* Padding */
-            HID_INPUT(HID_IOF_CONSTANT),    /* Padding */
-        HID_END_COLLECTION,
-    HID_END_COLLECTION
+    USB_HID_REPORT_DESCRIPTOR
 };
+_Static_assert(sizeof(hid_report_descriptor) == USB_HID_REPORT_DESCRIPTOR_SIZE,
+               "Size of the HID report descriptor");
 
 /**
  * @brief Structure implementing the combination of configuration descriptors.
@@ -102,30 +252,30 @@ const USB_CfgDescriptorCombination_t cfg_descriptor_combination = {
         .bLength = sizeof(USB_StdCfgDescriptor_t),
         .bDescriptorType = USB_DESCRIPTOR_TYPE_CONFIGURATION,
         .wTotalLength = sizeof(USB_CfgDescriptorCombination_t),
-        .bNumInterfaces = 1,
+        .bNumInterfaces = USB_INTERFACE_COUNT,
         .bConfigurationValue = 1,
         .iConfiguration = 0,
-        .bmAttributes = 0x80 | 0x40,
+        .bmAttributes = USB_CONFIG_ATTRIBUTES,
         .bMaxPower = 25     /* The device may need 50 mW */
     },
     .usb_interface_descriptor = {
         .bLength = sizeof(USB_InterfaceDescriptor_t),
         .bDescriptorType = USB_DESCRIPTOR_TYPE_INTERFACE,
-        .bInterfaceNumber = 1,
+        .bInterfaceNumber = USB_INTERFACE_HID,
         .bAlternateSetting = 0,
         .bNumEndpoints = 1,
         .bInterfaceClass = USB_CLASS_HID,
-        .bInterfaceSubClass = USB_SUBCLASS_NONE,
-        .bInterfaceProtocol = USB_PROTOCOL_NONE,
+        .bInterfaceSubClass = USB_HID_SUBCLASS_BOOT,  /* Usable by the BIOS before the OS boots */
+        .bInterfaceProtocol = USB_HID_PROTO_KEYBOARD,
         .iInterface = 0
     },
     .usb_mouse_endpoint_descriptor = {
         .bLength = sizeof(USB_EndpointDescriptor_t),
         .bDescriptorType = USB_DESCRIPTOR_TYPE_ENDPOINT,
-        .bEndpointAddress = 0x83,   /* MSB is set due to 0x03 address is for in endpoint */
+        .bEndpointAddress = USB_HID_IN_ENDPOINT,
         .bmAttributes = USB_ENDPOINT_TYPE_INTERRUPT,
-        .wMaxPacketSize = 64,
-        .bInterval = 50     /* Units for the interval are frames */
+        .wMaxPacketSize = USB_HID_IN_PACKET_SIZE,
+        .bInterval = 1      /* Units for the interval are frames, shared by all the reports */
     },
     .usb_mouse_hid_descriptor = {
         .bLength = sizeof(USB_HIDDescriptor_t),
@@ -135,6 +285,549 @@ const USB_CfgDescriptorCombination_t cfg_descriptor_combination = {
         .bNumDescriptors = 1,
         .bDescriptorType0 = USB_DESCRIPTOR_TYPE_HID_REPORT,
         .wDescriptorLength0 = sizeof(hid_report_descriptor)
+    },
+    .usb_cdc_interface_assoc_descriptor = {
+        .bLength = sizeof(USB_InterfaceAssocDescriptor_t),
+        .bDescriptorType = USB_DESCRIPTOR_TYPE_INTERFACEASSOC,
+        .bFirstInterface = USB_INTERFACE_CDC_COMM,
+        .bInterfaceCount = 2,
+        .bFunctionClass = USB_CLASS_CDC,
+        .bFunctionSubClass = USB_SUBCLASS_CDC_ACM,
+        .bFunctionProtocol = USB_PROTOCOL_CDC_AT_V250,
+        .iFunction = 0
+    },
+    .usb_cdc_comm_interface_descriptor = {
+        .bLength = sizeof(USB_InterfaceDescriptor_t),
+        .bDescriptorType = USB_DESCRIPTOR_TYPE_INTERFACE,
+        .bInterfaceNumber = USB_INTERFACE_CDC_COMM,
+        .bAlternateSetting = 0,
+        .bNumEndpoints = 1,
+        .bInterfaceClass = USB_CLASS_CDC,
+        .bInterfaceSubClass = USB_SUBCLASS_CDC_ACM,
+        .bInterfaceProtocol = USB_PROTOCOL_CDC_AT_V250,
+        .iInterface = 0
+    },
+    .usb_cdc_header_descriptor = {
+        .bFunctionLength = sizeof(USB_CDC_HeaderDescriptor_t),
+        .bDescriptorType = USB_DESCRIPTOR_TYPE_CS_INTERFACE,
+        .bDescriptorSubtype = USB_CDC_SUBTYPE_HEADER,
+        .bcdCDC = 0x0110
+    },
+    .usb_cdc_call_management_descriptor = {
+        .bFunctionLength = sizeof(USB_CDC_CallManagementDescriptor_t),
+        .bDescriptorType = USB_DESCRIPTOR_TYPE_CS_INTERFACE,
+        .bDescriptorSubtype = USB_CDC_SUBTYPE_CALL_MANAGEMENT,
+        .bmCapabilities = 0,    /* The device does not handle call management */
+        .bDataInterface = USB_INTERFACE_CDC_DATA
+    },
+    .usb_cdc_acm_descriptor = {
+        .bFunctionLength = sizeof(USB_CDC_ACMDescriptor_t),
+        .bDescriptorType = USB_DESCRIPTOR_TYPE_CS_INTERFACE,
+        .bDescriptorSubtype = USB_CDC_SUBTYPE_ACM,
+        .bmCapabilities = USB_CDC_ACM_CAP_LINE_CODING
+    },
+    .usb_cdc_union_descriptor = {
+        .bFunctionLength = sizeof(USB_CDC_UnionDescriptor_t),
+        .bDescriptorType = USB_DESCRIPTOR_TYPE_CS_INTERFACE,
+        .bDescriptorSubtype = USB_CDC_SUBTYPE_UNION,
+        .bControlInterface = USB_INTERFACE_CDC_COMM,
+        .bSubordinateInterface0 = USB_INTERFACE_CDC_DATA
+    },
+    .usb_cdc_notify_endpoint_descriptor = {
+        .bLength = sizeof(USB_EndpointDescriptor_t),
+        .bDescriptorType = USB_DESCRIPTOR_TYPE_ENDPOINT,
+        .bEndpointAddress = USB_CDC_NOTIFY_ENDPOINT,
+        .bmAttributes = USB_ENDPOINT_TYPE_INTERRUPT,
+        .wMaxPacketSize = USB_CDC_NOTIFY_PACKET_SIZE,
+        .bInterval = 16     /* Units for the interval are frames */
+    },
+    .usb_cdc_data_interface_descriptor = {
+        .bLength = sizeof(USB_InterfaceDescriptor_t),
+        .bDescriptorType = USB_DESCRIPTOR_TYPE_INTERFACE,
+        .bInterfaceNumber = USB_INTERFACE_CDC_DATA,
+        .bAlternateSetting = 0,
+        .bNumEndpoints = 2,
+        .bInterfaceClass = USB_CLASS_CDC_DATA,
+        .bInterfaceSubClass = USB_SUBCLASS_NONE,
+        .bInterfaceProtocol = USB_PROTOCOL_NONE,
+        .iInterface = 0
+    },
+    .usb_cdc_out_endpoint_descriptor = {
+        .bLength = sizeof(USB_EndpointDescriptor_t),
+        .bDescriptorType = USB_DESCRIPTOR_TYPE_ENDPOINT,
+        .bEndpointAddress = USB_CDC_OUT_ENDPOINT,
+        .bmAttributes = USB_ENDPOINT_TYPE_BULK,
+        .wMaxPacketSize = USB_CDC_DATA_PACKET_SIZE,
+        .bInterval = 0
+    },
+    .usb_cdc_in_endpoint_descriptor = {
+        .bLength = sizeof(USB_EndpointDescriptor_t),
+        .bDescriptorType = USB_DESCRIPTOR_TYPE_ENDPOINT,
+        .bEndpointAddress = USB_CDC_IN_ENDPOINT,
+        .bmAttributes = USB_ENDPOINT_TYPE_BULK,
+        .wMaxPacketSize = USB_CDC_DATA_PACKET_SIZE,
+        .bInterval = 0
+    },
+    .usb_msc_interface_descriptor = {
+        .bLength = sizeof(USB_InterfaceDescriptor_t),
+        .bDescriptorType = USB_DESCRIPTOR_TYPE_INTERFACE,
+        .bInterfaceNumber = USB_INTERFACE_MSC,
+        .bAlternateSetting = 0,
+        .bNumEndpoints = 2,
+        .bInterfaceClass = USB_CLASS_MASS_STORAGE,
+        .bInterfaceSubClass = USB_SUBCLASS_MSC_SCSI,
+        .bInterfaceProtocol = USB_PROTOCOL_MSC_BOT,
+        .iInterface = 0
+    },
+    .usb_msc_in_endpoint_descriptor = {
+        .bLength = sizeof(USB_EndpointDescriptor_t),
+        .bDescriptorType = USB_DESCRIPTOR_TYPE_ENDPOINT,
+        .bEndpointAddress = USB_MSC_IN_ENDPOINT,
+        .bmAttributes = USB_ENDPOINT_TYPE_BULK,
+        .wMaxPacketSize = USB_MSC_PACKET_SIZE,
+        .bInterval = 0
+    },
+    .usb_msc_out_endpoint_descriptor = {
+        .bLength = sizeof(USB_EndpointDescriptor_t),
+        .bDescriptorType = USB_DESCRIPTOR_TYPE_ENDPOINT,
+        .bEndpointAddress = USB_MSC_OUT_ENDPOINT,
+        .bmAttributes = USB_ENDPOINT_TYPE_BULK,
+        .wMaxPacketSize = USB_MSC_PACKET_SIZE,
+        .bInterval = 0
+    },
+    .usb_telemetry_interface_descriptor = {
+        .bLength = sizeof(USB_InterfaceDescriptor_t),
+        .bDescriptorType = USB_DESCRIPTOR_TYPE_INTERFACE,
+        .bInterfaceNumber = USB_INTERFACE_TELEMETRY,
+        .bAlternateSetting = 0,
+        .bNumEndpoints = 1,
+        .bInterfaceClass = USB_CLASS_VENDOR,
+        .bInterfaceSubClass = USB_SUBCLASS_VENDOR,
+        .bInterfaceProtocol = USB_PROTOCOL_VENDOR,
+        .iInterface = 0
+    },
+    .usb_telemetry_in_endpoint_descriptor = {
+        .bLength = sizeof(USB_EndpointDescriptor_t),
+        .bDescriptorType = USB_DESCRIPTOR_TYPE_ENDPOINT,
+        .bEndpointAddress = USB_TELEMETRY_IN_ENDPOINT,
+        .bmAttributes = USB_ENDPOINT_TYPE_BULK,
+        .wMaxPacketSize = USB_TELEMETRY_PACKET_SIZE,
+        .bInterval = 0
+    },
+    .usb_dfu_runtime_interface_descriptor = {
+        .bLength = sizeof(USB_InterfaceDescriptor_t),
+        .bDescriptorType = USB_DESCRIPTOR_TYPE_INTERFACE,
+        .bInterfaceNumber = USB_INTERFACE_DFU_RUNTIME,
+        .bAlternateSetting = 0,
+        .bNumEndpoints = 0,
+        .bInterfaceClass = USB_CLASS_APP_SPEC,
+        .bInterfaceSubClass = USB_SUBCLASS_DFU,
+        .bInterfaceProtocol = USB_PROTOCOL_DFU_RUNTIME,
+        .iInterface = 0
+    },
+    .usb_dfu_runtime_functional_descriptor = {
+        .bLength = sizeof(USB_DFU_FunctionalDescriptor_t),
+        .bDescriptorType = USB_DESCRIPTOR_TYPE_DFU_FUNCTIONAL,
+        .bmAttributes = USB_DFU_ATTR_WILL_DETACH | USB_DFU_ATTR_CAN_DNLOAD,
+        .wDetachTimeOut = USB_DFU_DETACH_TIMEOUT,
+        .wTransferSize = USB_DFU_TRANSFER_SIZE,
+        .bcdDFUVersion = 0x0110
+    }
+};
+
+/**
+ * @brief Structure implementing the MS OS 2.0 descriptor set, returned by the vendor request
+ *        announced in the platform capability of the BOS.
+ * @showinitializer
+ */
+const USB_MSOS20_DescriptorSet_t msos20_descriptor_set = {
+    .set_header = {
+        .wLength = sizeof(USB_MSOS20_SetHeaderDescriptor_t),
+        .wDescriptorType = USB_MSOS20_SET_HEADER_DESCRIPTOR,
+        .dwWindowsVersion = USB_MSOS20_WINDOWS_VERSION_8_1,
+        .wTotalLength = sizeof(USB_MSOS20_DescriptorSet_t)
+    },
+    .configuration_subset_header = {
+        .wLength = sizeof(USB_MSOS20_ConfigurationSubsetHeader_t),
+        .wDescriptorType = USB_MSOS20_SUBSET_HEADER_CONFIGURATION,
+        .bConfigurationValue = 0,   /* Index of the configuration, not its value */
+        .bReserved = 0,
+        .wTotalLength = sizeof(USB_MSOS20_DescriptorSet_t) -
+                        sizeof(USB_MSOS20_SetHeaderDescriptor_t)
+    },
+    .telemetry_function = USB_MSOS20_WINUSB_FUNCTION(USB_INTERFACE_TELEMETRY,
+                                                     USB_WINUSB_TELEMETRY_GUIDS),
+    .dfu_runtime_function = USB_MSOS20_WINUSB_FUNCTION(USB_INTERFACE_DFU_RUNTIME,
+                                                       USB_WINUSB_DFU_GUIDS)
+};
+
+/**
+ * @brief Structure implementing the BOS descriptor with its device capabilities.
+ * @showinitializer
+ */
+const USB_BOSDescriptorCombination_t bos_descriptor_combination = {
+    .bos_descriptor = {
+        .bLength = sizeof(USB_BOSDescriptor_t),
+        .bDescriptorType = USB_DESCRIPTOR_TYPE_BOS,
+        .wTotalLength = sizeof(USB_BOSDescriptorCombination_t),
+        .bNumDeviceCaps = 2
+    },
+    .usb20_extension_descriptor = {
+        .bLength = sizeof(USB_USB20ExtensionDescriptor_t),
+        .bDescriptorType = USB_DESCRIPTOR_TYPE_DEVICE_CAPABILITY,
+        .bDevCapabilityType = USB_DEVICE_CAPABILITY_USB20_EXTENSION,
+        .bmAttributes = 0   /* Link power management is not supported */
+    },
+    .msos20_platform_descriptor = {
+        .bLength = sizeof(USB_MSOS20_PlatformDescriptor_t),
+        .bDescriptorType = USB_DESCRIPTOR_TYPE_DEVICE_CAPABILITY,
+        .bDevCapabilityType = USB_DEVICE_CAPABILITY_PLATFORM,
+        .bReserved = 0,
+        .PlatformCapabilityUUID = USB_MSOS20_PLATFORM_UUID,
+        .dwWindowsVersion = USB_MSOS20_WINDOWS_VERSION_8_1,
+        .wMSOSDescriptorSetTotalLength = sizeof(USB_MSOS20_DescriptorSet_t),
+        .bMS_VendorCode = USB_MSOS20_VENDOR_CODE,
+        .bAltEnumCode = 0
+    }
+};
+
+/**
+ * @brief Structure implementing the device descriptor of the device in DFU mode. The size of the
+ *        packets of the endpoint 0 must match the one of the application.
+ * @showinitializer
+ */
+const USB_StdDeviceDescriptor_t dfu_device_descriptor = {
+    .bLength = sizeof(USB_StdDeviceDescriptor_t),
+    .bDescriptorType = USB_DESCRIPTOR_TYPE_DEVICE,
+    .bcdUSB = 0x0210,
+    .bDeviceClass = USB_CLASS_PER_INTERFACE,
+    .bDeviceSubClass = USB_SUBCLASS_NONE,
+    .bDeviceProtocol = USB_PROTOCOL_NONE,
+    .bMaxPacketSize0 = 8,
+    .idVendor = 0x6666,
+    .idProduct = 0x13AB,                    /* Hosts may cache the descriptors of each product */
+    .bcdDevice = 0x0100,
+    .iManufacturer = USB_STRING_INDEX_MANUFACTURER,
+    .iProduct = USB_STRING_INDEX_PRODUCT,
+    .iSerialNumber = USB_STRING_INDEX_SERIAL_NUMBER,
+    .bNumConfigurations = 1
+};
+
+/**
+ * @brief Structure implementing the combination of configuration descriptors of the device in DFU
+ *        mode.
+ * @showinitializer
+ */
+const USB_DFUCfgDescriptorCombination_t dfu_cfg_descriptor_combination = {
+    .usb_configuration_descriptor = {
+        .bLength = sizeof(USB_StdCfgDescriptor_t),
+        .bDescriptorType = USB_DESCRIPTOR_TYPE_CONFIGURATION,
+        .wTotalLength = sizeof(USB_DFUCfgDescriptorCombination_t),
+        .bNumInterfaces = USB_DFU_MODE_INTERFACE_COUNT,
+        .bConfigurationValue = 1,
+        .iConfiguration = 0,
+        .bmAttributes = USB_DFU_CONFIG_ATTRIBUTES,
+        .bMaxPower = 25     /* The device may need 50 mW */
+    },
+    .usb_dfu_interface_descriptor = {
+        .bLength = sizeof(USB_InterfaceDescriptor_t),
+        .bDescriptorType = USB_DESCRIPTOR_TYPE_INTERFACE,
+        .bInterfaceNumber = USB_DFU_MODE_INTERFACE_DFU,
+        .bAlternateSetting = 0,
+        .bNumEndpoints = 0,
+        .bInterfaceClass = USB_CLASS_APP_SPEC,
+        .bInterfaceSubClass = USB_SUBCLASS_DFU,
+        .bInterfaceProtocol = USB_PROTOCOL_DFU_MODE,
+        .iInterface = 0
+    },
+    .usb_dfu_functional_descriptor = {
+        .bLength = sizeof(USB_DFU_FunctionalDescriptor_t),
+        .bDescriptorType = USB_DESCRIPTOR_TYPE_DFU_FUNCTIONAL,
+        .bmAttributes = USB_DFU_ATTR_CAN_DNLOAD,    /* The device resets after the manifestation */
+        .wDetachTimeOut = USB_DFU_DETACH_TIMEOUT,
+        .wTransferSize = USB_DFU_TRANSFER_SIZE,
+        .bcdDFUVersion = 0x0110
+    }
+};
+
+/**
+ * @brief Structure implementing the MS OS 2.0 descriptor set of the device in DFU mode.
+ * @showinitializer
+ */
+const USB_MSOS20_DFUDescriptorSet_t dfu_msos20_descriptor_set = {
+    .set_header = {
+        .wLength = sizeof(USB_MSOS20_SetHeaderDescriptor_t),
+        .wDescriptorType = USB_MSOS20_SET_HEADER_DESCRIPTOR,
+        .dwWindowsVersion = USB_MSOS20_WINDOWS_VERSION_8_1,
+        .wTotalLength = sizeof(USB_MSOS20_DFUDescriptorSet_t)
+    },
+    .compatible_id = {
+        .wLength = sizeof(USB_MSOS20_CompatibleIdDescriptor_t),
+        .wDescriptorType = USB_MSOS20_FEATURE_COMPATIBLE_ID,
+        .CompatibleID = "WINUSB",
+        .SubCompatibleID = {0}
+    },
+    .interface_guids = USB_MSOS20_REG_PROPERTY(USB_MSOS20_PROPERTY_REG_MULTI_SZ,
+                                               USB_WINUSB_GUIDS_NAME,
+                                               USB_WINUSB_DFU_GUIDS)
+};
+
+/**
+ * @brief Structure implementing the BOS descriptor of the device in DFU mode.
+ * @showinitializer
+ */
+const USB_BOSDescriptorCombination_t dfu_bos_descriptor_combination = {
+    .bos_descriptor = {
+        .bLength = sizeof(USB_BOSDescriptor_t),
+        .bDescriptorType = USB_DESCRIPTOR_TYPE_BOS,
+        .wTotalLength = sizeof(USB_BOSDescriptorCombination_t),
+        .bNumDeviceCaps = 2
+    },
+    .usb20_extension_descriptor = {
+        .bLength = sizeof(USB_USB20ExtensionDescriptor_t),
+        .bDescriptorType = USB_DESCRIPTOR_TYPE_DEVICE_CAPABILITY,
+        .bDevCapabilityType = USB_DEVICE_CAPABILITY_USB20_EXTENSION,
+        .bmAttributes = 0
+    },
+    .msos20_platform_descriptor = {
+        .bLength = sizeof(USB_MSOS20_PlatformDescriptor_t),
+        .bDescriptorType = USB_DESCRIPTOR_TYPE_DEVICE_CAPABILITY,
+        .bDevCapabilityType = USB_DEVICE_CAPABILITY_PLATFORM,
+        .bReserved = 0,
+        .PlatformCapabilityUUID = USB_MSOS20_PLATFORM_UUID,
+        .dwWindowsVersion = USB_MSOS20_WINDOWS_VERSION_8_1,
+        .wMSOSDescriptorSetTotalLength = sizeof(USB_MSOS20_DFUDescriptorSet_t),
+        .bMS_VendorCode = USB_MSOS20_VENDOR_CODE,
+        .bAltEnumCode = 0
+    }
+};
+
+/**
+ * @brief Descriptor registry entries of the device descriptor.
+ * @showinitializer
+ */
+const USB_DescriptorEntry_t device_descriptor_entries[] = {
+    USB_DESCRIPTOR_ENTRY(0, 0, device_descriptor)
+};
+
+/**
+ * @brief Descriptor registry entries of the configuration descriptors.
+ * @showinitializer
+ */
+const USB_DescriptorEntry_t configuration_descriptor_entries[] = {
+    USB_DESCRIPTOR_ENTRY(0, 0, cfg_descriptor_combination)
+};
+
+/**
+ * @brief Descriptor registry entries of the BOS descriptor.
+ * @showinitializer
+ */
+const USB_DescriptorEntry_t bos_descriptor_entries[] = {
+    USB_DESCRIPTOR_ENTRY(0, 0, bos_descriptor_combination)
+};
+
+/**
+ * @brief Descriptor registry entries of the string descriptors, sorted by @ref USBStringIndex_t.
+ * @showinitializer
+ */
+const USB_DescriptorEntry_t string_descriptor_entries[USB_STRING_INDEX_COUNT] = {
+    [USB_STRING_INDEX_LANGID] =
+        USB_DESCRIPTOR_ENTRY(USB_STRING_INDEX_LANGID, 0, langid_string_descriptor),
+    [USB_STRING_INDEX_MANUFACTURER] =
+        USB_DESCRIPTOR_ENTRY(USB_STRING_INDEX_MANUFACTURER,
+                             USB_LANGID_ENGLISH_US,
+                             manufacturer_string_descriptor),
+    [USB_STRING_INDEX_PRODUCT] =
+        USB_DESCRIPTOR_ENTRY(USB_STRING_INDEX_PRODUCT,
+                             USB_LANGID_ENGLISH_US,
+                             product_string_descriptor),
+    [USB_STRING_INDEX_SERIAL_NUMBER] =
+        USB_DESCRIPTOR_ENTRY(USB_STRING_INDEX_SERIAL_NUMBER,
+                             USB_LANGID_ENGLISH_US,
+                             serial_number_string_descriptor)
+};
+
+/**
+ * @brief Descriptor registry entries of the device descriptor in DFU mode.
+ * @showinitializer
+ */
+const USB_DescriptorEntry_t dfu_device_descriptor_entries[] = {
+    USB_DESCRIPTOR_ENTRY(0, 0, dfu_device_descriptor)
+};
+
+/**
+ * @brief Descriptor registry entries of the configuration descriptors in DFU mode.
+ * @showinitializer
+ */
+const USB_DescriptorEntry_t dfu_configuration_descriptor_entries[] = {
+    USB_DESCRIPTOR_ENTRY(0, 0, dfu_cfg_descriptor_combination)
+};
+
+/**
+ * @brief Descriptor registry entries of the BOS descriptor in DFU mode.
+ * @showinitializer
+ */
+const USB_DescriptorEntry_t dfu_bos_descriptor_entries[] = {
+    USB_DESCRIPTOR_ENTRY(0, 0, dfu_bos_descriptor_combination)
+};
+
+/**
+ * @brief Descriptor registry entries of the HID descriptors, sorted by interface number.
+ * @showinitializer
+ */
+const USB_DescriptorEntry_t hid_descriptor_entries[] = {
+    [USB_INTERFACE_HID] =
+        USB_DESCRIPTOR_ENTRY(0,
+                             USB_INTERFACE_HID,
+                             cfg_descriptor_combination.usb_mouse_hid_descriptor)
+};
+
+/**
+ * @brief Descriptor registry entries of the HID report descriptors, sorted by interface number.
+ * @showinitializer
+ */
+const USB_DescriptorEntry_t hid_report_descriptor_entries[] = {
+    [USB_INTERFACE_HID] = USB_DESCRIPTOR_ENTRY(0, USB_INTERFACE_HID, hid_report_descriptor)
+};
+
+/**
+ * @brief Descriptor registry, indexed by descriptor type. Types without entries (e.g. the device
+ *        qualifier of this full speed only device) are answered with a STALL.
+ * @showinitializer
+ */
+const USB_DescriptorRegistryType_t descriptor_registry[USB_DESCRIPTOR_TYPE_HID_REPORT + 1] = {
+    [USB_DESCRIPTOR_TYPE_DEVICE] =
+        USB_DESCRIPTOR_TYPE_ENTRIES(device_descriptor_entries, USB_DESCRIPTOR_KEY_INDEX),
+    [USB_DESCRIPTOR_TYPE_CONFIGURATION] =
+        USB_DESCRIPTOR_TYPE_ENTRIES(configuration_descriptor_entries, USB_DESCRIPTOR_KEY_INDEX),
+    [USB_DESCRIPTOR_TYPE_STRING] =
+        USB_DESCRIPTOR_TYPE_ENTRIES(string_descriptor_entries, USB_DESCRIPTOR_KEY_INDEX),
+    [USB_DESCRIPTOR_TYPE_BOS] =
+        USB_DESCRIPTOR_TYPE_ENTRIES(bos_descriptor_entries, USB_DESCRIPTOR_KEY_INDEX),
+    [USB_DESCRIPTOR_TYPE_HID] =
+        USB_DESCRIPTOR_TYPE_ENTRIES(hid_descriptor_entries, USB_DESCRIPTOR_KEY_INTERFACE),
+    [USB_DESCRIPTOR_TYPE_HID_REPORT] =
+        USB_DESCRIPTOR_TYPE_ENTRIES(hid_report_descriptor_entries, USB_DESCRIPTOR_KEY_INTERFACE)
+};
+
+/**
+ * @brief Descriptor registry of the device in DFU mode, indexed by descriptor type.
+ * @showinitializer
+ */
+const USB_DescriptorRegistryType_t dfu_descriptor_registry[USB_DESCRIPTOR_TYPE_BOS + 1] = {
+    [USB_DESCRIPTOR_TYPE_DEVICE] =
+        USB_DESCRIPTOR_TYPE_ENTRIES(dfu_device_descriptor_entries, USB_DESCRIPTOR_KEY_INDEX),
+    [USB_DESCRIPTOR_TYPE_CONFIGURATION] =
+        USB_DESCRIPTOR_TYPE_ENTRIES(dfu_configuration_descriptor_entries,
+                                    USB_DESCRIPTOR_KEY_INDEX),
+    [USB_DESCRIPTOR_TYPE_STRING] =
+        USB_DESCRIPTOR_TYPE_ENTRIES(string_descriptor_entries, USB_DESCRIPTOR_KEY_INDEX),
+    [USB_DESCRIPTOR_TYPE_BOS] =
+        USB_DESCRIPTOR_TYPE_ENTRIES(dfu_bos_descriptor_entries, USB_DESCRIPTOR_KEY_INDEX)
+};
+
+/**
+ * @brief Class drivers of the functions of the composite device, their callbacks are called in this
+ *        order on configuration, deconfiguration and start of frame.
+ * @showinitializer
+ */
+const USB_Class_Driver_t* const class_drivers[] = {
+    &USB_HID_class,
+    &USB_CDC_class,
+    &USB_MSC_class,
+    &USB_Telemetry_class,
+    &USB_DFU_Runtime_class
+};
+
+/**
+ * @brief Routing table from interface number to the class driver owning the interface.
+ * @showinitializer
+ */
+const USB_Class_Driver_t* const interface_class_drivers[USB_INTERFACE_COUNT] = {
+    [USB_INTERFACE_HID] = &USB_HID_class,
+    [USB_INTERFACE_CDC_COMM] = &USB_CDC_class,
+    [USB_INTERFACE_CDC_DATA] = &USB_CDC_class,
+    [USB_INTERFACE_MSC] = &USB_MSC_class,
+    [USB_INTERFACE_TELEMETRY] = &USB_Telemetry_class,
+    [USB_INTERFACE_DFU_RUNTIME] = &USB_DFU_Runtime_class
+};
+
+/**
+ * @brief Routing table from IN endpoint number to the class driver owning the endpoint.
+ * @showinitializer
+ */
+const USB_Class_Driver_t* const in_endpoint_class_drivers[USB_ENDPOINT_COUNT] = {
+    [USB_ENDPOINT_NUMBER(USB_HID_IN_ENDPOINT)] = &USB_HID_class,
+    [USB_ENDPOINT_NUMBER(USB_CDC_IN_ENDPOINT)] = &USB_CDC_class,
+    [USB_ENDPOINT_NUMBER(USB_CDC_NOTIFY_ENDPOINT)] = &USB_CDC_class,
+    [USB_ENDPOINT_NUMBER(USB_MSC_IN_ENDPOINT)] = &USB_MSC_class,
+    [USB_ENDPOINT_NUMBER(USB_TELEMETRY_IN_ENDPOINT)] = &USB_Telemetry_class
+};
+
+/**
+ * @brief Routing table from OUT endpoint number to the class driver owning the endpoint.
+ * @showinitializer
+ */
+const USB_Class_Driver_t* const out_endpoint_class_drivers[USB_ENDPOINT_COUNT] = {
+    [USB_ENDPOINT_NUMBER(USB_CDC_OUT_ENDPOINT)] = &USB_CDC_class,
+    [USB_ENDPOINT_NUMBER(USB_MSC_OUT_ENDPOINT)] = &USB_MSC_class
+};
+
+/**
+ * @brief Class drivers of the device in DFU mode.
+ * @showinitializer
+ */
+const USB_Class_Driver_t* const dfu_class_drivers[] = {
+    &USB_DFU_class
+};
+
+/**
+ * @brief Routing table from interface number to class driver of the device in DFU mode.
+ * @showinitializer
+ */
+const USB_Class_Driver_t* const dfu_interface_class_drivers[USB_DFU_MODE_INTERFACE_COUNT] = {
+    [USB_DFU_MODE_INTERFACE_DFU] = &USB_DFU_class
+};
+
+/**
+ * @brief Routing table from endpoint number to class driver of the device in DFU mode, which only
+ *        uses the endpoint 0.
+ * @showinitializer
+ */
+const USB_Class_Driver_t* const dfu_endpoint_class_drivers[USB_ENDPOINT_COUNT] = {NULL};
+
+/**
+ * @brief Profiles of the device, indexed by @ref USBDeviceMode_t.
+ * @showinitializer
+ */
+const USB_Device_Profile_t device_profiles[USB_DEVICE_MODE_COUNT] = {
+    [USB_DEVICE_MODE_RUNTIME] = {
+        .descriptor_registry = descriptor_registry,
+        .descriptor_type_count = sizeof(descriptor_registry)/sizeof(descriptor_registry[0]),
+        .class_drivers = class_drivers,
+        .class_driver_count = sizeof(class_drivers)/sizeof(class_drivers[0]),
+        .interface_class_drivers = interface_class_drivers,
+        .interface_count = USB_INTERFACE_COUNT,
+        .in_endpoint_class_drivers = in_endpoint_class_drivers,
+        .out_endpoint_class_drivers = out_endpoint_class_drivers,
+        .configuration_value = 1,
+        .configuration_attributes = USB_CONFIG_ATTRIBUTES,
+        .msos20_descriptor_set = &msos20_descriptor_set,
+        .msos20_descriptor_set_length = sizeof(msos20_descriptor_set)
+    },
+    [USB_DEVICE_MODE_DFU] = {
+        .descriptor_registry = dfu_descriptor_registry,
+        .descriptor_type_count = sizeof(dfu_descriptor_registry)/sizeof(dfu_descriptor_registry[0]),
+        .class_drivers = dfu_class_drivers,
+        .class_driver_count = sizeof(dfu_class_drivers)/sizeof(dfu_class_drivers[0]),
+        .interface_class_drivers = dfu_interface_class_drivers,
+        .interface_count = USB_DFU_MODE_INTERFACE_COUNT,
+        .in_endpoint_class_drivers = dfu_endpoint_class_drivers,
+        .out_endpoint_class_drivers = dfu_endpoint_class_drivers,
+        .configuration_value = 1,
+        .configuration_attributes = USB_DFU_CONFIG_ATTRIBUTES,
+        .msos20_descriptor_set = &dfu_msos20_descriptor_set,
+        .msos20_descriptor_set_length = sizeof(dfu_msos20_descriptor_set)
     }
 };
 
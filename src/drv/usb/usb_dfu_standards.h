@@ -0,0 +1,103 @@
+/************************************************************************************************//**
+* @file usb_dfu_standards.h
+*
+* @brief Header file containing the typedef and definitions of the USB Device Firmware Upgrade
+*        (DFU 1.1) standard.
+*/
+
+#ifndef USB_DFU_STANDARDS_H
+#define USB_DFU_STANDARDS_H
+
+#include <stdint.h>
+
+#define USB_SUBCLASS_DFU                    0x01
+#define USB_PROTOCOL_DFU_RUNTIME            0x01
+#define USB_PROTOCOL_DFU_MODE               0x02
+
+/** @brief DFU functional descriptor type */
+#define USB_DESCRIPTOR_TYPE_DFU_FUNCTIONAL  0x21
+
+/**
+ * @defgroup USB_DFU_ATTRIBUTES USB DFU functional descriptor attributes (bmAttributes).
+ * @{
+ */
+#define USB_DFU_ATTR_CAN_DNLOAD             (1 << 0)
+#define USB_DFU_ATTR_CAN_UPLOAD             (1 << 1)
+#define USB_DFU_ATTR_MANIFESTATION_TOLERANT (1 << 2)
+#define USB_DFU_ATTR_WILL_DETACH            (1 << 3)
+/** @} */
+
+/**
+ * @defgroup USB_DFU_REQUESTS USB DFU class requests.
+ * @{
+ */
+#define USB_DFU_DETACH                      0x00
+#define USB_DFU_DNLOAD                      0x01
+#define USB_DFU_UPLOAD                      0x02
+#define USB_DFU_GETSTATUS                   0x03
+#define USB_DFU_CLRSTATUS                   0x04
+#define USB_DFU_GETSTATE                    0x05
+#define USB_DFU_ABORT                       0x06
+/** @} */
+
+/**
+ * @brief List of the states of a DFU device (bState).
+ */
+typedef enum
+{
+    USB_DFU_STATE_APP_IDLE,
+    USB_DFU_STATE_APP_DETACH,
+    USB_DFU_STATE_DFU_IDLE,
+    USB_DFU_STATE_DNLOAD_SYNC,
+    USB_DFU_STATE_DNBUSY,
+    USB_DFU_STATE_DNLOAD_IDLE,
+    USB_DFU_STATE_MANIFEST_SYNC,
+    USB_DFU_STATE_MANIFEST,
+    USB_DFU_STATE_MANIFEST_WAIT_RESET,
+    USB_DFU_STATE_UPLOAD_IDLE,
+    USB_DFU_STATE_ERROR
+}USBDFUState_t;
+
+/**
+ * @brief List of the status codes of a DFU device (bStatus).
+ */
+typedef enum
+{
+    USB_DFU_STATUS_OK,
+    USB_DFU_STATUS_ERR_TARGET,
+    USB_DFU_STATUS_ERR_FILE,
+    USB_DFU_STATUS_ERR_WRITE,
+    USB_DFU_STATUS_ERR_ERASE,
+    USB_DFU_STATUS_ERR_CHECK_ERASED,
+    USB_DFU_STATUS_ERR_PROG,
+    USB_DFU_STATUS_ERR_VERIFY,
+    USB_DFU_STATUS_ERR_ADDRESS,
+    USB_DFU_STATUS_ERR_NOTDONE,
+    USB_DFU_STATUS_ERR_FIRMWARE,
+    USB_DFU_STATUS_ERR_VENDOR,
+    USB_DFU_STATUS_ERR_USBR,
+    USB_DFU_STATUS_ERR_POR,
+    USB_DFU_STATUS_ERR_UNKNOWN,
+    USB_DFU_STATUS_ERR_STALLEDPKT
+}USBDFUStatus_t;
+
+typedef struct
+{
+    uint8_t bLength;
+    uint8_t bDescriptorType;
+    uint8_t bmAttributes;
+    uint16_t wDetachTimeOut;
+    uint16_t wTransferSize;
+    uint16_t bcdDFUVersion;
+} __attribute__((__packed__)) USB_DFU_FunctionalDescriptor_t;
+
+typedef struct
+{
+    uint8_t bStatus;
+    /** @brief Minimum time in ms the host waits before the next GETSTATUS (24 bit, little endian) */
+    uint8_t bwPollTimeout[3];
+    uint8_t bState;
+    uint8_t iString;
+} __attribute__((__packed__)) USB_DFU_Status_t;
+
+#endif /* USB_DFU_STANDARDS_H */
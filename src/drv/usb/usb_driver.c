@@ -9,10 +9,29 @@
 
 #include "usb_driver.h"
 #include "logger.h"
+#include "helper_math.h"
+#include "helper_sections.h"
+#include "cycle_counter.h"
+#include "system_stm32f4xx.h"
 #include "stm32f4xx.h"
 #include <stdint.h>
+#include <stdbool.h>
 #include <strings.h>
 
+#ifdef USB_IRQ_BENCHMARK
+/** @brief Number of served events measured by each report of the benchmark of the IRQ path */
+#define USB_IRQ_BENCHMARK_EVENTS    1000
+#endif
+
+#ifndef USB_FIFO_POP
+/** @brief Pops one word from the RxFIFO, the host benchmark replaces it with its simulated core */
+#define USB_FIFO_POP(fifo)          (*(fifo))
+#endif
+#ifndef USB_FIFO_PUSH
+/** @brief Pushes one word into the TxFIFO of an endpoint, the host benchmark replaces it too */
+#define USB_FIFO_PUSH(fifo, data)   (*(fifo) = (data))
+#endif
+
 /***************************************************************************************************/
 /*                                       Static Function Prototypes                                */
 /***************************************************************************************************/
@@ -56,6 +75,17 @@ static void USB_Configure_Endpoint0(uint16_t endpoint_size);
  */
 static void USB_Deconfigure_Endpoint(uint8_t endpoint_number);
 
+/**
+ * @brief Function for enabling an OUT endpoint for receiving a transfer.
+ * @param[in] endpoint_number is the number of the OUT endpoint to enable.
+ * @param[in] size is the maximum size of the transfer to be received in bytes, the endpoint 0 always
+ *            receives one packet while the rest of endpoints receive as many packets as needed.
+ * @return void
+ * @note For the endpoint 0 the SETUP packet counter is reloaded too. The transfer ends with a short
+ *       packet or once size bytes (rounded up to whole packets) are received.
+ */
+static void USB_Enable_OUT_Endpoint(uint8_t endpoint_number, uint16_t size);
+
 /**
  * @brief Function for configuring the RxFIFO of all OUT endpoints.
  * @param[in] size is the size of the largest OUT endpoint in bytes.
@@ -109,6 +139,20 @@ static inline __attribute__((always_inline)) void USB_In_Endpoint_Interrupt_Hand
  */
 static inline __attribute__((always_inline)) void USB_Out_Endpoint_Interrupt_Handler(void);
 
+/**
+ * @brief Function for managing the suspend interrupt of the USB peripheral. The PHY clock is
+ *        stopped and the clock of the core is gated until the bus resumes.
+ * @return void
+ */
+static inline __attribute__((always_inline)) void USB_Suspend_Handler(void);
+
+/**
+ * @brief Function for managing the resume (wakeup) interrupt of the USB peripheral. The clocks of
+ *        the PHY and the core are restored.
+ * @return void
+ */
+static inline __attribute__((always_inline)) void USB_Wakeup_Handler(void);
+
 /**
  * @brief Function for initializing the USB peripheral.
  * @return void.
@@ -145,13 +189,25 @@ static void USB_Configure_IN_Endpoint(uint8_t endpoint_number,
                                       USBEndpointType_t endpoint_type,
                                       uint16_t endpoint_size);
 
+/**
+ * @brief Function for configuring an OUT endpoint
+ * @param[in] endpoint_number is the number of the endpoint to configure.
+ * @param[in] endpoint_type is the type of endpoint to configure, @ref USBEndpointType_t.
+ * @param[in] endpoint_size is the size of the endpoint to configure.
+ * @return void
+ * @note The endpoint is left NAKing, it must be enabled with USB_Enable_OUT_Endpoint.
+ */
+static void USB_Configure_OUT_Endpoint(uint8_t endpoint_number,
+                                       USBEndpointType_t endpoint_type,
+                                       uint16_t endpoint_size);
+
 /**
  * @brief Function for popping data from the RxFIFO and storing it in a buffer.
  * @param[in] buffer is a pointer to a buffer, in which the popped data will be stored.
  * @param[in] size is the counting of bytes to be popped from the dedicated RxFIFO memory.
  * @return void
  */
-static void USB_Read_Packet(const void* buffer, uint16_t size);
+static RAM_FUNCTION void USB_Read_Packet(const void* buffer, uint16_t size);
 
 /**
  * @brief Function for pushing a packet into the TxFIFO of an IN endpoint.
@@ -160,7 +216,78 @@ static void USB_Read_Packet(const void* buffer, uint16_t size);
  * @param[in] size is the size of data to be written in bytes.
  * @return void
  */
-static void USB_Write_Packet(uint8_t endpoint_number, void const* buffer, uint16_t size);
+static RAM_FUNCTION void USB_Write_Packet(uint8_t endpoint_number, void const* buffer,
+                                          uint16_t size);
+
+/**
+ * @brief Function for starting an IN transfer of several packets on an endpoint other than 0. The
+ *        TxFIFO is filled with as many packets as fit, and refilled from the TxFIFO empty interrupt
+ *        while the previous packets are being sent.
+ * @param[in] endpoint_number is the number of the endpoint to which the data will be written.
+ * @param[in] buffer is a pointer to the data to be sent, it must remain valid until the transfer is
+ *            completed.
+ * @param[in] size is the size of data to be sent in bytes (up to 1023 packets).
+ * @return void
+ */
+static void USB_Write_Transfer(uint8_t endpoint_number, void const* buffer, uint32_t size);
+
+/**
+ * @brief Function for pushing the pending packets of an IN transfer into the TxFIFO of the endpoint,
+ *        as many as fit in its free space.
+ * @param[in] endpoint_number is the number of the IN endpoint to fill its TxFIFO.
+ * @return void
+ */
+static RAM_FUNCTION void USB_Fill_TxFIFO(uint8_t endpoint_number);
+
+/**
+ * @brief Function for pushing data into the TxFIFO of an IN endpoint.
+ * @param[in] endpoint_number is the number of the endpoint to which the data will be written.
+ * @param[in] buffer is a pointer to the buffer containing the data to be written to the endpoint.
+ * @param[in] size is the size of data to be written in bytes.
+ * @return void
+ */
+static RAM_FUNCTION void USB_Push_TxFIFO(uint8_t endpoint_number, void const* buffer, uint16_t size);
+
+/**
+ * @brief Function for answering the current control transfer with a STALL handshake.
+ * @return void
+ * @note The core clears the STALL of the endpoint 0 by itself when the next SETUP is received.
+ */
+static void USB_Stall_Control_Endpoint(void);
+
+/**
+ * @brief Function for halting an endpoint other than 0, it answers with a STALL handshake until the
+ *        halt is cleared.
+ * @param[in] endpoint_address is the address of the endpoint (number and direction bit).
+ * @return void
+ */
+static void USB_Stall_Endpoint(uint8_t endpoint_address);
+
+/**
+ * @brief Function for clearing the halt of an endpoint other than 0, its data toggle is reset too.
+ * @param[in] endpoint_address is the address of the endpoint (number and direction bit).
+ * @return void
+ */
+static void USB_Clear_Endpoint_Stall(uint8_t endpoint_address);
+
+/**
+ * @brief Function for checking whether an endpoint other than 0 is halted.
+ * @param[in] endpoint_address is the address of the endpoint (number and direction bit).
+ * @return true if the endpoint answers with a STALL handshake, false otherwise.
+ */
+static bool USB_Is_Endpoint_Stalled(uint8_t endpoint_address);
+
+/**
+ * @brief Function for starting the remote wakeup signaling while the bus is suspended.
+ * @return void
+ */
+static void USB_Start_Remote_Wakeup(void);
+
+/**
+ * @brief Function for stopping the remote wakeup signaling, the host goes on driving the resume.
+ * @return void
+ */
+static void USB_Stop_Remote_Wakeup(void);
 
 /**
  * @brief Function for flushing the RxFIFO of all OUT endpoints.
@@ -179,7 +306,22 @@ static void USB_Flush_TxFIFO(uint8_t endpoint_number);
  * @brief Function for managing the USB interrupt events.
  * @return void
  */
-static void USB_IRQ_Handler(void);
+static RAM_FUNCTION void USB_IRQ_Handler(void);
+
+/***************************************************************************************************/
+/*                                       Static Variables                                          */
+/***************************************************************************************************/
+
+/** @brief Maximum packet size of the endpoint 0 */
+static uint16_t endpoint0_size CCM_BSS;
+/** @brief Data of the IN transfers which is not pushed to the TxFIFOs yet */
+static uint8_t const* in_transfer_buffer[USB_ENDPOINT_COUNT] CCM_BSS;
+/** @brief Size of the data of the IN transfers which is not pushed to the TxFIFOs yet */
+static uint32_t in_transfer_remaining[USB_ENDPOINT_COUNT] CCM_BSS;
+#ifdef USB_IRQ_BENCHMARK
+/** @brief Cycles taken by the IRQ path for serving an event, up to the poll of the middleware */
+static Cycle_Stats_t usb_irq_benchmark CCM_BSS;
+#endif
 
 /***************************************************************************************************/
 /*                                       Global Variables                                          */
@@ -197,8 +339,17 @@ const USB_Driver_t USB_driver = {
     .USB_Flush_RxFIFO = &USB_Flush_RxFIFO,
     .USB_Flush_TxFIFO = &USB_Flush_TxFIFO,
     .USB_Configure_IN_Endpoint = &USB_Configure_IN_Endpoint,
+    .USB_Configure_OUT_Endpoint = &USB_Configure_OUT_Endpoint,
+    .USB_Enable_OUT_Endpoint = &USB_Enable_OUT_Endpoint,
     .USB_Read_Packet = &USB_Read_Packet,
     .USB_Write_Packet = &USB_Write_Packet,
+    .USB_Write_Transfer = &USB_Write_Transfer,
+    .USB_Stall_Control_Endpoint = &USB_Stall_Control_Endpoint,
+    .USB_Stall_Endpoint = &USB_Stall_Endpoint,
+    .USB_Clear_Endpoint_Stall = &USB_Clear_Endpoint_Stall,
+    .USB_Is_Endpoint_Stalled = &USB_Is_Endpoint_Stalled,
+    .USB_Start_Remote_Wakeup = &USB_Start_Remote_Wakeup,
+    .USB_Stop_Remote_Wakeup = &USB_Stop_Remote_Wakeup,
     .USB_Poll = &USB_IRQ_Handler
 };
 
@@ -239,8 +390,9 @@ static void USB_Configure_Endpoint0(uint16_t endpoint_size)
         USB_OTG_DIEPCTL_USBAEP | _VAL2FLD(USB_OTG_DIEPCTL_MPSIZ, endpoint_size) |
         USB_OTG_DIEPCTL_SNAK);
 
-    /* Clear NAK and enable endpoint data transmission */
-    SET_BIT(OUT_ENDPOINT(0)->DOEPCTL, USB_OTG_DOEPCTL_EPENA | USB_OTG_DOEPCTL_CNAK);
+    /* Clear NAK and enable endpoint data reception */
+    endpoint0_size = endpoint_size;
+    USB_Enable_OUT_Endpoint(0, endpoint_size);
 
     /* 64 bytes is the maximum packet size for full speed USB devices */
     USB_Configure_RxFIFO_Size(64);
@@ -254,6 +406,8 @@ static void USB_Deconfigure_Endpoint(uint8_t endpoint_number)
 
     /* Mask all interrupts of the IN and OUT endpoints */
     CLEAR_BIT(USB_OTG_HS_DEVICE->DAINTMSK, (1 << endpoint_number) | (1 << 16 << endpoint_number));
+    CLEAR_BIT(USB_OTG_HS_DEVICE->DIEPEMPMSK, 1 << endpoint_number);
+    in_transfer_remaining[endpoint_number] = 0;
 
     /* Clear all interrupts of the endpoint */
     SET_BIT(in_endpoint->DIEPINT, 0x29FF);
@@ -280,6 +434,33 @@ static void USB_Deconfigure_Endpoint(uint8_t endpoint_number)
     USB_Flush_RxFIFO();
 }
 
+static void USB_Enable_OUT_Endpoint(uint8_t endpoint_number, uint16_t size)
+{
+    USB_OTG_OUTEndpointTypeDef* out_endpoint = OUT_ENDPOINT(endpoint_number);
+    /* The endpoint 0 must always be able to accept back to back SETUP packets */
+    uint32_t setup_count = (endpoint_number == 0) ? _VAL2FLD(USB_OTG_DOEPTSIZ_STUPCNT, 3) : 0;
+    uint32_t packet_count = 1;
+    uint32_t packet_size = 0;
+
+    /* The rest of endpoints may receive several packets back to back, then the transfer size must
+       be a multiple of the packet size */
+    if(endpoint_number != 0){
+        packet_size = _FLD2VAL(USB_OTG_DOEPCTL_MPSIZ, out_endpoint->DOEPCTL);
+        packet_count = (size == 0) ? 1 : (size + packet_size - 1)/packet_size;
+        size = packet_count*packet_size;
+    }
+
+    /* Configure the rx (packet_count packets that have up to size bytes) */
+    WRITE_REG(
+        out_endpoint->DOEPTSIZ,
+        setup_count | _VAL2FLD(USB_OTG_DOEPTSIZ_PKTCNT, packet_count) |
+        _VAL2FLD(USB_OTG_DOEPTSIZ_XFRSIZ, size)
+    );
+
+    /* Clear NAK and enable the rx */
+    SET_BIT(out_endpoint->DOEPCTL, USB_OTG_DOEPCTL_CNAK | USB_OTG_DOEPCTL_EPENA);
+}
+
 static void USB_Configure_RxFIFO_Size(uint16_t size)
 {
     /* Space required to save status packets in RxFIFO and gets the size in term of 32 bits */
@@ -336,7 +517,7 @@ static inline __attribute__((always_inline)) void USB_RST_Handler(void)
 {
     log_info("USB reset signal was detected");
 
-    for(uint8_t i = 0; i <= USB_ENDPOINT_COUNT; i++){
+    for(uint8_t i = 0; i < USB_ENDPOINT_COUNT; i++){
         USB_Deconfigure_Endpoint(i);
     }
 
@@ -370,14 +551,22 @@ static inline __attribute__((always_inline)) void USB_RxFIFO_Non_Empty_Handler(v
             break;
         /* OUT packet (includes data) */
         case 0x02:
+            USB_events.USB_Out_Data_Received(endpoint_number, byte_count);
             break;
         /* SETUP stage has completed */
         case 0x04:
+            /* Re-arms the endpoint 0 for the DATA OUT or STATUS OUT stage, and the first packet of
+               the DATA IN or STATUS IN stage is queued straight away */
+            USB_Enable_OUT_Endpoint(0, endpoint0_size);
+            USB_events.USB_Setup_Completed(endpoint_number);
+            break;
         /* OUT transfer has completed */
         case 0x03:
-            /* Re-enables the tx on the endpoint */
-            SET_BIT(OUT_ENDPOINT(endpoint_number)->DOEPCTL,
-                    USB_OTG_DOEPCTL_CNAK | USB_OTG_DOEPCTL_EPENA);
+            /* Re-arms the endpoint 0 for the next DATA OUT, STATUS OUT or SETUP packet, the rest of
+               endpoints are enabled again by its owner once it is ready for more data */
+            if(endpoint_number == 0){
+                USB_Enable_OUT_Endpoint(0, endpoint0_size);
+            }
             break;
         default:
             break;
@@ -394,6 +583,11 @@ static inline __attribute__((always_inline)) void USB_In_Endpoint_Interrupt_Hand
         /* Clear interrupt flag */
         SET_BIT(IN_ENDPOINT(endpoint_number)->DIEPINT, USB_OTG_DIEPINT_XFRC);
     }
+    /* The TxFIFO empty flag is a status, it is only an interrupt while a transfer is being fed */
+    else if((IN_ENDPOINT(endpoint_number)->DIEPINT & USB_OTG_DIEPINT_TXFE) &&
+            (USB_OTG_HS_DEVICE->DIEPEMPMSK & (1 << endpoint_number))){
+        USB_Fill_TxFIFO(endpoint_number);
+    }
 }
 
 static inline __attribute__((always_inline)) void USB_Out_Endpoint_Interrupt_Handler(void)
@@ -408,6 +602,30 @@ static inline __attribute__((always_inline)) void USB_Out_Endpoint_Interrupt_Han
     }
 }
 
+static inline __attribute__((always_inline)) void USB_Suspend_Handler(void)
+{
+    /* The bus can be idle for 3 ms without being suspended, e.g. while the cable is unplugged */
+    if(!READ_BIT(USB_OTG_HS_DEVICE->DSTS, USB_OTG_DSTS_SUSPSTS)){
+        return;
+    }
+
+    log_info("USB suspend was detected");
+
+    /* Only the wakeup logic keeps running, it detects the resume and the reset signals */
+    SET_BIT(*USB_OTG_HS_PCGCCTL, USB_OTG_PCGCCTL_STOPCLK | USB_OTG_PCGCCTL_GATECLK);
+
+    USB_events.USB_Suspend_Received();
+}
+
+static inline __attribute__((always_inline)) void USB_Wakeup_Handler(void)
+{
+    CLEAR_BIT(*USB_OTG_HS_PCGCCTL, USB_OTG_PCGCCTL_STOPCLK | USB_OTG_PCGCCTL_GATECLK);
+
+    log_info("USB resume was detected");
+
+    USB_events.USB_Resume_Received();
+}
+
 static void USB_Init(void)
 {
     /* Enable the clock */
@@ -484,22 +702,45 @@ static void USB_Configure_IN_Endpoint(uint8_t endpoint_number,
         USB_OTG_DIEPCTL_SNAK | _VAL2FLD(USB_OTG_DIEPCTL_EPTYP, endpoint_type) |
         _VAL2FLD(USB_OTG_DIEPCTL_TXFNUM, endpoint_number) | USB_OTG_DIEPCTL_SD0PID_SEVNFRM);
 
-    USB_Configure_TxFIFO_Size(endpoint_number, endpoint_size);
+    /* Bulk endpoints get room for two packets, so the next packet is already in the TxFIFO when the
+       previous one is completed */
+    USB_Configure_TxFIFO_Size(
+        endpoint_number,
+        (endpoint_type == USB_ENDPOINT_TYPE_BULK) ? 2*endpoint_size : endpoint_size
+    );
 }
 
-static void USB_Read_Packet(const void* buffer, uint16_t size)
+static void USB_Configure_OUT_Endpoint(uint8_t endpoint_number,
+                                       USBEndpointType_t endpoint_type,
+                                       uint16_t endpoint_size)
 {
-    uint32_t* fifo = (uint32_t*)FIFO(0);
+    /* Unmask all interrupts of the OUT endpoint */
+    SET_BIT(USB_OTG_HS_DEVICE->DAINTMSK, 1 << 16 << endpoint_number);
+
+    /* Activate the endpoint, set endpoint handshake to NAK (not ready to receive data), set DATA0
+       packet and configures its type and its maximum packet size */
+    MODIFY_REG(
+        OUT_ENDPOINT(endpoint_number)->DOEPCTL,
+        USB_OTG_DOEPCTL_MPSIZ | USB_OTG_DOEPCTL_EPTYP,
+        USB_OTG_DOEPCTL_USBAEP | _VAL2FLD(USB_OTG_DOEPCTL_MPSIZ, endpoint_size) |
+        USB_OTG_DOEPCTL_SNAK | _VAL2FLD(USB_OTG_DOEPCTL_EPTYP, endpoint_type) |
+        USB_OTG_DOEPCTL_SD0PID_SEVNFRM);
+}
+
+static RAM_FUNCTION void USB_Read_Packet(const void* buffer, uint16_t size)
+{
+    __IO uint32_t* fifo = FIFO(0);
 
     for(; size >= 4; size -= 4, buffer += 4){
         /* Pops one 32 bit word of data (until there is less than one word remaining) */
-        uint32_t data = *fifo;
-        *((uint32_t*)buffer) = data;
+        uint32_t data = USB_FIFO_POP(fifo);
+        /* The buffer may be unaligned (e.g. pointing into a ring buffer) */
+        __UNALIGNED_UINT32_WRITE(buffer, data);
     }
 
     if(size > 0){
         /* Pops the last remaining bytes (which are less than one word) */
-        uint32_t data = *fifo;
+        uint32_t data = USB_FIFO_POP(fifo);
         /* Pop the last remaining bytes (which are less than one word) */
         for(; size > 0; size--, buffer++, data >>= 8){
             /* Store data in the buffer with the correct alignment */
@@ -508,9 +749,9 @@ static void USB_Read_Packet(const void* buffer, uint16_t size)
     }
 }
 
-static void USB_Write_Packet(uint8_t endpoint_number, void const* buffer, uint16_t size)
+static RAM_FUNCTION void USB_Write_Packet(uint8_t endpoint_number, void const* buffer,
+                                          uint16_t size)
 {
-    uint32_t* fifo = (uint32_t*)FIFO(endpoint_number);
     USB_OTG_INEndpointTypeDef* in_endpoint = IN_ENDPOINT(endpoint_number);
 
     /* Configure the tx (1 packet that has size bytes) */
@@ -527,13 +768,149 @@ static void USB_Write_Packet(uint8_t endpoint_number, void const* buffer, uint16
         USB_OTG_DIEPCTL_CNAK | USB_OTG_DIEPCTL_EPENA
     );
 
-    /* Get the size in term of 32 bit words (to avoid integer overflow in the loop) */
-    size = (size + 3)/4;
+    USB_Push_TxFIFO(endpoint_number, buffer, size);
+}
+
+static void USB_Write_Transfer(uint8_t endpoint_number, void const* buffer, uint32_t size)
+{
+    USB_OTG_INEndpointTypeDef* in_endpoint = IN_ENDPOINT(endpoint_number);
+    uint32_t packet_size = _FLD2VAL(USB_OTG_DIEPCTL_MPSIZ, in_endpoint->DIEPCTL);
+    /* A zero length transfer is sent as one zero length packet */
+    uint32_t packet_count = (size == 0) ? 1 : (size + packet_size - 1)/packet_size;
+
+    in_transfer_buffer[endpoint_number] = buffer;
+    in_transfer_remaining[endpoint_number] = size;
+
+    /* Configure the tx (packet_count packets that have size bytes) */
+    MODIFY_REG(
+        in_endpoint->DIEPTSIZ,
+        USB_OTG_DIEPTSIZ_PKTCNT | USB_OTG_DIEPTSIZ_XFRSIZ,
+        _VAL2FLD(USB_OTG_DIEPTSIZ_PKTCNT, packet_count) | _VAL2FLD(USB_OTG_DIEPTSIZ_XFRSIZ, size)
+    );
+
+    /* Enable the tx after clearing both STALL and NAK of the endpoint */
+    MODIFY_REG(
+        in_endpoint->DIEPCTL,
+        USB_OTG_DIEPCTL_STALL,
+        USB_OTG_DIEPCTL_CNAK | USB_OTG_DIEPCTL_EPENA
+    );
+
+    USB_Fill_TxFIFO(endpoint_number);
+}
+
+static RAM_FUNCTION void USB_Fill_TxFIFO(uint8_t endpoint_number)
+{
+    USB_OTG_INEndpointTypeDef* in_endpoint = IN_ENDPOINT(endpoint_number);
+    uint16_t packet_size = _FLD2VAL(USB_OTG_DIEPCTL_MPSIZ, in_endpoint->DIEPCTL);
+    uint16_t size = 0;
+
+    /* Only whole packets are pushed, the free space of the TxFIFO is given in 32 bit words */
+    while(in_transfer_remaining[endpoint_number] > 0){
+        size = MIN(in_transfer_remaining[endpoint_number], packet_size);
+        if(_FLD2VAL(USB_OTG_DTXFSTS_INEPTFSAV, in_endpoint->DTXFSTS) < ((size + 3)/4)){
+            break;
+        }
+        USB_Push_TxFIFO(endpoint_number, in_transfer_buffer[endpoint_number], size);
+        in_transfer_buffer[endpoint_number] += size;
+        in_transfer_remaining[endpoint_number] -= size;
+    }
+
+    /* The TxFIFO empty interrupt is only unmasked while there are packets waiting for room */
+    if(in_transfer_remaining[endpoint_number] > 0){
+        SET_BIT(USB_OTG_HS_DEVICE->DIEPEMPMSK, 1 << endpoint_number);
+    }
+    else{
+        CLEAR_BIT(USB_OTG_HS_DEVICE->DIEPEMPMSK, 1 << endpoint_number);
+    }
+}
+
+static RAM_FUNCTION void USB_Push_TxFIFO(uint8_t endpoint_number, void const* buffer, uint16_t size)
+{
+    __IO uint32_t* fifo = FIFO(endpoint_number);
+    uint32_t data = 0;
+
+    for(; size >= 4; size -= 4, buffer += 4){
+        /* Push the data to the TxFIFO, the buffer may be unaligned (e.g. pointing into a ring
+           buffer) */
+        USB_FIFO_PUSH(fifo, __UNALIGNED_UINT32_READ(buffer));
+    }
+
+    if(size > 0){
+        /* The last word is completed with zeros instead of reading past the end of the buffer */
+        for(uint8_t shift = 0; size > 0; size--, buffer++, shift += 8){
+            data |= (uint32_t)*(uint8_t const*)buffer << shift;
+        }
+        USB_FIFO_PUSH(fifo, data);
+    }
+}
+
+static void USB_Stall_Control_Endpoint(void)
+{
+    /* Stall both directions, the host may continue with a DATA or a STATUS stage */
+    SET_BIT(IN_ENDPOINT(0)->DIEPCTL, USB_OTG_DIEPCTL_STALL);
+    SET_BIT(OUT_ENDPOINT(0)->DOEPCTL, USB_OTG_DOEPCTL_STALL);
+}
+
+static void USB_Stall_Endpoint(uint8_t endpoint_address)
+{
+    uint8_t endpoint_number = USB_ENDPOINT_NUMBER(endpoint_address);
+
+    if(endpoint_address & USB_ENDPOINT_DIRECTION_IN){
+        /* The packets of the current transfer which are not in the TxFIFO yet are dropped */
+        in_transfer_remaining[endpoint_number] = 0;
+        CLEAR_BIT(USB_OTG_HS_DEVICE->DIEPEMPMSK, 1 << endpoint_number);
+        SET_BIT(IN_ENDPOINT(endpoint_number)->DIEPCTL, USB_OTG_DIEPCTL_STALL);
+    }
+    else{
+        SET_BIT(OUT_ENDPOINT(endpoint_number)->DOEPCTL, USB_OTG_DOEPCTL_STALL);
+    }
+}
+
+static void USB_Clear_Endpoint_Stall(uint8_t endpoint_address)
+{
+    uint8_t endpoint_number = USB_ENDPOINT_NUMBER(endpoint_address);
+
+    /* The next packet after clearing a halt always uses DATA0 */
+    if(endpoint_address & USB_ENDPOINT_DIRECTION_IN){
+        MODIFY_REG(
+            IN_ENDPOINT(endpoint_number)->DIEPCTL,
+            USB_OTG_DIEPCTL_STALL,
+            USB_OTG_DIEPCTL_SD0PID_SEVNFRM
+        );
+    }
+    else{
+        MODIFY_REG(
+            OUT_ENDPOINT(endpoint_number)->DOEPCTL,
+            USB_OTG_DOEPCTL_STALL,
+            USB_OTG_DOEPCTL_SD0PID_SEVNFRM
+        );
+    }
+}
+
+static bool USB_Is_Endpoint_Stalled(uint8_t endpoint_address)
+{
+    uint8_t endpoint_number = USB_ENDPOINT_NUMBER(endpoint_address);
 
-    for(; size > 0; size--, buffer += 4){
-        /* Push the data to the TxFIFO */
-        *fifo = *(uint32_t*)buffer;
+    if(endpoint_address & USB_ENDPOINT_DIRECTION_IN){
+        return READ_BIT(IN_ENDPOINT(endpoint_number)->DIEPCTL, USB_OTG_DIEPCTL_STALL) != 0;
     }
+
+    return READ_BIT(OUT_ENDPOINT(endpoint_number)->DOEPCTL, USB_OTG_DOEPCTL_STALL) != 0;
+}
+
+static void USB_Start_Remote_Wakeup(void)
+{
+    /* The core drives the resume signal, so its clocks can not be stopped anymore */
+    CLEAR_BIT(*USB_OTG_HS_PCGCCTL, USB_OTG_PCGCCTL_STOPCLK | USB_OTG_PCGCCTL_GATECLK);
+
+    log_info("USB remote wakeup signaling started");
+
+    SET_BIT(USB_OTG_HS_DEVICE->DCTL, USB_OTG_DCTL_RWUSIG);
+}
+
+static void USB_Stop_Remote_Wakeup(void)
+{
+    CLEAR_BIT(USB_OTG_HS_DEVICE->DCTL, USB_OTG_DCTL_RWUSIG);
 }
 
 static void USB_Flush_RxFIFO(void)
@@ -551,12 +928,22 @@ static void USB_Flush_TxFIFO(uint8_t endpoint_number)
     );
 }
 
-static void USB_IRQ_Handler(void)
+static RAM_FUNCTION void USB_IRQ_Handler(void)
 {
     volatile uint32_t irq = USB_OTG_HS_GLOBAL->GINTSTS;
-
+#ifdef USB_IRQ_BENCHMARK
+    uint32_t start_cycles = Cycle_Counter_Get();
+    uint32_t served = irq & USB_OTG_HS_GLOBAL->GINTMSK;
+#endif
+
+    /* Wakeup irq, it goes first since the core can not be accessed while its clock is gated */
+    if(irq & USB_OTG_GINTSTS_WKUINT){
+        USB_Wakeup_Handler();
+        /* Clear irq */
+        SET_BIT(USB_OTG_HS_GLOBAL->GINTSTS, USB_OTG_GINTSTS_WKUINT);
+    }
     /* Reset irq */
-    if(irq & USB_OTG_GINTSTS_USBRST){
+    else if(irq & USB_OTG_GINTSTS_USBRST){
         USB_RST_Handler();
         /* Clear irq */
         SET_BIT(USB_OTG_HS_GLOBAL->GINTSTS, USB_OTG_GINTSTS_USBRST);
@@ -583,9 +970,36 @@ static void USB_IRQ_Handler(void)
         /* Clear irq */
         SET_BIT(USB_OTG_HS_GLOBAL->GINTSTS, USB_OTG_GINTSTS_OEPINT);
     }
+    /* Start of frame irq */
+    else if(irq & USB_OTG_GINTSTS_SOF){
+        USB_events.USB_SOF_Received();
+        /* Clear irq */
+        SET_BIT(USB_OTG_HS_GLOBAL->GINTSTS, USB_OTG_GINTSTS_SOF);
+    }
+    /* Suspend irq */
+    else if(irq & USB_OTG_GINTSTS_USBSUSP){
+        /* Clear irq, before the clock of the core is gated */
+        SET_BIT(USB_OTG_HS_GLOBAL->GINTSTS, USB_OTG_GINTSTS_USBSUSP);
+        USB_Suspend_Handler();
+    }
     else{
         /* do nothing */
     }
 
     USB_events.USB_Polled();
+
+#ifdef USB_IRQ_BENCHMARK
+    /* The polls without events are not measured, they would hide the cost of serving one */
+    if(served){
+        Cycle_Stats_Record(&usb_irq_benchmark, Cycle_Counter_Get() - start_cycles);
+    }
+    if(usb_irq_benchmark.count >= USB_IRQ_BENCHMARK_EVENTS){
+        log_info("USB IRQ path at %lu MHz: min %lu, avg %lu, max %lu cycles",
+                 SystemCoreClock/1000000,
+                 usb_irq_benchmark.min,
+                 (uint32_t)(usb_irq_benchmark.total/usb_irq_benchmark.count),
+                 usb_irq_benchmark.max);
+        usb_irq_benchmark = (Cycle_Stats_t){0};
+    }
+#endif
 }
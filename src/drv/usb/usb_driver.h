@@ -12,6 +12,7 @@
 #include "stm32f4xx.h"
 #include "usb_standards.h"
 #include <stdint.h>
+#include <stdbool.h>
 
 #define USB_OTG_HS_GLOBAL ((USB_OTG_GlobalTypeDef*)(USB_OTG_HS_PERIPH_BASE + USB_OTG_GLOBAL_BASE))
 #define USB_OTG_HS_DEVICE ((USB_OTG_DeviceTypeDef*)(USB_OTG_HS_PERIPH_BASE + USB_OTG_DEVICE_BASE))
@@ -34,8 +35,19 @@ typedef struct
     void(*USB_Configure_IN_Endpoint)(uint8_t endpoint_number,
                                      USBEndpointType_t endpoint_type,
                                      uint16_t endpoint_size);
+    void(*USB_Configure_OUT_Endpoint)(uint8_t endpoint_number,
+                                      USBEndpointType_t endpoint_type,
+                                      uint16_t endpoint_size);
+    void(*USB_Enable_OUT_Endpoint)(uint8_t endpoint_number, uint16_t size);
     void(*USB_Read_Packet)(const void* buffer, uint16_t size);
     void(*USB_Write_Packet)(uint8_t endpoint_number, void const* buffer, uint16_t size);
+    void(*USB_Write_Transfer)(uint8_t endpoint_number, void const* buffer, uint32_t size);
+    void(*USB_Stall_Control_Endpoint)(void);
+    void(*USB_Stall_Endpoint)(uint8_t endpoint_address);
+    void(*USB_Clear_Endpoint_Stall)(uint8_t endpoint_address);
+    bool(*USB_Is_Endpoint_Stalled)(uint8_t endpoint_address);
+    void(*USB_Start_Remote_Wakeup)(void);
+    void(*USB_Stop_Remote_Wakeup)(void);
     void(*USB_Poll)(void);
 }USB_Driver_t;
 
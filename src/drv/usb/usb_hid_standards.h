@@ -13,6 +13,17 @@
 #define USB_DESCRIPTOR_TYPE_HID_REPORT  0x22
 #define USB_HID_COUNTRY_NONE            0
 
+/**
+ * @defgroup USB_HID_PROTOCOLS USB HID protocols (wValue of SET_PROTOCOL).
+ * @{
+ */
+#define USB_HID_PROTOCOL_BOOT           0
+#define USB_HID_PROTOCOL_REPORT         1
+/** @} */
+
+/** @brief Resolution in ms of the idle rate of SET_IDLE and GET_IDLE */
+#define USB_HID_IDLE_RATE_UNIT          4
+
 typedef struct
 {
     uint8_t bLength;
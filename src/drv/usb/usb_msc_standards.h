@@ -0,0 +1,116 @@
+/************************************************************************************************//**
+* @file usb_msc_standards.h
+*
+* @brief Header file containing the typedef and definitions of the USB Mass Storage Class standard
+*        (Bulk-Only Transport) and the SCSI commands transported by it.
+*/
+
+#ifndef USB_MSC_STANDARDS_H
+#define USB_MSC_STANDARDS_H
+
+#include <stdint.h>
+
+#define USB_SUBCLASS_MSC_SCSI               0x06
+#define USB_PROTOCOL_MSC_BOT                0x50
+
+/**
+ * @defgroup USB_MSC_REQUESTS USB MSC Bulk-Only Transport class requests.
+ * @{
+ */
+#define USB_MSC_GET_MAX_LUN                 0xFE
+#define USB_MSC_BOT_RESET                   0xFF
+/** @} */
+
+/** @brief Signature of the command block wrapper ("USBC" in little endian) */
+#define USB_MSC_CBW_SIGNATURE               0x43425355
+/** @brief Signature of the command status wrapper ("USBS" in little endian) */
+#define USB_MSC_CSW_SIGNATURE               0x53425355
+/** @brief Direction bit of the bmCBWFlags field, set for data sent to the host */
+#define USB_MSC_CBW_DIRECTION_IN            0x80
+
+/**
+ * @defgroup USB_MSC_CSW_STATUS USB MSC command status values.
+ * @{
+ */
+#define USB_MSC_CSW_STATUS_PASSED           0x00
+#define USB_MSC_CSW_STATUS_FAILED           0x01
+#define USB_MSC_CSW_STATUS_PHASE_ERROR      0x02
+/** @} */
+
+/**
+ * @defgroup USB_SCSI_COMMANDS SCSI operation codes supported by the device.
+ * @{
+ */
+#define USB_SCSI_TEST_UNIT_READY            0x00
+#define USB_SCSI_REQUEST_SENSE              0x03
+#define USB_SCSI_INQUIRY                    0x12
+#define USB_SCSI_MODE_SENSE_6               0x1A
+#define USB_SCSI_START_STOP_UNIT            0x1B
+#define USB_SCSI_PREVENT_ALLOW_REMOVAL      0x1E
+#define USB_SCSI_READ_FORMAT_CAPACITIES     0x23
+#define USB_SCSI_READ_CAPACITY_10           0x25
+#define USB_SCSI_READ_10                    0x28
+#define USB_SCSI_WRITE_10                   0x2A
+#define USB_SCSI_VERIFY_10                  0x2F
+#define USB_SCSI_SYNCHRONIZE_CACHE_10       0x35
+/** @} */
+
+/**
+ * @defgroup USB_SCSI_SENSE SCSI sense keys and additional sense codes.
+ * @{
+ */
+#define USB_SCSI_SENSE_NONE                 0x00
+#define USB_SCSI_SENSE_ILLEGAL_REQUEST      0x05
+#define USB_SCSI_ASC_NONE                   0x00
+#define USB_SCSI_ASC_INVALID_COMMAND        0x20
+#define USB_SCSI_ASC_LBA_OUT_OF_RANGE       0x21
+#define USB_SCSI_ASC_INVALID_FIELD_IN_CDB   0x24
+/** @} */
+
+typedef struct
+{
+    uint32_t dCBWSignature;
+    uint32_t dCBWTag;
+    uint32_t dCBWDataTransferLength;
+    uint8_t bmCBWFlags;
+    uint8_t bCBWLUN;
+    uint8_t bCBWCBLength;
+    uint8_t CBWCB[16];
+} __attribute__((__packed__)) USB_MSC_CBW_t;
+
+typedef struct
+{
+    uint32_t dCSWSignature;
+    uint32_t dCSWTag;
+    uint32_t dCSWDataResidue;
+    uint8_t bCSWStatus;
+} __attribute__((__packed__)) USB_MSC_CSW_t;
+
+typedef struct
+{
+    uint8_t peripheral;
+    uint8_t removable;
+    uint8_t version;
+    uint8_t response_data_format;
+    uint8_t additional_length;
+    uint8_t flags[3];
+    char vendor_id[8];
+    char product_id[16];
+    char product_revision[4];
+} __attribute__((__packed__)) USB_SCSI_InquiryData_t;
+
+typedef struct
+{
+    uint8_t response_code;
+    uint8_t obsolete;
+    uint8_t sense_key;
+    uint8_t information[4];
+    uint8_t additional_length;
+    uint8_t command_specific[4];
+    uint8_t additional_sense_code;
+    uint8_t additional_sense_code_qualifier;
+    uint8_t field_replaceable_unit_code;
+    uint8_t sense_key_specific[3];
+} __attribute__((__packed__)) USB_SCSI_SenseData_t;
+
+#endif /* USB_MSC_STANDARDS_H */
@@ -0,0 +1,139 @@
+/************************************************************************************************//**
+* @file usb_msos20_standards.h
+*
+* @brief Header file containing the typedef and definitions of the Microsoft OS 2.0 descriptors,
+*        which let Windows (8.1 or later) bind a driver such as WinUSB without an INF file.
+*/
+
+#ifndef USB_MSOS20_STANDARDS_H
+#define USB_MSOS20_STANDARDS_H
+
+#include "usb_standards.h"
+#include <stdint.h>
+
+/** @brief Minimum Windows version supporting the descriptors (Windows 8.1) */
+#define USB_MSOS20_WINDOWS_VERSION_8_1          0x06030000
+
+/**
+ * @brief Platform capability UUID of the MS OS 2.0 descriptors, it is
+ *        {D8DD60DF-4589-4CC7-9CD2-659D9E648A9F} stored with the byte order of the descriptor.
+ */
+#define USB_MSOS20_PLATFORM_UUID                                    \
+    {0xDF, 0x60, 0xDD, 0xD8, 0x89, 0x45, 0xC7, 0x4C,                \
+     0x9C, 0xD2, 0x65, 0x9D, 0x9E, 0x64, 0x8A, 0x9F}
+
+/**
+ * @defgroup USB_MSOS20_REQUESTS MS OS 2.0 vendor request indexes (wIndex).
+ * @{
+ */
+#define USB_MSOS20_DESCRIPTOR_INDEX             0x07
+#define USB_MSOS20_SET_ALT_ENUMERATION          0x08
+/** @} */
+
+/**
+ * @defgroup USB_MSOS20_DESCRIPTOR_TYPES MS OS 2.0 descriptor types (wDescriptorType).
+ * @{
+ */
+#define USB_MSOS20_SET_HEADER_DESCRIPTOR        0x00
+#define USB_MSOS20_SUBSET_HEADER_CONFIGURATION  0x01
+#define USB_MSOS20_SUBSET_HEADER_FUNCTION       0x02
+#define USB_MSOS20_FEATURE_COMPATIBLE_ID        0x03
+#define USB_MSOS20_FEATURE_REG_PROPERTY         0x04
+/** @} */
+
+/**
+ * @defgroup USB_MSOS20_PROPERTY_DATA_TYPES MS OS 2.0 registry property data types.
+ * @{
+ */
+#define USB_MSOS20_PROPERTY_REG_SZ              0x01
+#define USB_MSOS20_PROPERTY_REG_MULTI_SZ        0x07
+/** @} */
+
+/**
+ * @brief Struct with the fields of the MS OS 2.0 platform capability descriptor of the BOS.
+ */
+typedef struct
+{
+    uint8_t bLength;
+    uint8_t bDescriptorType;
+    uint8_t bDevCapabilityType;
+    uint8_t bReserved;
+    uint8_t PlatformCapabilityUUID[16];
+    uint32_t dwWindowsVersion;
+    uint16_t wMSOSDescriptorSetTotalLength;
+    uint8_t bMS_VendorCode;
+    uint8_t bAltEnumCode;
+} __attribute__((__packed__)) USB_MSOS20_PlatformDescriptor_t;
+
+typedef struct
+{
+    uint16_t wLength;
+    uint16_t wDescriptorType;
+    uint32_t dwWindowsVersion;
+    uint16_t wTotalLength;
+} __attribute__((__packed__)) USB_MSOS20_SetHeaderDescriptor_t;
+
+typedef struct
+{
+    uint16_t wLength;
+    uint16_t wDescriptorType;
+    uint8_t bConfigurationValue;
+    uint8_t bReserved;
+    uint16_t wTotalLength;
+} __attribute__((__packed__)) USB_MSOS20_ConfigurationSubsetHeader_t;
+
+typedef struct
+{
+    uint16_t wLength;
+    uint16_t wDescriptorType;
+    uint8_t bFirstInterface;
+    uint8_t bReserved;
+    uint16_t wSubsetLength;
+} __attribute__((__packed__)) USB_MSOS20_FunctionSubsetHeader_t;
+
+typedef struct
+{
+    uint16_t wLength;
+    uint16_t wDescriptorType;
+    uint8_t CompatibleID[8];
+    uint8_t SubCompatibleID[8];
+} __attribute__((__packed__)) USB_MSOS20_CompatibleIdDescriptor_t;
+
+/**
+ * @brief Macro for declaring the type of a registry property descriptor.
+ * @param[in] name is the string literal with the name of the property.
+ * @param[in] data is the string literal with the value of the property, a REG_MULTI_SZ value must
+ *            end with an explicit "\0".
+ * @note Both strings are encoded in UTF-16LE at compile time including their null terminator.
+ */
+#define USB_MSOS20_REG_PROPERTY_T(name, data)                   \
+    struct __attribute__((__packed__))                          \
+    {                                                           \
+        uint16_t wLength;                                       \
+        uint16_t wDescriptorType;                               \
+        uint16_t wPropertyDataType;                             \
+        uint16_t wPropertyNameLength;                           \
+        uint16_t PropertyName[sizeof(u"" name)/2];              \
+        uint16_t wPropertyDataLength;                           \
+        uint16_t PropertyData[sizeof(u"" data)/2];              \
+    }
+
+/**
+ * @brief Macro for initializing a registry property descriptor declared with
+ *        @ref USB_MSOS20_REG_PROPERTY_T.
+ * @param[in] type is the data type of the property, @ref USB_MSOS20_PROPERTY_DATA_TYPES.
+ * @param[in] name is the string literal with the name of the property.
+ * @param[in] data is the string literal with the value of the property.
+ */
+#define USB_MSOS20_REG_PROPERTY(type, name, data)                               \
+    {                                                                           \
+        .wLength = sizeof(USB_MSOS20_REG_PROPERTY_T(name, data)),               \
+        .wDescriptorType = USB_MSOS20_FEATURE_REG_PROPERTY,                     \
+        .wPropertyDataType = (type),                                            \
+        .wPropertyNameLength = sizeof(u"" name),                                \
+        .PropertyName = u"" name,                                               \
+        .wPropertyDataLength = sizeof(u"" data),                                \
+        .PropertyData = u"" data                                                \
+    }
+
+#endif /* USB_MSOS20_STANDARDS_H */
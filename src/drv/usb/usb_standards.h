@@ -48,6 +48,42 @@
 #define USB_STANDARD_SYNCH_FRAME        0x0C
 /** @} */
 
+/**
+ * @defgroup USB_STD_FEATURES USB Standard Feature Selectors.
+ * @brief Used by the SET_FEATURE and CLEAR_FEATURE requests.
+ * @{
+ */
+#define USB_FEATURE_ENDPOINT_HALT       0x00
+#define USB_FEATURE_DEVICE_REMOTE_WAKEUP 0x01
+/** @} */
+
+/**
+ * @defgroup USB_DEVICE_STATUS USB Device Status Bits.
+ * @brief Returned by the GET_STATUS request of the device.
+ * @{
+ */
+#define USB_DEVICE_STATUS_SELF_POWERED  0x01
+#define USB_DEVICE_STATUS_REMOTE_WAKEUP 0x02
+/** @} */
+
+/** @brief Status bit returned by the GET_STATUS request of an endpoint while it is halted */
+#define USB_ENDPOINT_STATUS_HALT        0x01
+
+/**
+ * @defgroup USB_CONFIG_ATTRIBUTES USB Configuration Attributes.
+ * @brief Used by the bmAttributes field of the configuration descriptor.
+ * @{
+ */
+#define USB_CONFIG_ATTR_RESERVED        0x80    /* Always set */
+#define USB_CONFIG_ATTR_SELF_POWERED    0x40
+#define USB_CONFIG_ATTR_REMOTE_WAKEUP   0x20
+/** @} */
+
+/** @brief Direction bit of an endpoint address, set for IN endpoints */
+#define USB_ENDPOINT_DIRECTION_IN       0x80
+/** @brief Macro for getting the endpoint number from an endpoint address */
+#define USB_ENDPOINT_NUMBER(address)    ((address) & 0x0F)
+
 /**
  * @defgroup USB_STD_DESCRIPTOR_TYPES USB Standard Descriptor Types.
  * @brief Used for indicating the type of descriptor.
@@ -75,6 +111,10 @@
 #define USB_DESCRIPTOR_TYPE_DEBUG           0x0A
 /** @brief Interface association (Only for composite devices) */
 #define USB_DESCRIPTOR_TYPE_INTERFACEASSOC  0x0B
+/** @brief Binary device object store (only for devices with bcdUSB 2.01 or later) */
+#define USB_DESCRIPTOR_TYPE_BOS             0x0F
+/** @brief Device capability (only inside the binary device object store) */
+#define USB_DESCRIPTOR_TYPE_DEVICE_CAPABILITY 0x10
 #define USB_DESCRIPTOR_TYPE_CS_INTERFACE    0x24
 #define USB_DESCRIPTOR_TYPE_CS_ENDPOINT     0x25
 /** @} */
@@ -116,6 +156,48 @@
 #define USB_PROTOCOL_VENDOR     0xFF
 /** @} */
 
+/**
+ * @defgroup USB_DEVICE_CAPABILITY_TYPES USB Device Capability Types.
+ * @brief Used for indicating the type of a device capability descriptor of the BOS.
+ * @{
+ */
+/** @brief USB 2.0 extension (link power management support) */
+#define USB_DEVICE_CAPABILITY_USB20_EXTENSION   0x02
+/** @brief Platform specific capability identified by an UUID */
+#define USB_DEVICE_CAPABILITY_PLATFORM          0x05
+/** @} */
+
+/**
+ * @defgroup USB_LANGID USB Language Identifiers.
+ * @brief Language identifiers used in the string descriptor zero.
+ * @{
+ */
+#define USB_LANGID_ENGLISH_US   0x0409
+/** @} */
+
+/**
+ * @brief Macro for declaring the type of a string descriptor which can store a string literal.
+ * @param[in] str is the string literal, it is encoded in UTF-16LE at compile time.
+ */
+#define USB_STRING_DESCRIPTOR_T(str)                    \
+    struct __attribute__((__packed__))                  \
+    {                                                   \
+        uint8_t bLength;                                \
+        uint8_t bDescriptorType;                        \
+        uint16_t wString[(sizeof(u"" str)/2) - 1];      \
+    }
+
+/**
+ * @brief Macro for initializing a string descriptor declared with @ref USB_STRING_DESCRIPTOR_T.
+ * @param[in] str is the string literal, the null terminator is not included in the descriptor.
+ */
+#define USB_STRING_DESCRIPTOR(str)                      \
+    {                                                   \
+        .bLength = sizeof(u"" str),                     \
+        .bDescriptorType = USB_DESCRIPTOR_TYPE_STRING,  \
+        .wString = u"" str                              \
+    }
+
 /**
  * @brief List of endpoint types.
  */
@@ -159,9 +241,13 @@ typedef struct
 {
     void(*USB_Reset_Received)(void);
     void(*USB_Setup_Data_Received)(uint8_t endpoint_number, uint16_t byte_cnt);
+    void(*USB_Setup_Completed)(uint8_t endpoint_number);
     void(*USB_Out_Data_Received)(uint8_t endpoint_number, uint16_t bcnt);
     void(*USB_In_Transfer_Completed)(uint8_t endpoint_number);
     void(*USB_Out_Transfer_Completed)(uint8_t endpoint_number);
+    void(*USB_SOF_Received)(void);
+    void(*USB_Suspend_Received)(void);
+    void(*USB_Resume_Received)(void);
     void(*USB_Polled)(void);
 }USB_Events_t;
 
@@ -284,4 +370,124 @@ typedef struct
     uint8_t bInterval;
 } __attribute__((__packed__)) USB_EndpointDescriptor_t;
 
+/**
+ * @brief Struct with the USB interface association descriptor fields.
+ */
+typedef struct
+{
+    /** @brief Provides the length of the descriptor in bytes */
+    uint8_t bLength;
+    /** @brief Must be value of @ref USB_DESCRIPTOR_TYPE_INTERFACEASSOC */
+    uint8_t bDescriptorType;
+    /** @brief Number of the first interface associated with the function */
+    uint8_t bFirstInterface;
+    /** @brief Number of contiguous interfaces associated with the function */
+    uint8_t bInterfaceCount;
+    /** @brief Class code of the function */
+    uint8_t bFunctionClass;
+    /** @brief Subclass code of the function */
+    uint8_t bFunctionSubClass;
+    /** @brief Protocol code of the function */
+    uint8_t bFunctionProtocol;
+    /** @brief Index of the string descriptor describing the function */
+    uint8_t iFunction;
+} __attribute__((__packed__)) USB_InterfaceAssocDescriptor_t;
+
+/**
+ * @brief Struct with the USB binary device object store (BOS) descriptor fields.
+ */
+typedef struct
+{
+    /** @brief Provides the length of the descriptor in bytes */
+    uint8_t bLength;
+    /** @brief Must be value of @ref USB_DESCRIPTOR_TYPE_BOS */
+    uint8_t bDescriptorType;
+    /** @brief The number of bytes in the BOS descriptor and its device capability descriptors */
+    uint16_t wTotalLength;
+    /** @brief Number of device capability descriptors in the BOS */
+    uint8_t bNumDeviceCaps;
+} __attribute__((__packed__)) USB_BOSDescriptor_t;
+
+/**
+ * @brief Struct with the USB 2.0 extension device capability descriptor fields.
+ */
+typedef struct
+{
+    /** @brief Provides the length of the descriptor in bytes */
+    uint8_t bLength;
+    /** @brief Must be value of @ref USB_DESCRIPTOR_TYPE_DEVICE_CAPABILITY */
+    uint8_t bDescriptorType;
+    /** @brief Must be value of @ref USB_DEVICE_CAPABILITY_USB20_EXTENSION */
+    uint8_t bDevCapabilityType;
+    /** @brief Supported features (bit 1 is link power management) */
+    uint32_t bmAttributes;
+} __attribute__((__packed__)) USB_USB20ExtensionDescriptor_t;
+
+/**
+ * @brief Struct with the USB string descriptor zero fields.
+ */
+typedef struct
+{
+    /** @brief Provides the length of the descriptor in bytes */
+    uint8_t bLength;
+    /** @brief Must be value of @ref USB_DESCRIPTOR_TYPE_STRING */
+    uint8_t bDescriptorType;
+    /** @brief Supported language code, possible value from @ref USB_LANGID */
+    uint16_t wLANGID0;
+} __attribute__((__packed__)) USB_LangIdDescriptor_t;
+
+/**
+ * @brief Struct for an entry of the descriptor registry.
+ */
+typedef struct
+{
+    /** @brief Descriptor index (low byte of wValue) the request must match */
+    uint8_t bIndex;
+    /** @brief Value of wIndex the request must match (language ID or interface number) */
+    uint16_t wIndex;
+    /** @brief Length of the descriptor in bytes */
+    uint16_t wLength;
+    /** @brief Pointer to the descriptor, NULL for unused entries */
+    void const* descriptor;
+}USB_DescriptorEntry_t;
+
+/**
+ * @brief List of the request fields used for selecting an entry of the descriptor registry.
+ */
+typedef enum
+{
+    USB_DESCRIPTOR_KEY_INDEX,       /**< @brief Entries are selected by the descriptor index */
+    USB_DESCRIPTOR_KEY_INTERFACE    /**< @brief Entries are selected by the interface (wIndex) */
+}USBDescriptorKey_t;
+
+/**
+ * @brief Struct for the entries of the descriptor registry that share the same descriptor type.
+ */
+typedef struct
+{
+    /** @brief Array of entries, the position of an entry is the value of its key */
+    USB_DescriptorEntry_t const* entries;
+    /** @brief Number of entries in the array */
+    uint8_t count;
+    /** @brief Field of the request used as position in the array, @ref USBDescriptorKey_t */
+    uint8_t key;
+}USB_DescriptorRegistryType_t;
+
+/**
+ * @brief Macro for initializing an entry of the descriptor registry.
+ * @param[in] index is the descriptor index.
+ * @param[in] windex is the expected wIndex of the request.
+ * @param[in] desc is the descriptor variable, its length is taken at compile time.
+ */
+#define USB_DESCRIPTOR_ENTRY(index, windex, desc) \
+    {.bIndex = (index), .wIndex = (windex), .wLength = sizeof(desc), .descriptor = &(desc)}
+
+/**
+ * @brief Macro for initializing the descriptor registry slot of a descriptor type.
+ * @param[in] array is the array of @ref USB_DescriptorEntry_t for the descriptor type.
+ * @param[in] key_field is the field used for selecting an entry, @ref USBDescriptorKey_t.
+ */
+#define USB_DESCRIPTOR_TYPE_ENTRIES(array, key_field) \
+    {.entries = (array), .count = sizeof(array)/sizeof((array)[0]), .key = (key_field)}
+
 #endif /* USB_STANDARDS_H */
\ No newline at end of file
@@ -0,0 +1,45 @@
+/************************************************************************************************//**
+* @file cycle_counter.c
+*
+* @brief File containing the APIs for measuring time in CPU cycles.
+*
+* Public Functions:
+*       - void Cycle_Counter_Init(void)
+*       - uint32_t Cycle_Counter_Get(void)
+*       - void Cycle_Stats_Record(Cycle_Stats_t* stats, uint32_t cycles)
+*
+* @note
+*       For further information about functions refer to the corresponding header file.
+**/
+
+#include "cycle_counter.h"
+#include "stm32f4xx.h"
+#include <stdint.h>
+
+/***************************************************************************************************/
+/*                                       Public API Definitions                                    */
+/***************************************************************************************************/
+
+void Cycle_Counter_Init(void)
+{
+    /* The trace block must be enabled for the DWT to count */
+    SET_BIT(CoreDebug->DEMCR, CoreDebug_DEMCR_TRCENA_Msk);
+    SET_BIT(DWT->CTRL, DWT_CTRL_CYCCNTENA_Msk);
+}
+
+uint32_t Cycle_Counter_Get(void)
+{
+    return DWT->CYCCNT;
+}
+
+void Cycle_Stats_Record(Cycle_Stats_t* stats, uint32_t cycles)
+{
+    if((stats->count == 0) || (cycles < stats->min)){
+        stats->min = cycles;
+    }
+    if(cycles > stats->max){
+        stats->max = cycles;
+    }
+    stats->total += cycles;
+    stats->count++;
+}
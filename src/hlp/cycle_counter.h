@@ -0,0 +1,56 @@
+/************************************************************************************************//**
+* @file cycle_counter.h
+*
+* @brief Header file containing the prototypes of the APIs for measuring time in CPU cycles.
+*
+* Public Functions:
+*       - void Cycle_Counter_Init(void)
+*       - uint32_t Cycle_Counter_Get(void)
+*       - void Cycle_Stats_Record(Cycle_Stats_t* stats, uint32_t cycles)
+*
+* @note
+*       The counter is the DWT cycle counter of the Cortex-M4, it wraps around every 2^32 cycles
+*       so the elapsed cycles are computed with an unsigned subtraction.
+*/
+
+#ifndef CYCLE_COUNTER_H
+#define CYCLE_COUNTER_H
+
+#include <stdint.h>
+
+/**
+ * @brief Structure for the statistics of the cycles taken by a measured code path.
+ */
+typedef struct
+{
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t total;
+}Cycle_Stats_t;
+
+/***************************************************************************************************/
+/*                                       APIs Supported                                            */
+/***************************************************************************************************/
+
+/**
+ * @brief Function for enabling the cycle counter.
+ * @return void
+ */
+void Cycle_Counter_Init(void);
+
+/**
+ * @brief Function for getting the current value of the cycle counter.
+ * @return the current value of the cycle counter.
+ */
+uint32_t Cycle_Counter_Get(void);
+
+/**
+ * @brief Function for adding a measurement to some statistics, they are reset by zeroing them.
+ * @param[in] stats is the statistics to be updated.
+ * @param[in] cycles is the measured number of cycles.
+ * @return void
+ */
+void Cycle_Stats_Record(Cycle_Stats_t* stats, uint32_t cycles);
+
+#endif /* CYCLE_COUNTER_H */
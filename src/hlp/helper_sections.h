@@ -0,0 +1,27 @@
+/************************************************************************************************//**
+* @file helper_sections.h
+*
+* @brief Header file containing the macros for placing code and data in the memories of the device.
+*
+* @note
+*       The CCM RAM is only reachable through the data bus of the core, so it can not hold code nor
+*       buffers accessed by other bus masters, but the core never waits for them on its accesses.
+*       The functions placed in SRAM are copied from the flash at startup together with the .data
+*       section, the linker adds veneers for the calls between the flash and the SRAM.
+*/
+
+#ifndef HELPER_SECTIONS_H
+#define HELPER_SECTIONS_H
+
+#ifdef NO_RAM_FUNCTIONS
+#define RAM_FUNCTION
+#else
+/** @brief Places a function in SRAM, so it runs without flash wait states */
+#define RAM_FUNCTION    __attribute__((section(".RamFunc"), noinline))
+#endif
+/** @brief Places initialized data in CCM RAM */
+#define CCM_DATA        __attribute__((section(".ccmdata")))
+/** @brief Places zero initialized data in CCM RAM */
+#define CCM_BSS         __attribute__((section(".ccmbss")))
+
+#endif /* HELPER_SECTIONS_H */
@@ -0,0 +1,92 @@
+/************************************************************************************************//**
+* @file ring_buffer.c
+*
+* @brief File containing the APIs for single producer single consumer ring buffers.
+*
+* Public Functions:
+*       - void Ring_Buffer_Init(Ring_Buffer_t* ring, uint8_t* buffer, uint32_t size)
+*       - void Ring_Buffer_Reset(Ring_Buffer_t* ring)
+*       - uint32_t Ring_Buffer_Count(Ring_Buffer_t const* ring)
+*       - uint32_t Ring_Buffer_Free(Ring_Buffer_t const* ring)
+*       - uint32_t Ring_Buffer_Write_Acquire(Ring_Buffer_t const* ring, uint8_t** data)
+*       - void Ring_Buffer_Write_Commit(Ring_Buffer_t* ring, uint32_t size)
+*       - uint32_t Ring_Buffer_Read_Acquire(Ring_Buffer_t const* ring, uint8_t const** data)
+*       - void Ring_Buffer_Read_Release(Ring_Buffer_t* ring, uint32_t size)
+*
+* @note
+*       For further information about functions refer to the corresponding header file.
+**/
+
+#include "ring_buffer.h"
+#include "helper_math.h"
+#include <stdint.h>
+#include <stdatomic.h>
+
+/***************************************************************************************************/
+/*                                       Public API Definitions                                    */
+/***************************************************************************************************/
+
+void Ring_Buffer_Init(Ring_Buffer_t* ring, uint8_t* buffer, uint32_t size)
+{
+    ring->buffer = buffer;
+    ring->size = size;
+    Ring_Buffer_Reset(ring);
+}
+
+void Ring_Buffer_Reset(Ring_Buffer_t* ring)
+{
+    ring->head = 0;
+    ring->tail = 0;
+}
+
+uint32_t Ring_Buffer_Count(Ring_Buffer_t const* ring)
+{
+    /* The free running indexes make the subtraction valid even after they overflow */
+    return ring->head - ring->tail;
+}
+
+uint32_t Ring_Buffer_Free(Ring_Buffer_t const* ring)
+{
+    return ring->size - Ring_Buffer_Count(ring);
+}
+
+uint32_t Ring_Buffer_Write_Acquire(Ring_Buffer_t const* ring, uint8_t** data)
+{
+    uint32_t offset = ring->head & (ring->size - 1);
+    uint32_t free_size = Ring_Buffer_Free(ring);
+
+    /* The space released by the reader is not overwritten before the reader is done with it */
+    atomic_thread_fence(memory_order_acquire);
+    *data = &ring->buffer[offset];
+
+    /* The free space ends either at the tail or at the end of the storage */
+    return MIN(free_size, ring->size - offset);
+}
+
+void Ring_Buffer_Write_Commit(Ring_Buffer_t* ring, uint32_t size)
+{
+    /* The data is stored before the reader can see the new head, even when one of them runs in an
+       interrupt (it is a DMB on the Cortex-M) */
+    atomic_thread_fence(memory_order_release);
+    ring->head += size;
+}
+
+uint32_t Ring_Buffer_Read_Acquire(Ring_Buffer_t const* ring, uint8_t const** data)
+{
+    uint32_t offset = ring->tail & (ring->size - 1);
+    uint32_t count = Ring_Buffer_Count(ring);
+
+    /* The data is not read before the head which publishes it */
+    atomic_thread_fence(memory_order_acquire);
+    *data = &ring->buffer[offset];
+
+    /* The stored data ends either at the head or at the end of the storage */
+    return MIN(count, ring->size - offset);
+}
+
+void Ring_Buffer_Read_Release(Ring_Buffer_t* ring, uint32_t size)
+{
+    /* The data is read before the writer can reuse its space */
+    atomic_thread_fence(memory_order_release);
+    ring->tail += size;
+}
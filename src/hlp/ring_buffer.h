@@ -0,0 +1,109 @@
+/************************************************************************************************//**
+* @file ring_buffer.h
+*
+* @brief Header file containing the prototypes of the APIs for single producer single consumer
+*        ring buffers.
+*
+* Public Functions:
+*       - void Ring_Buffer_Init(Ring_Buffer_t* ring, uint8_t* buffer, uint32_t size)
+*       - void Ring_Buffer_Reset(Ring_Buffer_t* ring)
+*       - uint32_t Ring_Buffer_Count(Ring_Buffer_t const* ring)
+*       - uint32_t Ring_Buffer_Free(Ring_Buffer_t const* ring)
+*       - uint32_t Ring_Buffer_Write_Acquire(Ring_Buffer_t const* ring, uint8_t** data)
+*       - void Ring_Buffer_Write_Commit(Ring_Buffer_t* ring, uint32_t size)
+*       - uint32_t Ring_Buffer_Read_Acquire(Ring_Buffer_t const* ring, uint8_t const** data)
+*       - void Ring_Buffer_Read_Release(Ring_Buffer_t* ring, uint32_t size)
+*
+* @note
+*       The buffers are zero-copy: the producer writes straight into the storage returned by
+*       Ring_Buffer_Write_Acquire and the consumer reads straight from the storage returned by
+*       Ring_Buffer_Read_Acquire. Both functions return the contiguous size only, so a second call
+*       is needed after the end of the storage is reached. The producer and the consumer may run in
+*       different contexts (e.g. an interrupt and the main loop), the indexes are published with
+*       memory barriers.
+*/
+
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <stdint.h>
+
+/**
+ * @brief Structure for managing a ring buffer. The indexes run freely and are wrapped with the
+ *        size, which must be a power of two.
+ */
+typedef struct
+{
+    uint8_t* buffer;            /**< @brief Storage of the ring buffer */
+    uint32_t size;              /**< @brief Size of the storage in bytes, a power of two */
+    volatile uint32_t head;     /**< @brief Index where the producer writes the next byte */
+    volatile uint32_t tail;     /**< @brief Index where the consumer reads the next byte */
+}Ring_Buffer_t;
+
+/***************************************************************************************************/
+/*                                       APIs Supported                                            */
+/***************************************************************************************************/
+
+/**
+ * @brief Function for initializing a ring buffer.
+ * @param[in] ring is a pointer to the ring buffer to be initialized.
+ * @param[in] buffer is a pointer to the storage of the ring buffer.
+ * @param[in] size is the size of the storage in bytes, it must be a power of two.
+ * @return void
+ */
+void Ring_Buffer_Init(Ring_Buffer_t* ring, uint8_t* buffer, uint32_t size);
+
+/**
+ * @brief Function for discarding all the data stored in a ring buffer.
+ * @param[in] ring is a pointer to the ring buffer.
+ * @return void
+ */
+void Ring_Buffer_Reset(Ring_Buffer_t* ring);
+
+/**
+ * @brief Function for getting the amount of data stored in a ring buffer.
+ * @param[in] ring is a pointer to the ring buffer.
+ * @return the amount of bytes stored.
+ */
+uint32_t Ring_Buffer_Count(Ring_Buffer_t const* ring);
+
+/**
+ * @brief Function for getting the free space of a ring buffer.
+ * @param[in] ring is a pointer to the ring buffer.
+ * @return the amount of free bytes.
+ */
+uint32_t Ring_Buffer_Free(Ring_Buffer_t const* ring);
+
+/**
+ * @brief Function for getting the contiguous free space where the producer can write.
+ * @param[in] ring is a pointer to the ring buffer.
+ * @param[out] data is a pointer where the address of the free space is returned.
+ * @return the amount of contiguous free bytes.
+ */
+uint32_t Ring_Buffer_Write_Acquire(Ring_Buffer_t const* ring, uint8_t** data);
+
+/**
+ * @brief Function for publishing the data written by the producer into the acquired space.
+ * @param[in] ring is a pointer to the ring buffer.
+ * @param[in] size is the amount of bytes written, it must not exceed the acquired space.
+ * @return void
+ */
+void Ring_Buffer_Write_Commit(Ring_Buffer_t* ring, uint32_t size);
+
+/**
+ * @brief Function for getting the contiguous data the consumer can read.
+ * @param[in] ring is a pointer to the ring buffer.
+ * @param[out] data is a pointer where the address of the stored data is returned.
+ * @return the amount of contiguous bytes stored.
+ */
+uint32_t Ring_Buffer_Read_Acquire(Ring_Buffer_t const* ring, uint8_t const** data);
+
+/**
+ * @brief Function for freeing the data already read by the consumer.
+ * @param[in] ring is a pointer to the ring buffer.
+ * @param[in] size is the amount of bytes read, it must not exceed the acquired data.
+ * @return void
+ */
+void Ring_Buffer_Read_Release(Ring_Buffer_t* ring, uint32_t size);
+
+#endif /* RING_BUFFER_H */
@@ -0,0 +1,57 @@
+/************************************************************************************************//**
+* @file stack_monitor.c
+*
+* @brief File containing the APIs for measuring the high-water mark of the stack.
+*
+* Public Functions:
+*       - void Stack_Monitor_Init(void)
+*       - uint32_t Stack_Monitor_Get_High_Water(void)
+*       - uint32_t Stack_Monitor_Get_Size(void)
+*
+* @note
+*       For further information about functions refer to the corresponding header file.
+**/
+
+#include "stack_monitor.h"
+#include "stm32f4xx.h"
+#include <stdint.h>
+
+/** @brief Pattern of the words of the stack not used yet */
+#define STACK_MONITOR_PATTERN       0xA5A5A5A5UL
+/** @brief Words below the stack pointer which are not painted, so the frame of the painting loop
+ *         is kept */
+#define STACK_MONITOR_GUARD_WORDS   16
+
+/** @brief Lowest address the stack can reach and top of the stack, set by the linker script */
+extern uint32_t _sstack;
+extern uint32_t _estack;
+
+/***************************************************************************************************/
+/*                                       Public API Definitions                                    */
+/***************************************************************************************************/
+
+void Stack_Monitor_Init(void)
+{
+    uint32_t* word = &_sstack;
+    uint32_t* end = (uint32_t*)__get_MSP() - STACK_MONITOR_GUARD_WORDS;
+
+    while(word < end){
+        *word++ = STACK_MONITOR_PATTERN;
+    }
+}
+
+uint32_t Stack_Monitor_Get_High_Water(void)
+{
+    uint32_t const* word = &_sstack;
+
+    /* The words are used from the top, so the first changed word from the bottom is the mark */
+    while((word < &_estack) && (*word == STACK_MONITOR_PATTERN)){
+        word++;
+    }
+    return (uint32_t)((uintptr_t)&_estack - (uintptr_t)word);
+}
+
+uint32_t Stack_Monitor_Get_Size(void)
+{
+    return (uint32_t)((uintptr_t)&_estack - (uintptr_t)&_sstack);
+}
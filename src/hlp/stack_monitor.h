@@ -0,0 +1,48 @@
+/************************************************************************************************//**
+* @file stack_monitor.h
+*
+* @brief Header file containing the prototypes of the APIs for measuring the high-water mark of the
+*        stack.
+*
+* Public Functions:
+*       - void Stack_Monitor_Init(void)
+*       - uint32_t Stack_Monitor_Get_High_Water(void)
+*       - uint32_t Stack_Monitor_Get_Size(void)
+*
+* @note
+*       The stack grows down from the end of the CCM RAM to the data placed there, whose end is
+*       marked by the linker script (_sstack). The free part of the stack is painted with a pattern,
+*       and the high-water mark is the distance from the top of the stack to the lowest word which
+*       does not hold it anymore.
+*/
+
+#ifndef STACK_MONITOR_H
+#define STACK_MONITOR_H
+
+#include <stdint.h>
+
+/***************************************************************************************************/
+/*                                       APIs Supported                                            */
+/***************************************************************************************************/
+
+/**
+ * @brief Function for painting the free part of the stack, below the frame of the caller. It
+ *        should be called as soon as possible, e.g. at the beginning of main.
+ * @return void
+ */
+void Stack_Monitor_Init(void);
+
+/**
+ * @brief Function for getting the maximum stack used since the stack was painted, it reads the
+ *        whole painted area so it should not be called often.
+ * @return the high-water mark of the stack in bytes.
+ */
+uint32_t Stack_Monitor_Get_High_Water(void);
+
+/**
+ * @brief Function for getting the space the stack can grow into.
+ * @return the size of the stack in bytes.
+ */
+uint32_t Stack_Monitor_Get_Size(void);
+
+#endif /* STACK_MONITOR_H */
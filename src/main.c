@@ -5,16 +5,34 @@
 **/
 
 #include "logger.h"
+#include "helper_sections.h"
 #include "gpio_driver.h"
 #include "usb_middleware.h"
+#include "usb_hid_class.h"
+#ifdef STACK_MONITOR
+#include "stack_monitor.h"
+#endif
 #include <stdint.h>
+#include <stdbool.h>
+
+#ifdef STACK_MONITOR
+/** @brief Number of polls of the device between the checks of the high-water mark of the stack */
+#define STACK_MONITOR_POLLS     100000
+#endif
 
 /***************************************************************************************************/
 /*                                       Static Variables                                          */
 /***************************************************************************************************/
 
-USB_Device_t usb_device;
-uint32_t buffer[8];
+/** @brief Control state of the device, in CCM RAM as the USB interrupt path uses it all the time */
+USB_Device_t usb_device CCM_BSS;
+uint32_t buffer[8] CCM_BSS;
+/** @brief State of the user button at the last poll */
+static bool user_button;
+#ifdef STACK_MONITOR
+/** @brief High-water mark of the stack at the last check, it is logged when it grows */
+static uint32_t stack_high_water;
+#endif
 
 /***************************************************************************************************/
 /*                                       Main Function                                             */
@@ -22,6 +40,12 @@ uint32_t buffer[8];
 
 int main(void){
 
+#ifdef STACK_MONITOR
+    uint32_t polls = 0;
+
+    Stack_Monitor_Init();
+#endif
+
     log_info("Program entrypoint");
 
     usb_device.ptr_out_buffer = &buffer;
@@ -31,5 +55,24 @@ int main(void){
 
     for(;;){
         USB_Device_Poll();
+
+        /* The user button is the left button of the mouse, it wakes the host up while suspended */
+        if(GPIO_Read_User_Button() != user_button){
+            user_button = !user_button;
+            USB_HID_Mouse_Update(0, 0, user_button ? 0x01 : 0x00);
+        }
+
+#ifdef STACK_MONITOR
+        if(++polls >= STACK_MONITOR_POLLS){
+            uint32_t high_water = Stack_Monitor_Get_High_Water();
+
+            polls = 0;
+            if(high_water > stack_high_water){
+                stack_high_water = high_water;
+                log_info("Stack high-water mark: %lu of %lu bytes", high_water,
+                         Stack_Monitor_Get_Size());
+            }
+        }
+#endif
     }
 }
\ No newline at end of file
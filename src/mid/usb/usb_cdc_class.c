@@ -0,0 +1,402 @@
+/************************************************************************************************//**
+* @file usb_cdc_class.c
+*
+* @brief File containing the CDC ACM (virtual serial port) class driver of the USB device.
+*
+* Public Functions:
+*       - uint32_t USB_CDC_Write_Acquire(uint8_t** data)
+*       - void USB_CDC_Write_Commit(uint32_t size)
+*       - uint32_t USB_CDC_Read_Acquire(uint8_t const** data)
+*       - void USB_CDC_Read_Release(uint32_t size)
+*       - bool USB_CDC_Is_Open(void)
+*       - USB_CDC_LineCoding_t const* USB_CDC_Get_Line_Coding(void)
+*
+* @note
+*       For further information about functions refer to the corresponding header file.
+**/
+
+#include "usb_cdc_class.h"
+#include "usb_middleware.h"
+#include "usb_driver.h"
+#include "usb_device_config.h"
+#include "ring_buffer.h"
+#include "helper_math.h"
+#include "helper_sections.h"
+#include "logger.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+_Static_assert((USB_CDC_TX_BUFFER_SIZE & (USB_CDC_TX_BUFFER_SIZE - 1)) == 0,
+               "The size of the CDC transmission buffer must be a power of two");
+_Static_assert((USB_CDC_RX_BUFFER_SIZE & (USB_CDC_RX_BUFFER_SIZE - 1)) == 0,
+               "The size of the CDC reception buffer must be a power of two");
+_Static_assert(USB_CDC_RX_BUFFER_SIZE >= USB_CDC_DATA_PACKET_SIZE,
+               "The CDC reception buffer must hold at least one packet");
+
+/***************************************************************************************************/
+/*                                       Static Variables                                          */
+/***************************************************************************************************/
+
+/** @brief Storage of the ring buffer for the data sent to the host */
+static uint8_t cdc_tx_storage[USB_CDC_TX_BUFFER_SIZE] __attribute__((aligned(4))) CCM_BSS;
+/** @brief Storage of the ring buffer for the data received from the host */
+static uint8_t cdc_rx_storage[USB_CDC_RX_BUFFER_SIZE] __attribute__((aligned(4))) CCM_BSS;
+/** @brief Ring buffer for the data sent to the host */
+static Ring_Buffer_t cdc_tx_ring CCM_DATA = {cdc_tx_storage, USB_CDC_TX_BUFFER_SIZE, 0, 0};
+/** @brief Ring buffer for the data received from the host */
+static Ring_Buffer_t cdc_rx_ring CCM_DATA = {cdc_rx_storage, USB_CDC_RX_BUFFER_SIZE, 0, 0};
+
+/** @brief Line coding set by the host, it has no effect on the data transfers */
+static USB_CDC_LineCoding_t cdc_line_coding = {
+    .dwDTERate = 115200,
+    .bCharFormat = 0,   /* 1 stop bit */
+    .bParityType = 0,   /* None */
+    .bDataBits = 8
+};
+
+/** @brief Control line state (DTR and RTS) set by the host */
+static uint16_t cdc_control_line_state;
+/** @brief Flag indicating the endpoints of the CDC interfaces are configured */
+static bool cdc_configured;
+/** @brief Amount of bytes of the transmission ring buffer being sent in the current IN transfer */
+static uint32_t cdc_in_flight_size;
+/** @brief Flag indicating an IN transfer is being sent on the data endpoint */
+static bool cdc_in_busy;
+/** @brief Flag indicating the last IN transfer ended with a full packet, so a zero length packet
+           ends the transfer */
+static bool cdc_in_zero_length_packet;
+/** @brief Flag indicating the OUT data endpoint is enabled for receiving a packet */
+static bool cdc_out_armed;
+/** @brief Flag indicating a notification is being sent on the notification endpoint */
+static bool cdc_notify_busy;
+/** @brief Buffer of the serial state notification, it must remain valid while it is sent */
+static USB_CDC_SerialStateNotification_t cdc_serial_state_notification;
+
+/***************************************************************************************************/
+/*                                       Static Function Prototypes                                */
+/***************************************************************************************************/
+
+/**
+ * @brief Function for configuring the endpoints of the CDC interfaces.
+ * @return void
+ */
+static void cdc_init(void);
+
+/**
+ * @brief Function for releasing the CDC interfaces when the configuration is lost.
+ * @return void
+ */
+static void cdc_deinit(void);
+
+/**
+ * @brief Function for processing a request addressed to the CDC communication interface.
+ * @param[in] request is a pointer to the received request.
+ * @return true if the request is supported, false otherwise.
+ */
+static bool cdc_setup(USB_Request_t const* request);
+
+/**
+ * @brief Function for managing a completed IN transfer of the CDC endpoints.
+ * @param[in] endpoint_number is the endpoint number for the IN transfer.
+ * @return void
+ */
+static void cdc_data_in(uint8_t endpoint_number);
+
+/**
+ * @brief Function for popping a packet received on the OUT data endpoint into the reception ring
+ *        buffer.
+ * @param[in] endpoint_number is the endpoint number which received the packet.
+ * @param[in] byte_cnt is the size of the received packet in bytes.
+ * @return void
+ */
+static void cdc_data_out(uint8_t endpoint_number, uint16_t byte_cnt);
+
+/**
+ * @brief Function for managing a completed OUT transfer of the data endpoint.
+ * @param[in] endpoint_number is the endpoint number for the OUT transfer.
+ * @return void
+ */
+static void cdc_data_out_completed(uint8_t endpoint_number);
+
+/**
+ * @brief Function called when the data of a SET_LINE_CODING request has been received.
+ * @param[in] request is a pointer to the received request.
+ * @param[in] size is the amount of bytes stored in the line coding.
+ * @return void
+ */
+static void cdc_line_coding_received(USB_Request_t const* request, uint16_t size);
+
+/**
+ * @brief Function for sending the contiguous data of the transmission ring buffer as one transfer,
+ *        if the IN data endpoint is idle.
+ * @return void
+ */
+static void cdc_start_in_transfer(void);
+
+/**
+ * @brief Function for enabling the OUT data endpoint, if the reception ring buffer has room for a
+ *        whole packet.
+ * @return void
+ */
+static void cdc_arm_out_endpoint(void);
+
+/**
+ * @brief Function for sending a serial state notification to the host.
+ * @param[in] serial_state is the bitmap of the serial state (e.g. DCD and DSR).
+ * @return void
+ */
+static void cdc_notify_serial_state(uint16_t serial_state);
+
+/***************************************************************************************************/
+/*                                       Global Variables                                          */
+/***************************************************************************************************/
+
+/**
+ * @brief Structure with the callbacks of the CDC class driver.
+ * @showinitializer
+ */
+const USB_Class_Driver_t USB_CDC_class = {
+    .Init = &cdc_init,
+    .Deinit = &cdc_deinit,
+    .Reset = NULL,
+    .Setup = &cdc_setup,
+    .Data_In = &cdc_data_in,
+    .Data_Out = &cdc_data_out,
+    .Data_Out_Completed = &cdc_data_out_completed,
+    .SOF = NULL,
+    .Poll = NULL
+};
+
+/***************************************************************************************************/
+/*                                       Public API Definitions                                    */
+/***************************************************************************************************/
+
+uint32_t USB_CDC_Write_Acquire(uint8_t** data)
+{
+    return Ring_Buffer_Write_Acquire(&cdc_tx_ring, data);
+}
+
+void USB_CDC_Write_Commit(uint32_t size)
+{
+    Ring_Buffer_Write_Commit(&cdc_tx_ring, size);
+    cdc_start_in_transfer();
+}
+
+uint32_t USB_CDC_Read_Acquire(uint8_t const** data)
+{
+    return Ring_Buffer_Read_Acquire(&cdc_rx_ring, data);
+}
+
+void USB_CDC_Read_Release(uint32_t size)
+{
+    Ring_Buffer_Read_Release(&cdc_rx_ring, size);
+    /* The endpoint may be NAKing because the ring buffer was full */
+    cdc_arm_out_endpoint();
+}
+
+bool USB_CDC_Is_Open(void)
+{
+    return cdc_configured && (cdc_control_line_state & USB_CDC_CONTROL_LINE_DTR);
+}
+
+USB_CDC_LineCoding_t const* USB_CDC_Get_Line_Coding(void)
+{
+    return &cdc_line_coding;
+}
+
+/***************************************************************************************************/
+/*                                       Static Function Definitions                               */
+/***************************************************************************************************/
+
+static void cdc_init(void)
+{
+    USB_driver.USB_Configure_IN_Endpoint(
+        USB_ENDPOINT_NUMBER(USB_CDC_NOTIFY_ENDPOINT),
+        USB_ENDPOINT_TYPE_INTERRUPT,
+        USB_CDC_NOTIFY_PACKET_SIZE
+    );
+    USB_driver.USB_Configure_IN_Endpoint(
+        USB_ENDPOINT_NUMBER(USB_CDC_IN_ENDPOINT),
+        USB_ENDPOINT_TYPE_BULK,
+        USB_CDC_DATA_PACKET_SIZE
+    );
+    USB_driver.USB_Configure_OUT_Endpoint(
+        USB_ENDPOINT_NUMBER(USB_CDC_OUT_ENDPOINT),
+        USB_ENDPOINT_TYPE_BULK,
+        USB_CDC_DATA_PACKET_SIZE
+    );
+
+    cdc_configured = true;
+    cdc_in_busy = false;
+    cdc_in_zero_length_packet = false;
+    cdc_out_armed = false;
+    cdc_notify_busy = false;
+
+    /* Data queued by the application before the enumeration is sent right away */
+    cdc_arm_out_endpoint();
+    cdc_start_in_transfer();
+}
+
+static void cdc_deinit(void)
+{
+    cdc_configured = false;
+    cdc_control_line_state = 0;
+    Ring_Buffer_Reset(&cdc_tx_ring);
+    Ring_Buffer_Reset(&cdc_rx_ring);
+}
+
+static bool cdc_setup(USB_Request_t const* request)
+{
+    if((request->bmRequestType & USB_BM_REQUEST_TYPE_TYPE_MASK) != USB_BM_REQUEST_TYPE_TYPE_CLASS){
+        return false;
+    }
+
+    switch(request->bRequest){
+        case USB_CDC_SET_LINE_CODING:
+            USB_Control_Receive(&cdc_line_coding,
+                                sizeof(cdc_line_coding),
+                                &cdc_line_coding_received);
+            return true;
+        case USB_CDC_GET_LINE_CODING:
+            USB_Control_Send(&cdc_line_coding, sizeof(cdc_line_coding));
+            return true;
+        case USB_CDC_SET_CONTROL_LINE_STATE:
+            log_info("CDC control line state set to 0x%02X", request->wValue);
+            /* Report the carrier once the terminal is opened, some hosts wait for it */
+            if((request->wValue & USB_CDC_CONTROL_LINE_DTR) &&
+               !(cdc_control_line_state & USB_CDC_CONTROL_LINE_DTR)){
+                cdc_notify_serial_state(USB_CDC_SERIAL_STATE_DCD | USB_CDC_SERIAL_STATE_DSR);
+            }
+            cdc_control_line_state = request->wValue;
+            USB_Control_Acknowledge();
+            return true;
+        case USB_CDC_SEND_BREAK:
+            USB_Control_Acknowledge();
+            return true;
+        default:
+            return false;
+    }
+}
+
+static void cdc_data_in(uint8_t endpoint_number)
+{
+    if(endpoint_number == USB_ENDPOINT_NUMBER(USB_CDC_NOTIFY_ENDPOINT)){
+        cdc_notify_busy = false;
+    }
+    else if(endpoint_number == USB_ENDPOINT_NUMBER(USB_CDC_IN_ENDPOINT)){
+        /* The transfer has been sent from the ring buffer, so its space can be reused now */
+        Ring_Buffer_Read_Release(&cdc_tx_ring, cdc_in_flight_size);
+        cdc_in_busy = false;
+        cdc_start_in_transfer();
+    }
+}
+
+static void cdc_data_out(__attribute__((unused))uint8_t endpoint_number, uint16_t byte_cnt)
+{
+    uint8_t* data;
+    uint32_t word;
+    uint16_t aligned_size, split_size, tail_size;
+    uint32_t size = Ring_Buffer_Write_Acquire(&cdc_rx_ring, &data);
+
+    /* The endpoint is only enabled when there is room for a whole packet */
+    if(size >= byte_cnt){
+        USB_driver.USB_Read_Packet(data, byte_cnt);
+        Ring_Buffer_Write_Commit(&cdc_rx_ring, byte_cnt);
+        return;
+    }
+
+    /* The packet wraps around the end of the storage, the RxFIFO is popped in 32 bit words so the
+       word holding the wrap point is split by hand */
+    aligned_size = size & ~3UL;
+    split_size = MIN(4, byte_cnt - aligned_size);
+    tail_size = size - aligned_size;
+
+    USB_driver.USB_Read_Packet(data, aligned_size);
+    USB_driver.USB_Read_Packet(&word, split_size);
+    memcpy(data + aligned_size, &word, tail_size);
+    Ring_Buffer_Write_Commit(&cdc_rx_ring, size);
+
+    Ring_Buffer_Write_Acquire(&cdc_rx_ring, &data);
+    memcpy(data, (uint8_t*)&word + tail_size, split_size - tail_size);
+    USB_driver.USB_Read_Packet(data + split_size - tail_size,
+                               byte_cnt - aligned_size - split_size);
+    Ring_Buffer_Write_Commit(&cdc_rx_ring, byte_cnt - size);
+}
+
+static void cdc_data_out_completed(__attribute__((unused))uint8_t endpoint_number)
+{
+    cdc_out_armed = false;
+    cdc_arm_out_endpoint();
+}
+
+static void cdc_line_coding_received(__attribute__((unused))USB_Request_t const* request,
+                                     __attribute__((unused))uint16_t size)
+{
+    log_info("CDC line coding set to %lu baud, %u data bits",
+             (unsigned long)cdc_line_coding.dwDTERate,
+             cdc_line_coding.bDataBits);
+}
+
+static void cdc_start_in_transfer(void)
+{
+    uint8_t const* data;
+    uint32_t size;
+
+    if(!cdc_configured || cdc_in_busy){
+        return;
+    }
+
+    /* All the contiguous data goes in one multi-packet transfer, the driver refills the TxFIFO
+       without waiting for each packet to be completed */
+    size = Ring_Buffer_Read_Acquire(&cdc_tx_ring, &data);
+
+    /* A transfer ending with a full packet needs a zero length packet, otherwise the host keeps
+       waiting for more data */
+    if((size == 0) && !cdc_in_zero_length_packet){
+        return;
+    }
+
+    cdc_in_busy = true;
+    cdc_in_flight_size = size;
+    cdc_in_zero_length_packet = (size != 0) && ((size % USB_CDC_DATA_PACKET_SIZE) == 0);
+    USB_driver.USB_Write_Transfer(USB_ENDPOINT_NUMBER(USB_CDC_IN_ENDPOINT), data, size);
+}
+
+static void cdc_arm_out_endpoint(void)
+{
+    if(!cdc_configured || cdc_out_armed ||
+       (Ring_Buffer_Free(&cdc_rx_ring) < USB_CDC_DATA_PACKET_SIZE)){
+        return;
+    }
+
+    cdc_out_armed = true;
+    USB_driver.USB_Enable_OUT_Endpoint(
+        USB_ENDPOINT_NUMBER(USB_CDC_OUT_ENDPOINT),
+        USB_CDC_DATA_PACKET_SIZE
+    );
+}
+
+static void cdc_notify_serial_state(uint16_t serial_state)
+{
+    if(cdc_notify_busy){
+        return;
+    }
+
+    cdc_serial_state_notification.bmRequestType = USB_BM_REQUEST_TYPE_DIRECTION_TOHOST |
+                                                  USB_BM_REQUEST_TYPE_TYPE_CLASS |
+                                                  USB_BM_REQUEST_TYPE_RECIPIENT_INTERFACE;
+    cdc_serial_state_notification.bNotification = USB_CDC_NOTIFICATION_SERIAL_STATE;
+    cdc_serial_state_notification.wValue = 0;
+    cdc_serial_state_notification.wIndex = USB_INTERFACE_CDC_COMM;
+    cdc_serial_state_notification.wLength = sizeof(cdc_serial_state_notification.wData);
+    cdc_serial_state_notification.wData = serial_state;
+
+    cdc_notify_busy = true;
+    USB_driver.USB_Write_Packet(
+        USB_ENDPOINT_NUMBER(USB_CDC_NOTIFY_ENDPOINT),
+        &cdc_serial_state_notification,
+        sizeof(cdc_serial_state_notification)
+    );
+}
@@ -0,0 +1,83 @@
+/************************************************************************************************//**
+* @file usb_cdc_class.h
+*
+* @brief Header file containing the CDC ACM (virtual serial port) class driver of the USB device.
+*
+* Public Functions:
+*       - uint32_t USB_CDC_Write_Acquire(uint8_t** data)
+*       - void USB_CDC_Write_Commit(uint32_t size)
+*       - uint32_t USB_CDC_Read_Acquire(uint8_t const** data)
+*       - void USB_CDC_Read_Release(uint32_t size)
+*       - bool USB_CDC_Is_Open(void)
+*       - USB_CDC_LineCoding_t const* USB_CDC_Get_Line_Coding(void)
+*
+* @note
+*       The application writes straight into the transmission ring buffer and the bulk IN packets
+*       are pushed to the TxFIFO from it, the bulk OUT packets are popped from the RxFIFO straight
+*       into the reception ring buffer, so no intermediate copies are done.
+*/
+
+#ifndef USB_CDC_CLASS_H
+#define USB_CDC_CLASS_H
+
+#include "usb_class.h"
+#include "usb_cdc_standards.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/** @brief Size of the ring buffer for the data sent to the host, it must be a power of two */
+#define USB_CDC_TX_BUFFER_SIZE  2048
+/** @brief Size of the ring buffer for the data received from the host, it must be a power of two */
+#define USB_CDC_RX_BUFFER_SIZE  512
+
+/***************************************************************************************************/
+/*                                       Exported Variables                                        */
+/***************************************************************************************************/
+
+extern const USB_Class_Driver_t USB_CDC_class;
+
+/***************************************************************************************************/
+/*                                       APIs Supported                                            */
+/***************************************************************************************************/
+
+/**
+ * @brief Function for getting the contiguous free space of the transmission ring buffer.
+ * @param[out] data is a pointer where the address of the free space is returned.
+ * @return the amount of bytes which can be written at the returned address.
+ */
+uint32_t USB_CDC_Write_Acquire(uint8_t** data);
+
+/**
+ * @brief Function for queueing the data written into the acquired space for sending to the host.
+ * @param[in] size is the amount of bytes written, it must not exceed the acquired space.
+ * @return void
+ */
+void USB_CDC_Write_Commit(uint32_t size);
+
+/**
+ * @brief Function for getting the contiguous data received from the host.
+ * @param[out] data is a pointer where the address of the received data is returned.
+ * @return the amount of bytes which can be read at the returned address.
+ */
+uint32_t USB_CDC_Read_Acquire(uint8_t const** data);
+
+/**
+ * @brief Function for freeing the received data already processed by the application.
+ * @param[in] size is the amount of bytes processed, it must not exceed the acquired data.
+ * @return void
+ */
+void USB_CDC_Read_Release(uint32_t size);
+
+/**
+ * @brief Function for checking if a terminal on the host has opened the port (DTR is set).
+ * @return true if the port is open, false otherwise.
+ */
+bool USB_CDC_Is_Open(void);
+
+/**
+ * @brief Function for getting the line coding last set by the host.
+ * @return a pointer to the line coding.
+ */
+USB_CDC_LineCoding_t const* USB_CDC_Get_Line_Coding(void);
+
+#endif /* USB_CDC_CLASS_H */
@@ -0,0 +1,75 @@
+/************************************************************************************************//**
+* @file usb_class.h
+*
+* @brief Header file containing the typedef of the interface implemented by the USB class drivers.
+*/
+
+#ifndef USB_CLASS_H
+#define USB_CLASS_H
+
+#include "usb_standards.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief Structure with the callbacks of a class driver. The middleware routes the events of the
+ *        interfaces and endpoints owned by the class driver to these callbacks, any of them can be
+ *        NULL if the class driver does not need it.
+ */
+typedef struct
+{
+    /** @brief Called when the host selects a configuration, the endpoints are configured here */
+    void(*Init)(void);
+    /** @brief Called when the configuration is lost (bus reset or configuration 0) */
+    void(*Deinit)(void);
+    /** @brief Called when the bus is reset, before Deinit if the device was configured */
+    void(*Reset)(void);
+    /** @brief Called for a request addressed to an interface or endpoint of the class driver,
+     *         returns false if the request is not supported so the middleware stalls it (the
+     *         standard endpoint requests get the default halt handling instead) */
+    bool(*Setup)(USB_Request_t const* request);
+    /** @brief Called when an IN transfer of an endpoint of the class driver is completed */
+    void(*Data_In)(uint8_t endpoint_number);
+    /** @brief Called when an OUT packet is received, the data must be popped from the RxFIFO */
+    void(*Data_Out)(uint8_t endpoint_number, uint16_t byte_cnt);
+    /** @brief Called when an OUT transfer is completed, the endpoint can be enabled again here */
+    void(*Data_Out_Completed)(uint8_t endpoint_number);
+    /** @brief Called at every start of frame (each 1 ms in full speed) */
+    void(*SOF)(void);
+    /** @brief Called at every poll of the device, for background work that cannot wait a frame */
+    void(*Poll)(void);
+}USB_Class_Driver_t;
+
+/**
+ * @brief Structure with the descriptors and the class drivers presented to the host in a device
+ *        mode. The middleware serves the profile of the selected mode.
+ */
+typedef struct
+{
+    /** @brief Descriptor registry indexed by descriptor type */
+    USB_DescriptorRegistryType_t const* descriptor_registry;
+    /** @brief Number of descriptor types of the registry */
+    uint8_t descriptor_type_count;
+    /** @brief Class drivers called on configuration, deconfiguration, start of frame and poll */
+    USB_Class_Driver_t const* const* class_drivers;
+    /** @brief Number of class drivers */
+    uint8_t class_driver_count;
+    /** @brief Routing table from interface number to class driver */
+    USB_Class_Driver_t const* const* interface_class_drivers;
+    /** @brief Number of interfaces of the configuration */
+    uint8_t interface_count;
+    /** @brief Routing table from IN endpoint number to class driver */
+    USB_Class_Driver_t const* const* in_endpoint_class_drivers;
+    /** @brief Routing table from OUT endpoint number to class driver */
+    USB_Class_Driver_t const* const* out_endpoint_class_drivers;
+    /** @brief Value of the only configuration */
+    uint8_t configuration_value;
+    /** @brief Attributes (bmAttributes) of the only configuration */
+    uint8_t configuration_attributes;
+    /** @brief MS OS 2.0 descriptor set returned by the vendor request */
+    void const* msos20_descriptor_set;
+    /** @brief Length of the MS OS 2.0 descriptor set in bytes */
+    uint16_t msos20_descriptor_set_length;
+}USB_Device_Profile_t;
+
+#endif /* USB_CLASS_H */
@@ -0,0 +1,610 @@
+/************************************************************************************************//**
+* @file usb_dfu_class.c
+*
+* @brief File containing the DFU class drivers of the USB device.
+*
+* @note
+*       For further information about functions refer to the corresponding header file.
+**/
+
+#include "usb_dfu_class.h"
+#include "usb_middleware.h"
+#include "usb_dfu_standards.h"
+#include "flash_driver.h"
+#include "stm32f4xx.h"
+#include "logger.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+_Static_assert((USB_DFU_TRANSFER_SIZE % 4) == 0,
+               "The DFU transfer size must be a multiple of the flash word");
+
+/** @brief Frames the device waits after a DFU_DETACH request, so its status stage is completed */
+#define DFU_DETACH_DELAY_FRAMES     2
+/** @brief Frames the device waits for a bus reset in dfuMANIFEST-WAIT-RESET before resetting */
+#define DFU_RESET_DELAY_FRAMES      100
+/** @brief Number of block buffers, one is received while the other one is programmed */
+#define DFU_BLOCK_BUFFER_COUNT      2
+/** @brief Range of RAM where the initial stack pointer of a valid firmware may point to */
+#define DFU_SRAM_START              SRAM1_BASE
+#define DFU_SRAM_END                (SRAM3_BASE + 0x10000UL)
+#define DFU_CCMRAM_START            CCMDATARAM_BASE
+#define DFU_CCMRAM_END              (CCMDATARAM_END + 1)
+
+/**
+ * @brief List of the flash operations, for reporting the right status when one of them fails.
+ */
+typedef enum
+{
+    DFU_FLASH_OPERATION_NONE,
+    DFU_FLASH_OPERATION_ERASE,
+    DFU_FLASH_OPERATION_PROGRAM
+}DFUFlashOperation_t;
+
+/**
+ * @brief Structure for a block received with DFU_DNLOAD.
+ */
+typedef struct
+{
+    /** @brief Data of the block, padded with 0xFF up to a whole flash word */
+    uint8_t data[USB_DFU_TRANSFER_SIZE] __attribute__((aligned(4)));
+    /** @brief Address of the flash where the block is programmed */
+    uint32_t address;
+    /** @brief Size of the block in bytes, a multiple of 4 */
+    uint16_t size;
+}DFU_Block_t;
+
+/***************************************************************************************************/
+/*                                       Static Variables                                          */
+/***************************************************************************************************/
+
+/** @brief State of the DFU interface of the device running the application */
+static USBDFUState_t dfu_runtime_state;
+/** @brief Frames left until the device detaches for entering DFU mode */
+static uint8_t dfu_detach_frames;
+
+/** @brief State of the device in DFU mode */
+static USBDFUState_t dfu_state;
+/** @brief Status of the device in DFU mode */
+static USBDFUStatus_t dfu_status;
+/** @brief Answer of the last DFU_GETSTATUS request, it must remain valid until it is sent */
+static USB_DFU_Status_t dfu_status_response;
+/** @brief Answer of the last DFU_GETSTATE request */
+static uint8_t dfu_state_response;
+
+/** @brief Buffers of the received blocks */
+static DFU_Block_t dfu_blocks[DFU_BLOCK_BUFFER_COUNT];
+/** @brief Index of the oldest block queued for programming */
+static uint8_t dfu_block_head;
+/** @brief Number of blocks queued for programming */
+static uint8_t dfu_block_count;
+/** @brief Offset of the next word to program of the oldest block */
+static uint16_t dfu_program_offset;
+/** @brief Block number (wValue) expected in the next DFU_DNLOAD request */
+static uint16_t dfu_next_block_number;
+/** @brief Flash address of the next received block */
+static uint32_t dfu_download_address;
+/** @brief End of the flash erased during the current download */
+static uint32_t dfu_erased_end;
+/** @brief Last flash operation started */
+static DFUFlashOperation_t dfu_flash_operation;
+/** @brief Flag indicating the new firmware has been verified and selected for booting */
+static bool dfu_manifested;
+/** @brief Frames left until the device resets into the new firmware, 0 if no reset is pending */
+static uint8_t dfu_reset_frames;
+/**
+ * @brief Flag indicating the host has configured the device in DFU mode, so the next bus reset ends
+ *        the DFU session. The bus reset of the enumeration in DFU mode comes before it is set.
+ */
+static bool dfu_session_open;
+
+/***************************************************************************************************/
+/*                                       Static Function Prototypes                                */
+/***************************************************************************************************/
+
+/**
+ * @brief Function for initializing the DFU interface of the device running the application.
+ * @return void
+ */
+static void dfu_runtime_init(void);
+
+/**
+ * @brief Function for processing the DFU requests of the device running the application.
+ * @param[in] request is a pointer to the received request.
+ * @return true if the request is supported, false otherwise.
+ */
+static bool dfu_runtime_setup(USB_Request_t const* request);
+
+/**
+ * @brief Function for detaching the device once the DFU_DETACH request is completed, it is called
+ *        once per frame.
+ * @return void
+ */
+static void dfu_runtime_sof(void);
+
+/**
+ * @brief Function for initializing the DFU interface of the device in DFU mode.
+ * @return void
+ */
+static void dfu_init(void);
+
+/**
+ * @brief Function for releasing the DFU interface of the device in DFU mode, the device stays in
+ *        DFU mode until the bus is reset.
+ * @return void
+ */
+static void dfu_deinit(void);
+
+/**
+ * @brief Function for ending the DFU session when the bus is reset. A bus reset after the
+ *        manifestation resets the device into the new firmware, otherwise the device goes back to
+ *        the application.
+ * @return void
+ */
+static void dfu_reset(void);
+
+/**
+ * @brief Function for processing the DFU requests of the device in DFU mode.
+ * @param[in] request is a pointer to the received request.
+ * @return true if the request is supported, false otherwise.
+ */
+static bool dfu_setup(USB_Request_t const* request);
+
+/**
+ * @brief Function for resetting the device once its reset delay expires, it is called once per
+ *        frame.
+ * @return void
+ */
+static void dfu_sof(void);
+
+/**
+ * @brief Function for erasing and programming the queued blocks, one flash operation is started per
+ *        call so the USB keeps being served while the flash is busy.
+ * @return void
+ */
+static void dfu_poll(void);
+
+/**
+ * @brief Function for processing a DFU_DNLOAD request.
+ * @param[in] request is a pointer to the received request.
+ * @return true if the request is accepted, false otherwise.
+ */
+static bool dfu_download(USB_Request_t const* request);
+
+/**
+ * @brief Function for queueing a block once the DATA OUT stage of a DFU_DNLOAD request has been
+ *        received.
+ * @param[in] request is a pointer to the DFU_DNLOAD request.
+ * @param[in] size is the size of the received block in bytes.
+ * @return void
+ */
+static void dfu_block_received(USB_Request_t const* request, uint16_t size);
+
+/**
+ * @brief Function for answering a DFU_GETSTATUS request, the state changes triggered by the request
+ *        are done here.
+ * @return void
+ */
+static void dfu_get_status(void);
+
+/**
+ * @brief Function for sending the answer to a DFU_GETSTATUS request.
+ * @param[in] state is the state reported to the host.
+ * @param[in] poll_timeout is the time in ms the host waits before the next DFU_GETSTATUS.
+ * @return void
+ */
+static void dfu_send_status(USBDFUState_t state, uint32_t poll_timeout);
+
+/**
+ * @brief Function for checking the new firmware and selecting its bank for the next boot.
+ * @return true if the firmware has been selected, false if its vector table is not valid.
+ */
+static bool dfu_manifest(void);
+
+/**
+ * @brief Function for dropping the queued blocks and restarting the download from the start of the
+ *        inactive bank, the flash is unlocked for the new download.
+ * @return void
+ */
+static void dfu_reset_download(void);
+
+/**
+ * @brief Function for entering the dfuERROR state.
+ * @param[in] status is the status reported to the host.
+ * @return void
+ */
+static void dfu_set_error(USBDFUStatus_t status);
+
+/***************************************************************************************************/
+/*                                       Global Variables                                          */
+/***************************************************************************************************/
+
+/**
+ * @brief Structure with the callbacks of the DFU runtime class driver.
+ * @showinitializer
+ */
+const USB_Class_Driver_t USB_DFU_Runtime_class = {
+    .Init = &dfu_runtime_init,
+    .Deinit = NULL,
+    .Reset = NULL,
+    .Setup = &dfu_runtime_setup,
+    .Data_In = NULL,
+    .Data_Out = NULL,
+    .Data_Out_Completed = NULL,
+    .SOF = &dfu_runtime_sof,
+    .Poll = NULL
+};
+
+/**
+ * @brief Structure with the callbacks of the DFU mode class driver.
+ * @showinitializer
+ */
+const USB_Class_Driver_t USB_DFU_class = {
+    .Init = &dfu_init,
+    .Deinit = &dfu_deinit,
+    .Reset = &dfu_reset,
+    .Setup = &dfu_setup,
+    .Data_In = NULL,
+    .Data_Out = NULL,
+    .Data_Out_Completed = NULL,
+    .SOF = &dfu_sof,
+    .Poll = &dfu_poll
+};
+
+/***************************************************************************************************/
+/*                                       Static Function Definitions                               */
+/***************************************************************************************************/
+
+static void dfu_runtime_init(void)
+{
+    dfu_runtime_state = USB_DFU_STATE_APP_IDLE;
+    dfu_detach_frames = 0;
+}
+
+static bool dfu_runtime_setup(USB_Request_t const* request)
+{
+    if((request->bmRequestType & USB_BM_REQUEST_TYPE_TYPE_MASK) != USB_BM_REQUEST_TYPE_TYPE_CLASS){
+        return false;
+    }
+
+    switch(request->bRequest){
+        case USB_DFU_DETACH:
+            log_info("DFU detach requested");
+            dfu_runtime_state = USB_DFU_STATE_APP_DETACH;
+            dfu_detach_frames = DFU_DETACH_DELAY_FRAMES;
+            USB_Control_Acknowledge();
+            return true;
+        case USB_DFU_GETSTATUS:
+            dfu_status_response = (USB_DFU_Status_t){
+                .bStatus = USB_DFU_STATUS_OK,
+                .bState = dfu_runtime_state
+            };
+            USB_Control_Send(&dfu_status_response, sizeof(dfu_status_response));
+            return true;
+        case USB_DFU_GETSTATE:
+            dfu_state_response = dfu_runtime_state;
+            USB_Control_Send(&dfu_state_response, sizeof(dfu_state_response));
+            return true;
+        default:
+            return false;
+    }
+}
+
+static void dfu_runtime_sof(void)
+{
+    if((dfu_runtime_state == USB_DFU_STATE_APP_DETACH) && (--dfu_detach_frames == 0)){
+        USB_Device_Set_Mode(USB_DEVICE_MODE_DFU);
+    }
+}
+
+static void dfu_init(void)
+{
+    /* Drop the errors left by a previous session, they do not belong to this download */
+    (void)Flash_Get_Errors();
+    dfu_state = USB_DFU_STATE_DFU_IDLE;
+    dfu_status = USB_DFU_STATUS_OK;
+    dfu_manifested = false;
+    dfu_reset_frames = 0;
+    dfu_session_open = true;
+    dfu_reset_download();
+}
+
+static void dfu_deinit(void)
+{
+    Flash_Lock();
+}
+
+static void dfu_reset(void)
+{
+    if(!dfu_session_open){
+        return;
+    }
+    dfu_session_open = false;
+
+    if((dfu_state == USB_DFU_STATE_MANIFEST) ||
+       (dfu_state == USB_DFU_STATE_MANIFEST_WAIT_RESET)){
+        /* The download has been completed, so a reset of the host boots the new firmware */
+        while(Flash_Is_Busy() || (dfu_block_count != 0)){
+            dfu_poll();
+        }
+        if(dfu_manifested || dfu_manifest()){
+            NVIC_SystemReset();
+        }
+    }
+
+    /* The running bank has not been touched, so the application is still valid */
+    USB_Device_Set_Mode(USB_DEVICE_MODE_RUNTIME);
+}
+
+static bool dfu_setup(USB_Request_t const* request)
+{
+    bool accepted = false;
+
+    if((request->bmRequestType & USB_BM_REQUEST_TYPE_TYPE_MASK) != USB_BM_REQUEST_TYPE_TYPE_CLASS){
+        return false;
+    }
+
+    switch(request->bRequest){
+        case USB_DFU_DNLOAD:
+            accepted = dfu_download(request);
+            break;
+        case USB_DFU_GETSTATUS:
+            dfu_get_status();
+            accepted = true;
+            break;
+        case USB_DFU_CLRSTATUS:
+            if(dfu_state == USB_DFU_STATE_ERROR){
+                dfu_state = USB_DFU_STATE_DFU_IDLE;
+                dfu_status = USB_DFU_STATUS_OK;
+                dfu_reset_download();
+                USB_Control_Acknowledge();
+                accepted = true;
+            }
+            break;
+        case USB_DFU_GETSTATE:
+            dfu_state_response = dfu_state;
+            USB_Control_Send(&dfu_state_response, sizeof(dfu_state_response));
+            accepted = true;
+            break;
+        case USB_DFU_ABORT:
+            if((dfu_state == USB_DFU_STATE_DFU_IDLE) || (dfu_state == USB_DFU_STATE_DNLOAD_IDLE)){
+                log_info("DFU download aborted");
+                dfu_state = USB_DFU_STATE_DFU_IDLE;
+                dfu_reset_download();
+                USB_Control_Acknowledge();
+                accepted = true;
+            }
+            break;
+        default:
+            break;
+    }
+
+    /* A request not allowed in the current state makes the device enter the error state */
+    if(!accepted && (dfu_state != USB_DFU_STATE_MANIFEST_WAIT_RESET)){
+        dfu_set_error(USB_DFU_STATUS_ERR_STALLEDPKT);
+    }
+    return accepted;
+}
+
+static void dfu_sof(void)
+{
+    if((dfu_reset_frames != 0) && (--dfu_reset_frames == 0)){
+        log_info("DFU resetting into the new firmware");
+        NVIC_SystemReset();
+    }
+}
+
+static void dfu_poll(void)
+{
+    DFU_Block_t const* block = &dfu_blocks[dfu_block_head];
+    Flash_Sector_t sector;
+    uint32_t address;
+    uint32_t errors;
+
+    if(Flash_Is_Busy()){
+        return;
+    }
+
+    errors = Flash_Get_Errors();
+    if(errors != 0){
+        log_info("DFU flash error 0x%08lX", (unsigned long)errors);
+        dfu_set_error((dfu_flash_operation == DFU_FLASH_OPERATION_ERASE) ?
+                      USB_DFU_STATUS_ERR_ERASE : USB_DFU_STATUS_ERR_PROG);
+        return;
+    }
+    dfu_flash_operation = DFU_FLASH_OPERATION_NONE;
+
+    if(dfu_block_count == 0){
+        if((dfu_state == USB_DFU_STATE_MANIFEST) && !dfu_manifested){
+            dfu_manifest();
+        }
+        return;
+    }
+
+    if(dfu_program_offset < block->size){
+        address = block->address + dfu_program_offset;
+
+        /* The sectors are erased as the download reaches them, the rest of the bank is kept */
+        if(address >= dfu_erased_end){
+            Flash_Get_Sector(address, &sector);
+            Flash_Start_Sector_Erase(&sector);
+            dfu_erased_end = sector.address + sector.size;
+            dfu_flash_operation = DFU_FLASH_OPERATION_ERASE;
+            return;
+        }
+
+        Flash_Start_Program_Word(address, *(uint32_t const*)&block->data[dfu_program_offset]);
+        dfu_program_offset += 4;
+        dfu_flash_operation = DFU_FLASH_OPERATION_PROGRAM;
+        return;
+    }
+
+    /* The whole block is programmed, so read it back before releasing its buffer */
+    if(memcmp((void const*)block->address, block->data, block->size) != 0){
+        dfu_set_error(USB_DFU_STATUS_ERR_VERIFY);
+        return;
+    }
+    dfu_block_head = (dfu_block_head + 1) % DFU_BLOCK_BUFFER_COUNT;
+    dfu_block_count--;
+    dfu_program_offset = 0;
+}
+
+static bool dfu_download(USB_Request_t const* request)
+{
+    DFU_Block_t* block;
+
+    if(request->wLength == 0){
+        /* The end of the download is only accepted after at least one block */
+        if(dfu_state != USB_DFU_STATE_DNLOAD_IDLE){
+            return false;
+        }
+        log_info("DFU download of %lu bytes completed",
+                 (unsigned long)(dfu_download_address - FLASH_INACTIVE_BANK_ADDRESS));
+        dfu_state = USB_DFU_STATE_MANIFEST_SYNC;
+        USB_Control_Acknowledge();
+        return true;
+    }
+
+    if(((dfu_state != USB_DFU_STATE_DFU_IDLE) && (dfu_state != USB_DFU_STATE_DNLOAD_IDLE)) ||
+       (request->wValue != dfu_next_block_number) ||
+       (request->wLength > USB_DFU_TRANSFER_SIZE) ||
+       (dfu_block_count >= DFU_BLOCK_BUFFER_COUNT)){
+        return false;
+    }
+
+    if(dfu_state == USB_DFU_STATE_DFU_IDLE){
+        log_info("DFU download started at 0x%08lX", (unsigned long)dfu_download_address);
+    }
+
+    /* The block is received in the buffer following the queued ones */
+    block = &dfu_blocks[(dfu_block_head + dfu_block_count) % DFU_BLOCK_BUFFER_COUNT];
+    USB_Control_Receive(block->data, request->wLength, &dfu_block_received);
+    return true;
+}
+
+static void dfu_block_received(__attribute__((unused)) USB_Request_t const* request, uint16_t size)
+{
+    DFU_Block_t* block = &dfu_blocks[(dfu_block_head + dfu_block_count) % DFU_BLOCK_BUFFER_COUNT];
+
+    /* Only the last block may have a size which is not a whole number of flash words */
+    if(((dfu_download_address % 4) != 0) ||
+       ((dfu_download_address + size) > (FLASH_INACTIVE_BANK_ADDRESS + FLASH_BANK_SIZE))){
+        dfu_set_error(USB_DFU_STATUS_ERR_ADDRESS);
+        return;
+    }
+
+    block->address = dfu_download_address;
+    block->size = size;
+    while((block->size % 4) != 0){
+        block->data[block->size++] = 0xFF;
+    }
+
+    dfu_download_address += size;
+    dfu_next_block_number++;
+    dfu_block_count++;
+    dfu_state = USB_DFU_STATE_DNLOAD_SYNC;
+}
+
+static void dfu_get_status(void)
+{
+    switch(dfu_state){
+        case USB_DFU_STATE_DNLOAD_SYNC:
+        case USB_DFU_STATE_DNBUSY:
+            if(dfu_block_count < DFU_BLOCK_BUFFER_COUNT){
+                /* A buffer is free, so the next block can be received while this one is written */
+                dfu_state = USB_DFU_STATE_DNLOAD_IDLE;
+                dfu_send_status(dfu_state, 0);
+            }
+            else{
+                /* The host asks again once the timeout expires, moving back to dfuDNLOAD-SYNC */
+                dfu_send_status(USB_DFU_STATE_DNBUSY,
+                                (dfu_flash_operation == DFU_FLASH_OPERATION_ERASE) ?
+                                USB_DFU_ERASE_POLL_TIMEOUT : USB_DFU_PROGRAM_POLL_TIMEOUT);
+                dfu_state = USB_DFU_STATE_DNLOAD_SYNC;
+            }
+            break;
+        case USB_DFU_STATE_MANIFEST_SYNC:
+            if(dfu_block_count == 0){
+                dfu_state = USB_DFU_STATE_MANIFEST;
+                dfu_send_status(dfu_state, USB_DFU_MANIFEST_POLL_TIMEOUT);
+            }
+            else{
+                dfu_send_status(dfu_state, USB_DFU_PROGRAM_POLL_TIMEOUT);
+            }
+            break;
+        case USB_DFU_STATE_MANIFEST:
+            if(dfu_manifested){
+                /* The device is not manifestation tolerant, it waits for the host to reset it */
+                dfu_state = USB_DFU_STATE_MANIFEST_WAIT_RESET;
+                dfu_reset_frames = DFU_RESET_DELAY_FRAMES;
+                dfu_send_status(dfu_state, 0);
+            }
+            else{
+                dfu_send_status(dfu_state, USB_DFU_MANIFEST_POLL_TIMEOUT);
+            }
+            break;
+        default:
+            dfu_send_status(dfu_state, 0);
+            break;
+    }
+}
+
+static void dfu_send_status(USBDFUState_t state, uint32_t poll_timeout)
+{
+    dfu_status_response.bStatus = dfu_status;
+    dfu_status_response.bwPollTimeout[0] = poll_timeout & 0xFF;
+    dfu_status_response.bwPollTimeout[1] = (poll_timeout >> 8) & 0xFF;
+    dfu_status_response.bwPollTimeout[2] = (poll_timeout >> 16) & 0xFF;
+    dfu_status_response.bState = state;
+    dfu_status_response.iString = 0;
+    USB_Control_Send(&dfu_status_response, sizeof(dfu_status_response));
+}
+
+static bool dfu_manifest(void)
+{
+    uint32_t const* vector_table = (uint32_t const*)FLASH_INACTIVE_BANK_ADDRESS;
+    uint32_t image_size = dfu_download_address - FLASH_INACTIVE_BANK_ADDRESS;
+    uint32_t stack_pointer = vector_table[0];
+    uint32_t reset_handler = vector_table[1] & ~1UL;
+
+    /* The firmware is linked for the start of the flash, where its bank is mapped after the swap */
+    if((image_size < (2*sizeof(uint32_t))) ||
+       ((stack_pointer % 4) != 0) ||
+       !(((stack_pointer > DFU_SRAM_START) && (stack_pointer <= DFU_SRAM_END)) ||
+         ((stack_pointer > DFU_CCMRAM_START) && (stack_pointer <= DFU_CCMRAM_END))) ||
+       ((vector_table[1] & 1UL) == 0) ||
+       (reset_handler < FLASH_BASE) || (reset_handler >= (FLASH_BASE + image_size))){
+        log_info("DFU firmware rejected, invalid vector table");
+        dfu_set_error(USB_DFU_STATUS_ERR_FIRMWARE);
+        return false;
+    }
+
+    log_info("DFU firmware verified, swapping the boot bank");
+    Flash_Lock();
+    Flash_Toggle_Boot_Bank();
+    dfu_manifested = true;
+    return true;
+}
+
+static void dfu_reset_download(void)
+{
+    Flash_Unlock();
+    dfu_block_head = 0;
+    dfu_block_count = 0;
+    dfu_program_offset = 0;
+    dfu_next_block_number = 0;
+    dfu_download_address = FLASH_INACTIVE_BANK_ADDRESS;
+    dfu_erased_end = FLASH_INACTIVE_BANK_ADDRESS;
+    dfu_flash_operation = DFU_FLASH_OPERATION_NONE;
+}
+
+static void dfu_set_error(USBDFUStatus_t status)
+{
+    log_info("DFU error, status %u", (unsigned)status);
+    dfu_state = USB_DFU_STATE_ERROR;
+    dfu_status = status;
+    dfu_block_count = 0;
+    dfu_program_offset = 0;
+}
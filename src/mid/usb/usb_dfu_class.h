@@ -0,0 +1,42 @@
+/************************************************************************************************//**
+* @file usb_dfu_class.h
+*
+* @brief Header file containing the DFU (Device Firmware Upgrade 1.1) class drivers of the USB
+*        device, for updating the firmware in the field.
+*
+* @note
+*       The runtime class driver owns the DFU interface of the composite device. On a DFU_DETACH
+*       request the device leaves the bus and enumerates again in DFU mode, where the DFU class
+*       driver receives the new firmware. The flash memory has two banks, so the firmware is written
+*       into the bank which is not running while the USB keeps being served from the other one. The
+*       blocks are double buffered, so the host sends the next block while the previous one is
+*       programmed. Once the download ends, the vector table of the new firmware is checked, the
+*       boot bank is swapped and the device is reset into the new firmware.
+*/
+
+#ifndef USB_DFU_CLASS_H
+#define USB_DFU_CLASS_H
+
+#include "usb_class.h"
+
+/** @brief Maximum size of a DFU_DNLOAD block, it must be a multiple of 4 */
+#define USB_DFU_TRANSFER_SIZE           2048
+/** @brief Time in ms the host waits for the device to detach after a DFU_DETACH request */
+#define USB_DFU_DETACH_TIMEOUT          1000
+/** @brief Poll timeout in ms announced while a block is being programmed */
+#define USB_DFU_PROGRAM_POLL_TIMEOUT    10
+/** @brief Poll timeout in ms announced while a sector is being erased */
+#define USB_DFU_ERASE_POLL_TIMEOUT      100
+/** @brief Poll timeout in ms announced for the manifestation (boot bank swap) */
+#define USB_DFU_MANIFEST_POLL_TIMEOUT   50
+
+/***************************************************************************************************/
+/*                                       Exported Variables                                        */
+/***************************************************************************************************/
+
+/** @brief Class driver of the DFU interface of the device running the application */
+extern const USB_Class_Driver_t USB_DFU_Runtime_class;
+/** @brief Class driver of the DFU interface of the device in DFU mode */
+extern const USB_Class_Driver_t USB_DFU_class;
+
+#endif /* USB_DFU_CLASS_H */
@@ -0,0 +1,776 @@
+/************************************************************************************************//**
+* @file usb_hid_class.c
+*
+* @brief File containing the HID class driver of the USB device.
+*
+* Public Functions:
+*       - bool USB_HID_Report_Write(uint8_t report_id, void const* report)
+*       - void USB_HID_Mouse_Update(int8_t x, int8_t y, uint8_t buttons)
+*       - void USB_HID_Keyboard_Set_Key(uint8_t usage, bool pressed)
+*       - uint8_t USB_HID_Keyboard_Get_LEDs(void)
+*       - void USB_HID_Pointer_Update(uint16_t x, uint16_t y, uint8_t buttons)
+*       - bool USB_HID_Touch_Update(uint8_t contact_id, bool touching, uint16_t x, uint16_t y)
+*
+* @note
+*       For further information about functions refer to the corresponding header file.
+**/
+
+#include "usb_hid_class.h"
+#include "usb_hid_reports.h"
+#include "usb_middleware.h"
+#include "usb_driver.h"
+#include "usb_device_config.h"
+#include "usb_hid_standards.h"
+#include "usb_hid.h"
+#include "logger.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+/** @brief Period in frames (ms) of the movement generated for the demo */
+#define HID_DEMO_MOTION_PERIOD  50
+/** @brief Idle rate of the reports after the configuration, reports are only sent on changes */
+#define HID_DEFAULT_IDLE_RATE   0
+/** @brief Increment of the scan time of the touch screen per frame, in units of 100 us */
+#define HID_TOUCH_SCAN_TIME_PER_FRAME   10
+
+/** @brief Checks at compile time an entry of the report table */
+#define HID_REPORT_CHECK(name, id, type, priority)                                              \
+    _Static_assert((id) != 0, "Report ID 0 is reserved");                                       \
+    _Static_assert(sizeof(type) <= USB_HID_IN_PACKET_SIZE, "Report does not fit in a packet");
+USB_HID_INPUT_REPORTS(HID_REPORT_CHECK)
+
+/** @brief Expands an entry of the report table into the index of the report */
+#define HID_REPORT_INDEX(name, id, type, priority) HID_REPORT_INDEX_##name,
+/** @brief Expands an entry of the report table into the buffer of the report */
+#define HID_REPORT_BUFFER(name, id, type, priority) type name;
+/** @brief Expands an entry of the report table into the definition of the report */
+#define HID_REPORT_DEFINITION(name, id, type, priority_level)                                   \
+    [HID_REPORT_INDEX_##name] = {                                                               \
+        .report_id = (id),                                                                      \
+        .size = sizeof(type),                                                                   \
+        .priority = (priority_level),                                                           \
+        .buffer = (uint8_t*)&hid_reports.name                                                   \
+    },
+
+/**
+ * @brief List of the indexes of the input reports in the report table.
+ */
+typedef enum
+{
+    USB_HID_INPUT_REPORTS(HID_REPORT_INDEX)
+    HID_REPORT_COUNT
+}HIDReportIndex_t;
+
+/**
+ * @brief Structure with the buffers of all the input reports, each one holds the current state of
+ *        the report.
+ */
+typedef struct
+{
+    USB_HID_INPUT_REPORTS(HID_REPORT_BUFFER)
+}HID_Report_Buffers_t;
+
+/**
+ * @brief Structure with the definition of an input report, generated from the report table.
+ */
+typedef struct
+{
+    /** @brief Report ID, it is the first byte of the report */
+    uint8_t report_id;
+    /** @brief Size of the report in bytes, including the report ID */
+    uint8_t size;
+    /** @brief Priority of the report, 0 is the highest */
+    uint8_t priority;
+    /** @brief Pointer to the buffer of the report */
+    uint8_t* buffer;
+}HID_Report_Definition_t;
+
+/**
+ * @brief Structure with the state of an input report.
+ */
+typedef struct
+{
+    /** @brief Flag indicating the report has changed since it was last sent */
+    bool dirty;
+    /** @brief Idle rate selected by the host in units of 4 ms, 0 sends the report only on changes */
+    uint8_t idle_rate;
+    /** @brief Time in ms since the report was last sent */
+    uint16_t idle_elapsed;
+}HID_Report_State_t;
+
+/**
+ * @brief Structure with the state of a contact of the touch screen.
+ */
+typedef struct
+{
+    /** @brief Flag indicating the slot is used by a contact */
+    bool used;
+    /** @brief Flag indicating the finger touches the surface, a released contact is reported once */
+    bool touching;
+    /** @brief Identifier of the contact given by the application */
+    uint8_t contact_id;
+    /** @brief Position of the contact */
+    uint16_t x;
+    uint16_t y;
+}HID_Touch_Contact_t;
+
+/**
+ * @brief Structure with the state of the touch frame being sent. A frame has all the contacts at
+ *        the moment it starts, and it is sent in as many reports as needed (hybrid mode).
+ */
+typedef struct
+{
+    /** @brief Slots of the contacts of the frame */
+    uint8_t slots[USB_HID_TOUCH_CONTACTS];
+    /** @brief Number of contacts of the frame */
+    uint8_t count;
+    /** @brief Number of contacts of the frame already sent */
+    uint8_t sent;
+    /** @brief Flag indicating the contacts have changed since the frame started */
+    bool changed;
+    /** @brief Time running in units of 100 us, it stamps the frames */
+    uint16_t scan_time;
+}HID_Touch_Frame_t;
+
+/**
+ * @brief Structure with the state of an interrupt IN endpoint sending reports. The endpoint is only
+ *        armed when there is a report to send, so the host gets NAKs while nothing changes.
+ */
+typedef struct
+{
+    /** @brief Number of the endpoint */
+    uint8_t endpoint_number;
+    /** @brief Flag indicating a report is in the TxFIFO waiting for the host */
+    bool busy;
+    /** @brief Index of the last sent report, reports with the same priority are sent after it */
+    uint8_t last_report;
+}HID_IN_Endpoint_t;
+
+/***************************************************************************************************/
+/*                                       Static Variables                                          */
+/***************************************************************************************************/
+
+/** @brief Buffer for storing the data received with a HID SET_REPORT request */
+static uint8_t hid_set_report_buffer[64];
+/** @brief Buffer for the answers of GET_REPORT requests, it must remain valid until it is sent */
+static uint8_t hid_get_report_buffer[USB_HID_IN_PACKET_SIZE];
+/** @brief Buffer for the boot keyboard report sent with the boot protocol */
+static HID_Boot_Keyboard_Report_t hid_boot_report;
+/** @brief Feature report with the maximum number of contacts of the touch screen */
+static const HID_Touch_Maximum_Report_t hid_touch_maximum_report = {
+    .report_id = USB_HID_REPORT_ID_TOUCH_MAXIMUM,
+    .contact_count_maximum = USB_HID_TOUCH_CONTACTS
+};
+/** @brief Buffer for the answers of the GET_IDLE and GET_PROTOCOL requests */
+static uint8_t hid_get_value_buffer;
+
+/** @brief Flag indicating the endpoint of the HID interface is configured */
+static bool hid_configured;
+/** @brief State of the IN endpoint of the HID interface */
+static HID_IN_Endpoint_t hid_in_endpoint = {
+    .endpoint_number = USB_ENDPOINT_NUMBER(USB_HID_IN_ENDPOINT)
+};
+/** @brief Buffers of the input reports, the movement of the mouse is accumulated until reported */
+static HID_Report_Buffers_t hid_reports;
+/** @brief Definitions of the input reports */
+static const HID_Report_Definition_t hid_report_definitions[HID_REPORT_COUNT] = {
+    USB_HID_INPUT_REPORTS(HID_REPORT_DEFINITION)
+};
+/** @brief States of the input reports */
+static HID_Report_State_t hid_report_states[HID_REPORT_COUNT];
+/** @brief Buttons of the last sent mouse report */
+static uint8_t hid_reported_buttons;
+/** @brief State of the keyboard LEDs set by the host with the output report */
+static uint8_t hid_keyboard_leds;
+/** @brief Contacts tracked by the touch screen */
+static HID_Touch_Contact_t hid_touch_contacts[USB_HID_TOUCH_CONTACTS];
+/** @brief Touch frame being sent */
+static HID_Touch_Frame_t hid_touch_frame;
+/** @brief Protocol selected by the host, @ref USB_HID_PROTOCOLS */
+static uint8_t hid_protocol;
+/** @brief Number of frames since the demo moved the mouse */
+static uint8_t hid_demo_frames;
+/** @brief Flag indicating a report changed while the bus was suspended, it is sent on resume */
+static bool hid_resume_pending;
+
+/***************************************************************************************************/
+/*                                       Static Function Prototypes                                */
+/***************************************************************************************************/
+
+/**
+ * @brief Function for configuring the endpoint of the HID interface.
+ * @return void
+ */
+static void hid_init(void);
+
+/**
+ * @brief Function for releasing the HID interface when the configuration is lost.
+ * @return void
+ */
+static void hid_deinit(void);
+
+/**
+ * @brief Function for processing a request addressed to the HID interface.
+ * @param[in] request is a pointer to the received request.
+ * @return true if the request is supported, false otherwise.
+ */
+static bool hid_setup(USB_Request_t const* request);
+
+/**
+ * @brief Function for managing a completed IN transfer of the HID endpoint.
+ * @param[in] endpoint_number is the endpoint number for the IN transfer.
+ * @return void
+ */
+static void hid_data_in(uint8_t endpoint_number);
+
+/**
+ * @brief Function for running the idle timers and the demo, it is called once per frame.
+ * @return void
+ */
+static void hid_sof(void);
+
+/**
+ * @brief Function called when the data of a HID SET_REPORT request has been received.
+ * @param[in] request is a pointer to the received request.
+ * @param[in] size is the amount of bytes stored in the report buffer.
+ * @return void
+ */
+static void hid_set_report_received(USB_Request_t const* request, uint16_t size);
+
+/**
+ * @brief Function for getting the index of an input report.
+ * @param[in] report_id is the report ID.
+ * @return the index of the report, or HID_REPORT_COUNT if the report ID is unknown.
+ */
+static uint8_t hid_find_report(uint8_t report_id);
+
+/**
+ * @brief Function for checking if an input report has to be sent, because either it has changed
+ *        since it was last sent or its idle rate has expired.
+ * @param[in] index is the index of the report.
+ * @return true if the report is pending, false otherwise.
+ */
+static bool hid_report_pending(uint8_t index);
+
+/**
+ * @brief Function for sending the pending report with the highest priority if the IN endpoint is
+ *        idle. Pending reports with the same priority are sent in turns, so none of them starves.
+ * @return void
+ */
+static void hid_send_report(void);
+
+/**
+ * @brief Function for building the boot keyboard report (6-key rollover) from the keyboard report.
+ *        If more than six keys are pressed, all the key slots report the rollover error.
+ * @param[out] boot_report is a pointer to the boot report to be built.
+ * @return void
+ */
+static void hid_build_boot_report(HID_Boot_Keyboard_Report_t* boot_report);
+
+/**
+ * @brief Function for filling the touch report with the next contacts of the current frame, a new
+ *        frame is started if the current one has been completely sent.
+ * @return void
+ */
+static void hid_touch_build_report(void);
+
+/**
+ * @brief Function for updating the touch frame once a touch report has been sent, the released
+ *        contacts which have been reported are forgotten.
+ * @return true if another touch report has to be sent, false otherwise.
+ */
+static bool hid_touch_report_sent(void);
+
+/**
+ * @brief Function for adding a relative movement to the accumulated one, saturating it to the
+ *        range of the report.
+ * @param[in] accumulated is the movement not reported yet.
+ * @param[in] movement is the new movement.
+ * @return the movement to be reported.
+ */
+static int8_t hid_add_movement(int8_t accumulated, int8_t movement);
+
+/***************************************************************************************************/
+/*                                       Global Variables                                          */
+/***************************************************************************************************/
+
+/**
+ * @brief Structure with the callbacks of the HID class driver.
+ * @showinitializer
+ */
+const USB_Class_Driver_t USB_HID_class = {
+    .Init = &hid_init,
+    .Deinit = &hid_deinit,
+    .Reset = NULL,
+    .Setup = &hid_setup,
+    .Data_In = &hid_data_in,
+    .Data_Out = NULL,
+    .Data_Out_Completed = NULL,
+    .SOF = &hid_sof,
+    .Poll = NULL
+};
+
+/***************************************************************************************************/
+/*                                       Public API Definitions                                    */
+/***************************************************************************************************/
+
+bool USB_HID_Report_Write(uint8_t report_id, void const* report)
+{
+    uint8_t index = hid_find_report(report_id);
+    HID_Report_Definition_t const* definition;
+
+    if(index == HID_REPORT_COUNT){
+        return false;
+    }
+    definition = &hid_report_definitions[index];
+
+    /* The report ID of the buffer is kept, only the data after it is updated */
+    if(memcmp(&definition->buffer[1], &((uint8_t const*)report)[1], definition->size - 1) != 0){
+        memcpy(&definition->buffer[1], &((uint8_t const*)report)[1], definition->size - 1);
+        hid_report_states[index].dirty = true;
+        hid_send_report();
+    }
+
+    return true;
+}
+
+void USB_HID_Mouse_Update(int8_t x, int8_t y, uint8_t buttons)
+{
+    HID_Mouse_Report_t* mouse = &hid_reports.mouse;
+
+    mouse->x = hid_add_movement(mouse->x, x);
+    mouse->y = hid_add_movement(mouse->y, y);
+    mouse->buttons = buttons;
+
+    hid_report_states[HID_REPORT_INDEX_mouse].dirty = (mouse->x != 0) || (mouse->y != 0) ||
+                                                      (mouse->buttons != hid_reported_buttons);
+
+    /* Arm the endpoint at once, instead of waiting for the next frame */
+    hid_send_report();
+}
+
+void USB_HID_Keyboard_Set_Key(uint8_t usage, bool pressed)
+{
+    uint8_t* field;
+    uint8_t mask;
+
+    if((usage >= HID_KEYBOARD_LEFT_CONTROL) && (usage <= HID_KEYBOARD_RIGHT_GUI)){
+        field = &hid_reports.keyboard.modifiers;
+        mask = 1 << (usage - HID_KEYBOARD_LEFT_CONTROL);
+    }
+    else if((usage >= HID_KEYBOARD_A) && (usage < USB_HID_KEYBOARD_KEYS)){
+        field = &hid_reports.keyboard.keys[usage/8];
+        mask = 1 << (usage % 8);
+    }
+    else{
+        return;
+    }
+
+    /* Only a change of the state of the key generates a report */
+    if(((*field & mask) != 0) == pressed){
+        return;
+    }
+    *field ^= mask;
+    hid_report_states[HID_REPORT_INDEX_keyboard].dirty = true;
+
+    hid_send_report();
+}
+
+uint8_t USB_HID_Keyboard_Get_LEDs(void)
+{
+    return hid_keyboard_leds;
+}
+
+void USB_HID_Pointer_Update(uint16_t x, uint16_t y, uint8_t buttons)
+{
+    HID_Pointer_Report_t report = {.buttons = buttons, .x = x, .y = y};
+
+    USB_HID_Report_Write(USB_HID_REPORT_ID_POINTER, &report);
+}
+
+bool USB_HID_Touch_Update(uint8_t contact_id, bool touching, uint16_t x, uint16_t y)
+{
+    HID_Touch_Contact_t* contact = NULL;
+
+    for(uint8_t i = 0; i < USB_HID_TOUCH_CONTACTS; i++){
+        if(hid_touch_contacts[i].used && (hid_touch_contacts[i].contact_id == contact_id)){
+            contact = &hid_touch_contacts[i];
+            break;
+        }
+        if(!hid_touch_contacts[i].used && (contact == NULL)){
+            contact = &hid_touch_contacts[i];
+        }
+    }
+
+    /* A new contact needs a free slot, and releasing an unknown contact changes nothing */
+    if((contact == NULL) || (!contact->used && !touching)){
+        return !touching;
+    }
+
+    *contact = (HID_Touch_Contact_t){
+        .used = true,
+        .touching = touching,
+        .contact_id = contact_id,
+        .x = x,
+        .y = y
+    };
+    hid_touch_frame.changed = true;
+    hid_report_states[HID_REPORT_INDEX_touch].dirty = true;
+
+    hid_send_report();
+
+    return true;
+}
+
+/***************************************************************************************************/
+/*                                       Static Function Definitions                               */
+/***************************************************************************************************/
+
+static void hid_init(void)
+{
+    USB_driver.USB_Configure_IN_Endpoint(
+        USB_ENDPOINT_NUMBER(USB_HID_IN_ENDPOINT),
+        USB_ENDPOINT_TYPE_INTERRUPT,
+        USB_HID_IN_PACKET_SIZE
+    );
+
+    /* The host selects the protocol again after every configuration */
+    hid_protocol = USB_HID_PROTOCOL_REPORT;
+    hid_reports = (HID_Report_Buffers_t){0};
+    for(uint8_t i = 0; i < HID_REPORT_COUNT; i++){
+        hid_report_definitions[i].buffer[0] = hid_report_definitions[i].report_id;
+        hid_report_states[i] = (HID_Report_State_t){.idle_rate = HID_DEFAULT_IDLE_RATE};
+    }
+    hid_in_endpoint.busy = false;
+    hid_in_endpoint.last_report = HID_REPORT_COUNT - 1;
+    hid_reported_buttons = 0;
+    hid_keyboard_leds = 0;
+    for(uint8_t i = 0; i < USB_HID_TOUCH_CONTACTS; i++){
+        hid_touch_contacts[i].used = false;
+    }
+    hid_touch_frame = (HID_Touch_Frame_t){0};
+    hid_demo_frames = 0;
+    hid_configured = true;
+}
+
+static void hid_deinit(void)
+{
+    hid_configured = false;
+}
+
+static bool hid_setup(USB_Request_t const* request)
+{
+    uint8_t index;
+
+    if((request->bmRequestType & USB_BM_REQUEST_TYPE_TYPE_MASK) != USB_BM_REQUEST_TYPE_TYPE_CLASS){
+        return false;
+    }
+
+    switch(request->bRequest){
+        case USB_HID_GETREPORT:
+            if(request->wValue == ((USB_HID_REPORT_FEATURE << 8) | USB_HID_REPORT_ID_TOUCH_MAXIMUM)){
+                USB_Control_Send(&hid_touch_maximum_report, sizeof(hid_touch_maximum_report));
+                return true;
+            }
+            /* Apart from the feature report above, only the input reports can be read */
+            index = hid_find_report(request->wValue & 0xFF);
+            if(((request->wValue >> 8) != USB_HID_REPORT_IN) || (index == HID_REPORT_COUNT)){
+                return false;
+            }
+            if((hid_protocol == USB_HID_PROTOCOL_BOOT) &&
+               (hid_report_definitions[index].report_id == USB_HID_BOOT_REPORT_ID)){
+                hid_build_boot_report((HID_Boot_Keyboard_Report_t*)hid_get_report_buffer);
+                USB_Control_Send(hid_get_report_buffer, sizeof(HID_Boot_Keyboard_Report_t));
+                return true;
+            }
+            memcpy(hid_get_report_buffer,
+                   hid_report_definitions[index].buffer,
+                   hid_report_definitions[index].size);
+            USB_Control_Send(hid_get_report_buffer, hid_report_definitions[index].size);
+            return true;
+        case USB_HID_GETIDLE:
+            /* Report ID 0 stands for all the reports, all of them have the rate of the first one */
+            index = ((request->wValue & 0xFF) == 0) ? 0 : hid_find_report(request->wValue & 0xFF);
+            if(index == HID_REPORT_COUNT){
+                return false;
+            }
+            hid_get_value_buffer = hid_report_states[index].idle_rate;
+            USB_Control_Send(&hid_get_value_buffer, sizeof(hid_get_value_buffer));
+            return true;
+        case USB_HID_GETPROTOCOL:
+            hid_get_value_buffer = hid_protocol;
+            USB_Control_Send(&hid_get_value_buffer, sizeof(hid_get_value_buffer));
+            return true;
+        case USB_HID_SETIDLE:
+            /* A new rate shorter than the elapsed time makes the report be sent at once */
+            for(index = 0; index < HID_REPORT_COUNT; index++){
+                if(((request->wValue & 0xFF) == 0) ||
+                   ((request->wValue & 0xFF) == hid_report_definitions[index].report_id)){
+                    hid_report_states[index].idle_rate = request->wValue >> 8;
+                }
+            }
+            log_info("HID idle rate of report %u set to %u ms",
+                     request->wValue & 0xFF, (request->wValue >> 8)*USB_HID_IDLE_RATE_UNIT);
+            USB_Control_Acknowledge();
+            return true;
+        case USB_HID_SETPROTOCOL:
+            if(request->wValue > USB_HID_PROTOCOL_REPORT){
+                return false;
+            }
+            hid_protocol = request->wValue;
+            log_info("HID %s protocol selected",
+                     (hid_protocol == USB_HID_PROTOCOL_BOOT) ? "boot" : "report");
+            USB_Control_Acknowledge();
+            return true;
+        case USB_HID_SETREPORT:
+            log_info("HID Set Report request received");
+            USB_Control_Receive(hid_set_report_buffer,
+                                sizeof(hid_set_report_buffer),
+                                &hid_set_report_received);
+            return true;
+        default:
+            return false;
+    }
+}
+
+static void hid_data_in(uint8_t endpoint_number)
+{
+    if(endpoint_number == hid_in_endpoint.endpoint_number){
+        hid_in_endpoint.busy = false;
+        hid_send_report();
+    }
+}
+
+static void hid_sof(void)
+{
+    bool idle_running = false;
+
+    /* The demo moves the mouse to the right */
+    if(++hid_demo_frames >= HID_DEMO_MOTION_PERIOD){
+        hid_demo_frames = 0;
+        USB_HID_Mouse_Update(5, 0, hid_reports.mouse.buttons);
+    }
+
+    hid_touch_frame.scan_time += HID_TOUCH_SCAN_TIME_PER_FRAME;
+
+    for(uint8_t i = 0; i < HID_REPORT_COUNT; i++){
+        if((hid_report_states[i].idle_rate != 0) &&
+           (hid_report_states[i].idle_elapsed < UINT16_MAX)){
+            hid_report_states[i].idle_elapsed++;
+            idle_running = true;
+        }
+    }
+
+    /* Nothing to do while the reports do not change, unless the host asked for idle reports or
+       the bus has just resumed */
+    if(idle_running || hid_resume_pending){
+        hid_resume_pending = false;
+        hid_send_report();
+    }
+}
+
+static void hid_set_report_received(USB_Request_t const* request, uint16_t size)
+{
+    log_info("HID report 0x%04X received", request->wValue);
+    log_debug_array("SET_REPORT data: ", hid_set_report_buffer, size);
+
+    if((request->wValue >> 8) != USB_HID_REPORT_OUT){
+        return;
+    }
+
+    /* The LEDs report has the report ID first, except in the boot protocol */
+    if(((request->wValue & 0xFF) == USB_HID_REPORT_ID_KEYBOARD) && (size >= 2) &&
+       (hid_set_report_buffer[0] == USB_HID_REPORT_ID_KEYBOARD)){
+        hid_keyboard_leds = hid_set_report_buffer[1];
+    }
+    else if(((request->wValue & 0xFF) == 0) && (size >= 1) &&
+            (hid_protocol == USB_HID_PROTOCOL_BOOT)){
+        hid_keyboard_leds = hid_set_report_buffer[0];
+    }
+}
+
+static uint8_t hid_find_report(uint8_t report_id)
+{
+    uint8_t index;
+
+    for(index = 0; index < HID_REPORT_COUNT; index++){
+        if(hid_report_definitions[index].report_id == report_id){
+            break;
+        }
+    }
+
+    return index;
+}
+
+static bool hid_report_pending(uint8_t index)
+{
+    HID_Report_State_t const* state = &hid_report_states[index];
+
+    /* In the boot protocol the host only understands the boot report */
+    if((hid_protocol == USB_HID_PROTOCOL_BOOT) &&
+       (hid_report_definitions[index].report_id != USB_HID_BOOT_REPORT_ID)){
+        return false;
+    }
+
+    return state->dirty ||
+           ((state->idle_rate != 0) &&
+            (state->idle_elapsed >= (state->idle_rate*USB_HID_IDLE_RATE_UNIT)));
+}
+
+static void hid_send_report(void)
+{
+    HID_Report_Definition_t const* definition;
+    uint8_t selected = HID_REPORT_COUNT;
+    uint8_t index = hid_in_endpoint.last_report;
+
+    if(!hid_configured || hid_in_endpoint.busy){
+        return;
+    }
+
+    /* The search starts after the last sent report, so it is the last one among its priority */
+    for(uint8_t i = 0; i < HID_REPORT_COUNT; i++){
+        index = (index + 1) % HID_REPORT_COUNT;
+        if(hid_report_pending(index) &&
+           ((selected == HID_REPORT_COUNT) ||
+            (hid_report_definitions[index].priority < hid_report_definitions[selected].priority))){
+            selected = index;
+        }
+    }
+    if(selected == HID_REPORT_COUNT){
+        return;
+    }
+
+    /* The endpoint can not be used while the bus is suspended, the input wakes the host up */
+    if(USB_Device_Is_Suspended()){
+        USB_Device_Remote_Wakeup();
+        hid_resume_pending = true;
+        return;
+    }
+
+    log_debug("Sending USB HID report %u", hid_report_definitions[selected].report_id);
+
+    /* The touch report is filled from the contacts when it is sent */
+    if(selected == HID_REPORT_INDEX_touch){
+        hid_touch_build_report();
+    }
+
+    definition = &hid_report_definitions[selected];
+    if(hid_protocol == USB_HID_PROTOCOL_BOOT){
+        hid_build_boot_report(&hid_boot_report);
+        USB_driver.USB_Write_Packet(hid_in_endpoint.endpoint_number,
+                                    &hid_boot_report,
+                                    sizeof(hid_boot_report));
+    }
+    else{
+        USB_driver.USB_Write_Packet(hid_in_endpoint.endpoint_number,
+                                    definition->buffer,
+                                    definition->size);
+    }
+
+    hid_report_states[selected].idle_elapsed = 0;
+    hid_report_states[selected].dirty = false;
+
+    /* The movement has been reported, an idle report only repeats the state of the buttons */
+    if(selected == HID_REPORT_INDEX_mouse){
+        hid_reported_buttons = hid_reports.mouse.buttons;
+        hid_reports.mouse.x = 0;
+        hid_reports.mouse.y = 0;
+    }
+    else if(selected == HID_REPORT_INDEX_touch){
+        hid_report_states[selected].dirty = hid_touch_report_sent();
+    }
+    hid_in_endpoint.last_report = selected;
+    hid_in_endpoint.busy = true;
+}
+
+static void hid_build_boot_report(HID_Boot_Keyboard_Report_t* boot_report)
+{
+    uint8_t count = 0;
+
+    *boot_report = (HID_Boot_Keyboard_Report_t){.modifiers = hid_reports.keyboard.modifiers};
+
+    for(uint8_t i = 0; i < USB_HID_KEYBOARD_BITMAP_SIZE; i++){
+        /* Each iteration takes the lowest pressed key of the byte */
+        for(uint8_t keys = hid_reports.keyboard.keys[i]; keys != 0; keys &= keys - 1){
+            if(count == USB_HID_BOOT_KEYBOARD_KEYS){
+                memset(boot_report->keys, HID_KEYBOARD_ERROR_ROLLOVER, sizeof(boot_report->keys));
+                return;
+            }
+            boot_report->keys[count++] = (i*8) + __builtin_ctz(keys);
+        }
+    }
+}
+
+static void hid_touch_build_report(void)
+{
+    HID_Touch_Report_t* report = &hid_reports.touch;
+    HID_Touch_Contact_t const* contact;
+    uint8_t index;
+
+    if(hid_touch_frame.sent == hid_touch_frame.count){
+        hid_touch_frame.count = 0;
+        hid_touch_frame.sent = 0;
+        hid_touch_frame.changed = false;
+        for(uint8_t i = 0; i < USB_HID_TOUCH_CONTACTS; i++){
+            if(hid_touch_contacts[i].used){
+                hid_touch_frame.slots[hid_touch_frame.count++] = i;
+            }
+        }
+        report->scan_time = hid_touch_frame.scan_time;
+    }
+
+    /* Only the first report of the frame has the number of contacts */
+    report->contact_count = (hid_touch_frame.sent == 0) ? hid_touch_frame.count : 0;
+
+    for(uint8_t i = 0; i < USB_HID_TOUCH_REPORT_CONTACTS; i++){
+        index = hid_touch_frame.sent + i;
+        if(index >= hid_touch_frame.count){
+            report->contacts[i] = (HID_Touch_Contact_Report_t){0};
+            continue;
+        }
+        contact = &hid_touch_contacts[hid_touch_frame.slots[index]];
+        report->contacts[i] = (HID_Touch_Contact_Report_t){
+            .flags = contact->touching ? USB_HID_TOUCH_TIP_SWITCH : 0,
+            .contact_id = contact->contact_id,
+            .x = contact->x,
+            .y = contact->y
+        };
+    }
+}
+
+static bool hid_touch_report_sent(void)
+{
+    HID_Touch_Contact_t* contact;
+    uint8_t sent = hid_touch_frame.count - hid_touch_frame.sent;
+
+    if(sent > USB_HID_TOUCH_REPORT_CONTACTS){
+        sent = USB_HID_TOUCH_REPORT_CONTACTS;
+    }
+
+    /* The host has been told the contacts were released, so their slots are free again */
+    for(uint8_t i = 0; i < sent; i++){
+        contact = &hid_touch_contacts[hid_touch_frame.slots[hid_touch_frame.sent + i]];
+        if(!contact->touching){
+            contact->used = false;
+        }
+    }
+    hid_touch_frame.sent += sent;
+
+    return (hid_touch_frame.sent < hid_touch_frame.count) || hid_touch_frame.changed;
+}
+
+static int8_t hid_add_movement(int8_t accumulated, int8_t movement)
+{
+    int16_t sum = accumulated + movement;
+
+    /* -128 is not used, so the range is symmetric as declared in the report descriptor */
+    if(sum > INT8_MAX){
+        return INT8_MAX;
+    }
+    if(sum < -INT8_MAX){
+        return -INT8_MAX;
+    }
+    return sum;
+}
@@ -0,0 +1,108 @@
+/************************************************************************************************//**
+* @file usb_hid_class.h
+*
+* @brief Header file containing the HID class driver of the USB device.
+*
+* Public Functions:
+*       - bool USB_HID_Report_Write(uint8_t report_id, void const* report)
+*       - void USB_HID_Mouse_Update(int8_t x, int8_t y, uint8_t buttons)
+*       - void USB_HID_Keyboard_Set_Key(uint8_t usage, bool pressed)
+*       - uint8_t USB_HID_Keyboard_Get_LEDs(void)
+*       - void USB_HID_Pointer_Update(uint16_t x, uint16_t y, uint8_t buttons)
+*       - bool USB_HID_Touch_Update(uint8_t contact_id, bool touching, uint16_t x, uint16_t y)
+*
+* @note
+*       The HID interface has several input reports (mouse, keyboard, consumer control and vendor),
+*       declared in usb_hid_reports.hidspec. All of them are sent through the same interrupt
+*       IN endpoint, each one prefixed with its report ID. A report is only sent when there is
+*       something new to report or when its idle rate set by the host expires, and when several
+*       reports are pending the one with the highest priority goes first.
+*       The keyboard reports its keys as a bitmap, so any number of keys can be pressed at the same
+*       time (N-key rollover). The interface supports the boot protocol of the keyboard, where only
+*       the keyboard is reported, converted to the boot report with up to six keys.
+*       Besides the relative mouse, positions are reported by an absolute pointer and a multi-touch
+*       screen. The touch screen tracks its contacts and sends each frame with all of them in as few
+*       reports as possible, several contacts per report (hybrid mode).
+*/
+
+#ifndef USB_HID_CLASS_H
+#define USB_HID_CLASS_H
+
+#include "usb_class.h"
+#include "usb_hid_reports.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/***************************************************************************************************/
+/*                                       Exported Variables                                        */
+/***************************************************************************************************/
+
+extern const USB_Class_Driver_t USB_HID_class;
+
+/***************************************************************************************************/
+/*                                       APIs Supported                                            */
+/***************************************************************************************************/
+
+/**
+ * @brief Function for updating the state of an input report. The report is copied into its buffer
+ *        and it is only sent if it differs from the state held in the buffer, at once if the
+ *        endpoint is idle or as soon as the reports with higher priority have been sent.
+ * @param[in] report_id is the report ID, @ref USB_HID_REPORT_IDS.
+ * @param[in] report is a pointer to the new report, with the structure of the report declared in
+ *            the report specification. Its report ID field is ignored.
+ * @return true if the report ID is known, false otherwise.
+ */
+bool USB_HID_Report_Write(uint8_t report_id, void const* report);
+
+/**
+ * @brief Function for updating the state of the mouse. The movement is accumulated until it is
+ *        reported, and the report is sent at once if the endpoint is idle. Nothing is sent if there
+ *        is no movement and the buttons do not change.
+ * @param[in] x is the relative movement in the X axis.
+ * @param[in] y is the relative movement in the Y axis.
+ * @param[in] buttons is the state of the buttons, one bit per button.
+ * @return void
+ */
+void USB_HID_Mouse_Update(int8_t x, int8_t y, uint8_t buttons);
+
+/**
+ * @brief Function for updating the state of a key of the keyboard. The report is only sent if the
+ *        state of the key changes, at once if the endpoint is idle.
+ * @param[in] usage is the usage of the key in the keyboard page, from HID_KEYBOARD_A to
+ *            USB_HID_KEYBOARD_KEYS - 1 or a modifier (HID_KEYBOARD_LEFT_CONTROL to
+ *            HID_KEYBOARD_RIGHT_GUI). Other usages are ignored.
+ * @param[in] pressed is true if the key is pressed, false if it is released.
+ * @return void
+ */
+void USB_HID_Keyboard_Set_Key(uint8_t usage, bool pressed);
+
+/**
+ * @brief Function for getting the state of the keyboard LEDs set by the host.
+ * @return the state of the LEDs, one bit per LED from HID_LED_NUM_LOCK (bit 0).
+ */
+uint8_t USB_HID_Keyboard_Get_LEDs(void);
+
+/**
+ * @brief Function for updating the state of the absolute pointer. The report is only sent if the
+ *        state differs from the last one.
+ * @param[in] x is the position in the X axis, from 0 to USB_HID_POINTER_MAXIMUM.
+ * @param[in] y is the position in the Y axis, from 0 to USB_HID_POINTER_MAXIMUM.
+ * @param[in] buttons is the state of the buttons, one bit per button.
+ * @return void
+ */
+void USB_HID_Pointer_Update(uint16_t x, uint16_t y, uint8_t buttons);
+
+/**
+ * @brief Function for updating a contact of the touch screen. The updates are gathered into frames
+ *        with all the tracked contacts, a new frame is sent once the previous one has been sent.
+ *        A released contact is reported once with its tip switch cleared and then forgotten.
+ * @param[in] contact_id is the identifier of the contact, it must not change while it touches.
+ * @param[in] touching is true while the finger touches the surface, false when it is released.
+ * @param[in] x is the position in the X axis, from 0 to USB_HID_TOUCH_MAXIMUM.
+ * @param[in] y is the position in the Y axis, from 0 to USB_HID_TOUCH_MAXIMUM.
+ * @return false if the contact is new and USB_HID_TOUCH_CONTACTS contacts are already tracked,
+ *         true otherwise.
+ */
+bool USB_HID_Touch_Update(uint8_t contact_id, bool touching, uint16_t x, uint16_t y);
+
+#endif /* USB_HID_CLASS_H */
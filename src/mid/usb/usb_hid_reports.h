@@ -0,0 +1,39 @@
+/************************************************************************************************//**
+* @file usb_hid_reports.h
+*
+* @brief Header file containing the reports of the HID interface.
+*
+* @note
+*       All the reports share the interrupt IN endpoint of the HID interface, so each one starts
+*       with its report ID. The reports are declared in usb_hid_reports.hidspec, which is compiled at
+*       build time into usb_hid_report_spec.h with the report descriptor, the structure of each
+*       report and the table @ref USB_HID_INPUT_REPORTS. The report buffers and the scheduling data
+*       of the HID class driver are generated from that table, so nothing can get out of sync. For
+*       adding a report, declare it in the specification.
+*/
+
+#ifndef USB_HID_REPORTS_H
+#define USB_HID_REPORTS_H
+
+#include "usb_hid_report_spec.h"
+#include <stdint.h>
+
+/** @brief Number of keys reported at the same time by the boot keyboard report (6-key rollover) */
+#define USB_HID_BOOT_KEYBOARD_KEYS      6
+/** @brief Report ID of the report sent in the boot protocol, built from the keyboard report */
+#define USB_HID_BOOT_REPORT_ID          USB_HID_REPORT_ID_KEYBOARD
+/** @brief Tip switch flag of a touch contact, set while the finger touches the surface */
+#define USB_HID_TOUCH_TIP_SWITCH        0x01
+
+/**
+ * @brief Structure of the boot keyboard report, without report ID, with the usages of up to six
+ *        pressed keys. It is fixed by the HID standard and it is not in the report descriptor.
+ */
+typedef struct
+{
+    uint8_t modifiers;
+    uint8_t reserved;
+    uint8_t keys[USB_HID_BOOT_KEYBOARD_KEYS];
+} __attribute__((__packed__)) HID_Boot_Keyboard_Report_t;
+
+#endif /* USB_HID_REPORTS_H */
@@ -6,6 +6,14 @@
 * Public Functions:
 *       - void USB_Device_Init(USB_Device_t* usb_device)
 *       - void USB_Device_Poll(void)
+*       - void USB_Control_Send(void const* buffer, uint16_t size)
+*       - void USB_Control_Receive(void* buffer, uint16_t size, USB_Control_Out_Callback_t callback)
+*       - void USB_Control_Acknowledge(void)
+*       - void USB_Device_Set_Mode(USBDeviceMode_t mode)
+*       - uint32_t USB_Device_Get_Wakeup_Latency(void)
+*       - bool USB_Device_Is_Suspended(void)
+*       - bool USB_Device_Remote_Wakeup(void)
+*       - uint32_t USB_Device_Get_Remote_Wakeup_Latency(void)
 *
 * @note
 *       For further information about functions refer to the corresponding header file.
@@ -15,17 +23,71 @@
 #include "usb_driver.h"
 #include "usb_device_descriptor.h"
 #include "usb_standards.h"
-#include "usb_hid.h"
+#include "usb_class.h"
+#include "cycle_counter.h"
+#include "power_driver.h"
 #include "logger.h"
 #include "helper_math.h"
 #include <stdint.h>
 #include <stddef.h>
+#include <stdbool.h>
+
+/** @brief Time in ms the device stays disconnected when switching its mode, so the host notices */
+#define USB_MODE_SWITCH_DISCONNECT_TIME     20
+/** @brief Low power mode entered while the bus is suspended, the stop mode draws the least current
+ *         but the clocks take longer to restart than from the sleep mode */
+#define USB_SUSPEND_POWER_MODE              POWER_MODE_STOP
+/** @brief Time in ms the bus must be idle before signaling a remote wakeup, the suspend is detected
+ *         after 3 ms and the host expects 5 ms of idle */
+#define USB_REMOTE_WAKEUP_IDLE_TIME         2
+/** @brief Time in ms the remote wakeup is signaled, it must be between 1 ms and 15 ms */
+#define USB_REMOTE_WAKEUP_SIGNAL_TIME       5
+
+/**
+ * @brief List of the stages of a remote wakeup.
+ */
+typedef enum
+{
+    USB_REMOTE_WAKEUP_IDLE,
+    USB_REMOTE_WAKEUP_REQUESTED,
+    USB_REMOTE_WAKEUP_SIGNALING,
+    USB_REMOTE_WAKEUP_RESUMING
+}USBRemoteWakeupStage_t;
 
 /***************************************************************************************************/
 /*                                       Static Variables                                          */
 /***************************************************************************************************/
 
 static USB_Device_t* usb_device_handle;
+/** @brief Descriptors and class drivers of the current mode of the device */
+static USB_Device_Profile_t const* usb_profile = &device_profiles[USB_DEVICE_MODE_RUNTIME];
+/** @brief Current mode of the device */
+static USBDeviceMode_t usb_mode = USB_DEVICE_MODE_RUNTIME;
+/** @brief Mode requested with USB_Device_Set_Mode, it is applied from the poll event */
+static USBDeviceMode_t usb_requested_mode = USB_DEVICE_MODE_RUNTIME;
+/** @brief Flag indicating the device is disconnected from the bus for changing its mode */
+static bool usb_mode_switching;
+/** @brief Cycle count when the device was disconnected for changing its mode */
+static uint32_t usb_disconnect_cycles;
+/** @brief Flag indicating the device has been in low power mode since the bus was suspended */
+static bool usb_low_power;
+/** @brief Cycle count when the system clock was restored after the low power mode */
+static uint32_t usb_wakeup_cycles;
+/** @brief Wake-up latency in us, up to the restore of the system clock or of the last resume */
+static uint32_t usb_wakeup_latency;
+/** @brief Cycle count when the bus was suspended */
+static uint32_t usb_suspend_cycles;
+/** @brief Current stage of the remote wakeup */
+static USBRemoteWakeupStage_t usb_remote_wakeup_stage;
+/** @brief Cycle count when the remote wakeup was requested */
+static uint32_t usb_remote_wakeup_cycles;
+/** @brief Cycle count when the remote wakeup signaling started */
+static uint32_t usb_remote_wakeup_signal_cycles;
+/** @brief Latency in us of the last remote wakeup */
+static uint32_t usb_remote_wakeup_latency;
+/** @brief Status returned by the GET_STATUS request, or alternate setting returned by the
+ *         GET_INTERFACE request */
+static uint16_t usb_status;
 
 /***************************************************************************************************/
 /*                                       Static Function Prototypes                                */
@@ -48,6 +110,22 @@ static void USB_Setup_Data_Received_Handler(
     uint16_t byte_cnt
 );
 
+/**
+ * @brief Function for managing the end of the SETUP stage, the first packet of the DATA IN or
+ *        STATUS IN stage of the request is queued.
+ * @param[in] endpoint_number is the endpoint number from the event is received.
+ * @return void
+ */
+static void USB_Setup_Completed_Handler(__attribute__((unused)) uint8_t endpoint_number);
+
+/**
+ * @brief Function for managing a received OUT data event.
+ * @param[in] endpoint_number is the endpoint number from the event is received.
+ * @param[in] byte_cnt is the amount of received bytes.
+ * @return void
+ */
+static void USB_Out_Data_Received_Handler(uint8_t endpoint_number, uint16_t byte_cnt);
+
 /**
  * @brief Function for managing the poll event.
  * @return void
@@ -66,14 +144,62 @@ static void USB_In_Transfer_Completed_Handler(uint8_t endpoint_number);
  * @param[in] endpoint_number is the endpoint number for the OUT transfer.
  * @return void
  */
-static void USB_Out_Transfer_Completed_Handler(__attribute__((unused)) uint8_t endpoint_number);
+static void USB_Out_Transfer_Completed_Handler(uint8_t endpoint_number);
+
+/**
+ * @brief Function for managing the start of frame event.
+ * @return void
+ */
+static void USB_SOF_Received_Handler(void);
+
+/**
+ * @brief Function for managing the suspend event, the state of the device is kept until the bus
+ *        resumes.
+ * @return void
+ */
+static void USB_Suspend_Received_Handler(void);
 
 /**
- * @brief Function for setting the configuration of the device.
+ * @brief Function for managing the resume event, the state of the device before the suspend is
+ *        restored.
+ * @return void
+ */
+static void USB_Resume_Received_Handler(void);
+
+/**
+ * @brief Function for setting the configuration of the device, all the class drivers are
+ *        initialized.
  * @return void
 */
 static void USB_Device_Configure(void);
 
+/**
+ * @brief Function for driving the remote wakeup signaling once it has been requested.
+ * @return void
+ */
+static void process_remote_wakeup(void);
+
+/**
+ * @brief Function for clearing the configuration of the device, all the class drivers are
+ *        deinitialized.
+ * @return void
+*/
+static void USB_Device_Deconfigure(void);
+
+/**
+ * @brief Function for applying the mode requested with USB_Device_Set_Mode, the device is
+ *        disconnected and its state is reset to the one of a device just attached.
+ * @return void
+ */
+static void switch_device_mode(void);
+
+/**
+ * @brief Function for building the serial number string descriptor from the 96 bit unique ID of the
+ *        device.
+ * @return void
+ */
+static void init_serial_number(void);
+
 /**
  * @brief Function for processing a received request.
  * @return void
@@ -88,11 +214,19 @@ static void process_request(void);
 static void process_standard_device_request(const USB_Request_t* request);
 
 /**
- * @brief Function for processing an interface USB request.
+ * @brief Function for routing a USB request to the class driver owning its interface or endpoint.
  * @param[in] request is a pointer to the received request.
  * @return void
  */
-static void process_class_interface_request(const USB_Request_t* request);
+static void process_class_driver_request(const USB_Request_t* request);
+
+/**
+ * @brief Function for processing the standard requests addressed to an endpoint. The class driver
+ *        owning the endpoint gets the request first, so it can take over the halt handling.
+ * @param[in] request is a pointer to the received request.
+ * @return void
+ */
+static void process_standard_endpoint_request(const USB_Request_t* request);
 
 /**
  * @brief Function for processing an standard interface USB request.
@@ -102,18 +236,62 @@ static void process_class_interface_request(const USB_Request_t* request);
 static void process_standard_interface_request(const USB_Request_t* request);
 
 /**
- * @brief Function implementing the finite state machine for controlling the transfer stages of the 
- *        USB device.
+ * @brief Function for processing a vendor request addressed to the device, only the request for
+ *        the MS OS 2.0 descriptor set is supported.
+ * @param[in] request is a pointer to the received request.
  * @return void
  */
-static void process_control_transfer_stage(void);
+static void process_vendor_device_request(const USB_Request_t* request);
 
 /**
- * @brief Function for sendind the report of the mouse, it will send information for moving the
- *        mouse to the rigth.
+ * @brief Function for processing a GET_DESCRIPTOR request, the descriptor is looked up in the
+ *        descriptor registry using the descriptor type, the descriptor index and wIndex.
+ * @param[in] request is a pointer to the received request.
  * @return void
-*/
-static void write_mouse_report(void);
+ */
+static void process_get_descriptor_request(const USB_Request_t* request);
+
+/**
+ * @brief Function for starting the DATA IN stage of a control read transfer.
+ * @param[in] buffer is a pointer to the data to be sent.
+ * @param[in] size is the size of the data in bytes, it is clamped to the wLength of the request.
+ * @return void
+ */
+static void start_control_in_stage(void const* buffer, uint16_t size);
+
+/**
+ * @brief Function for starting the DATA OUT stage of a control write transfer.
+ * @param[in] buffer is a pointer to the buffer where the received data will be stored.
+ * @param[in] size is the size of the buffer in bytes, received data beyond it is discarded.
+ * @param[in] callback is the function called once the whole DATA OUT stage has been received.
+ * @return void
+ */
+static void start_control_out_stage(void* buffer,
+                                    uint16_t size,
+                                    USB_Control_Out_Callback_t callback);
+
+/**
+ * @brief Function for answering the current control transfer with a STALL handshake.
+ * @return void
+ */
+static void stall_control_transfer(void);
+
+/**
+ * @brief Function for popping data from the RxFIFO without storing it.
+ * @param[in] byte_cnt is the amount of bytes to be popped.
+ * @return void
+ */
+static void discard_out_data(uint16_t byte_cnt);
+
+
+/**
+ * @brief Function implementing the finite state machine for controlling the transfer stages of the 
+ *        USB device, it queues the next packet of the IN stages.
+ * @return void
+ * @note It runs on the events of the endpoint 0: the end of the SETUP stage, the end of each packet
+ *       of the DATA IN stage and the end of the DATA OUT stage.
+ */
+static void process_control_transfer_stage(void);
 
 /***************************************************************************************************/
 /*                                       Global Variables                                          */
@@ -122,9 +300,14 @@ static void write_mouse_report(void);
 USB_Events_t USB_events = {
     .USB_Reset_Received = &USB_Reset_Received_Handler,
     .USB_Setup_Data_Received = &USB_Setup_Data_Received_Handler,
+    .USB_Setup_Completed = &USB_Setup_Completed_Handler,
+    .USB_Out_Data_Received = &USB_Out_Data_Received_Handler,
     .USB_Polled = &USB_Polled_Handler,
     .USB_In_Transfer_Completed = &USB_In_Transfer_Completed_Handler,
-    .USB_Out_Transfer_Completed = &USB_Out_Transfer_Completed_Handler
+    .USB_Out_Transfer_Completed = &USB_Out_Transfer_Completed_Handler,
+    .USB_SOF_Received = &USB_SOF_Received_Handler,
+    .USB_Suspend_Received = &USB_Suspend_Received_Handler,
+    .USB_Resume_Received = &USB_Resume_Received_Handler
 };
 
 /***************************************************************************************************/
@@ -134,6 +317,9 @@ USB_Events_t USB_events = {
 void USB_Device_Init(USB_Device_t* usb_device)
 {
     usb_device_handle = usb_device;
+    init_serial_number();
+    Cycle_Counter_Init();
+    Power_Init();
     USB_driver.USB_Init();
     USB_driver.USB_Connect();
 }
@@ -141,6 +327,68 @@ void USB_Device_Init(USB_Device_t* usb_device)
 void USB_Device_Poll(void)
 {
     USB_driver.USB_Poll();
+
+    /* A disconnected device waits for being connected again instead of for the bus to resume, and
+       a requested remote wakeup waits for the bus to be idle long enough */
+    if((usb_device_handle->device_state == USB_DEVICE_STATE_SUSPENDED) && !usb_mode_switching &&
+       (usb_remote_wakeup_stage == USB_REMOTE_WAKEUP_IDLE)){
+        usb_wakeup_latency = Power_Enter_Low_Power(USB_SUSPEND_POWER_MODE);
+        usb_wakeup_cycles = Cycle_Counter_Get();
+        usb_low_power = true;
+    }
+}
+
+void USB_Control_Send(void const* buffer, uint16_t size)
+{
+    start_control_in_stage(buffer, size);
+}
+
+void USB_Control_Receive(void* buffer, uint16_t size, USB_Control_Out_Callback_t callback)
+{
+    start_control_out_stage(buffer, size, callback);
+}
+
+void USB_Control_Acknowledge(void)
+{
+    log_info("Switching control transfer stage to IN-STATUS");
+    usb_device_handle->control_transfer_stage = USB_CONTROL_STAGE_STATUS_IN;
+}
+
+void USB_Device_Set_Mode(USBDeviceMode_t mode)
+{
+    if(mode < USB_DEVICE_MODE_COUNT){
+        usb_requested_mode = mode;
+    }
+}
+
+uint32_t USB_Device_Get_Wakeup_Latency(void)
+{
+    return usb_wakeup_latency;
+}
+
+bool USB_Device_Is_Suspended(void)
+{
+    return usb_device_handle->device_state == USB_DEVICE_STATE_SUSPENDED;
+}
+
+bool USB_Device_Remote_Wakeup(void)
+{
+    if((usb_device_handle->device_state != USB_DEVICE_STATE_SUSPENDED) ||
+       !usb_device_handle->remote_wakeup_enabled){
+        return false;
+    }
+
+    if(usb_remote_wakeup_stage == USB_REMOTE_WAKEUP_IDLE){
+        usb_remote_wakeup_cycles = Cycle_Counter_Get();
+        usb_remote_wakeup_stage = USB_REMOTE_WAKEUP_REQUESTED;
+    }
+
+    return true;
+}
+
+uint32_t USB_Device_Get_Remote_Wakeup_Latency(void)
+{
+    return usb_remote_wakeup_latency;
 }
 
 /***************************************************************************************************/
@@ -149,12 +397,27 @@ void USB_Device_Poll(void)
 
 static void USB_Reset_Received_Handler(void)
 {
+    for(uint8_t i = 0; i < usb_profile->class_driver_count; i++){
+        if(usb_profile->class_drivers[i]->Reset != NULL){
+            usb_profile->class_drivers[i]->Reset();
+        }
+    }
+    if(usb_device_handle->device_state == USB_DEVICE_STATE_CONFIGURED){
+        USB_Device_Deconfigure();
+    }
     usb_device_handle->in_data_size = 0;
     usb_device_handle->out_data_size = 0;
+    usb_device_handle->control_out_callback = NULL;
     usb_device_handle->configuration_value = 0;
+    usb_device_handle->remote_wakeup_enabled = false;
     usb_device_handle->device_state = USB_DEVICE_STATE_DEFAULT;
     usb_device_handle->control_transfer_stage = USB_CONTROL_STAGE_SETUP;
     USB_driver.USB_Set_Device_Address(0);
+
+    if(usb_remote_wakeup_stage == USB_REMOTE_WAKEUP_SIGNALING){
+        USB_driver.USB_Stop_Remote_Wakeup();
+    }
+    usb_remote_wakeup_stage = USB_REMOTE_WAKEUP_IDLE;
 }
 
 static void USB_Setup_Data_Received_Handler(
@@ -166,48 +429,268 @@ static void USB_Setup_Data_Received_Handler(
     process_request();
 }
 
-static void USB_Polled_Handler(void)
+static void USB_Setup_Completed_Handler(__attribute__((unused)) uint8_t endpoint_number)
 {
+    /* The request was decoded with its SETUP packet, so its answer is ready */
     process_control_transfer_stage();
 }
 
+static void USB_Out_Data_Received_Handler(uint8_t endpoint_number, uint16_t byte_cnt)
+{
+    uint16_t accepted = 0;
+    USB_Class_Driver_t const* class_driver =
+        usb_profile->out_endpoint_class_drivers[endpoint_number];
+
+    if(endpoint_number != 0){
+        /* The class driver owning the endpoint pops the data straight from the RxFIFO */
+        if((class_driver != NULL) && (class_driver->Data_Out != NULL)){
+            class_driver->Data_Out(endpoint_number, byte_cnt);
+        }
+        else{
+            discard_out_data(byte_cnt);
+        }
+        return;
+    }
+
+    if(usb_device_handle->control_transfer_stage != USB_CONTROL_STAGE_DATA_OUT){
+        /* Nothing is expecting this data (e.g. the zero length packet of the OUT-STATUS stage) */
+        discard_out_data(byte_cnt);
+        if(usb_device_handle->control_transfer_stage == USB_CONTROL_STAGE_STATUS_OUT){
+            log_info("Switching control stage to SETUP");
+            usb_device_handle->control_transfer_stage = USB_CONTROL_STAGE_SETUP;
+        }
+        return;
+    }
+
+    accepted = MIN(byte_cnt, usb_device_handle->control_out_buffer_size -
+                             usb_device_handle->control_out_received);
+    USB_driver.USB_Read_Packet(
+        usb_device_handle->ptr_control_out_buffer + usb_device_handle->control_out_received,
+        accepted
+    );
+    /* The packet is popped in 32 bit words, so the last popped word may hold discarded bytes */
+    if(byte_cnt > (((accepted + 3)/4)*4)){
+        discard_out_data(byte_cnt - (((accepted + 3)/4)*4));
+    }
+    usb_device_handle->control_out_received += accepted;
+    usb_device_handle->out_data_size -= MIN(byte_cnt, usb_device_handle->out_data_size);
+
+    /* A short packet also finishes the DATA OUT stage */
+    if((usb_device_handle->out_data_size == 0) || (byte_cnt < device_descriptor.bMaxPacketSize0)){
+        if(usb_device_handle->control_out_callback != NULL){
+            usb_device_handle->control_out_callback(usb_device_handle->ptr_out_buffer,
+                                                    usb_device_handle->control_out_received);
+            usb_device_handle->control_out_callback = NULL;
+        }
+        log_info("Switching control stage to IN-STATUS");
+        usb_device_handle->control_transfer_stage = USB_CONTROL_STAGE_STATUS_IN;
+        process_control_transfer_stage();
+    }
+}
+
+static void USB_Polled_Handler(void)
+{
+    if(usb_requested_mode != usb_mode){
+        switch_device_mode();
+    }
+    else if(usb_mode_switching &&
+            ((Cycle_Counter_Get() - usb_disconnect_cycles) >=
+             ((SystemCoreClock/1000)*USB_MODE_SWITCH_DISCONNECT_TIME))){
+        /* The host has seen the device leaving, so it enumerates it again with the new profile */
+        usb_mode_switching = false;
+        USB_driver.USB_Connect();
+    }
+
+    process_remote_wakeup();
+
+    if(usb_device_handle->device_state != USB_DEVICE_STATE_CONFIGURED){
+        return;
+    }
+
+    for(uint8_t i = 0; i < usb_profile->class_driver_count; i++){
+        if(usb_profile->class_drivers[i]->Poll != NULL){
+            usb_profile->class_drivers[i]->Poll();
+        }
+    }
+}
+
 static void USB_In_Transfer_Completed_Handler(uint8_t endpoint_number)
 {
-    if(usb_device_handle->in_data_size){
+    USB_Class_Driver_t const* class_driver =
+        usb_profile->in_endpoint_class_drivers[endpoint_number];
+
+    if(endpoint_number != 0){
+        if((class_driver != NULL) && (class_driver->Data_In != NULL)){
+            class_driver->Data_In(endpoint_number);
+        }
+        return;
+    }
+
+    /* The next packet is queued as soon as the previous one has been sent */
+    if(usb_device_handle->control_transfer_stage == USB_CONTROL_STAGE_DATA_IN_IDLE){
         log_info("Switching control stage to IN-DATA");
         usb_device_handle->control_transfer_stage = USB_CONTROL_STAGE_DATA_IN;
+        process_control_transfer_stage();
     }
     else if(usb_device_handle->control_transfer_stage == USB_CONTROL_STAGE_DATA_IN_ZERO){
         USB_driver.USB_Write_Packet(0, NULL, 0);
         log_info("Switching control stage to OUT STATUS");
         usb_device_handle->control_transfer_stage = USB_CONTROL_STAGE_STATUS_OUT;
     }
+}
+
+static void USB_Out_Transfer_Completed_Handler(uint8_t endpoint_number)
+{
+    USB_Class_Driver_t const* class_driver =
+        usb_profile->out_endpoint_class_drivers[endpoint_number];
+
+    if((endpoint_number != 0) && (class_driver != NULL) &&
+       (class_driver->Data_Out_Completed != NULL)){
+        class_driver->Data_Out_Completed(endpoint_number);
+    }
+}
+
+static void USB_SOF_Received_Handler(void)
+{
+    /* The first start of frame after the resume tells the host is using the bus again */
+    if(usb_remote_wakeup_stage == USB_REMOTE_WAKEUP_RESUMING){
+        usb_remote_wakeup_latency =
+            (Cycle_Counter_Get() - usb_remote_wakeup_cycles)/(SystemCoreClock/1000000);
+        usb_remote_wakeup_stage = USB_REMOTE_WAKEUP_IDLE;
+        log_info("USB host resumed, remote wakeup latency %lu us", usb_remote_wakeup_latency);
+    }
+
+    if(usb_device_handle->device_state != USB_DEVICE_STATE_CONFIGURED){
+        return;
+    }
 
-    if(endpoint_number ==
-       (cfg_descriptor_combination.usb_mouse_endpoint_descriptor.bEndpointAddress & 0x0F)){
-        write_mouse_report();
+    for(uint8_t i = 0; i < usb_profile->class_driver_count; i++){
+        if(usb_profile->class_drivers[i]->SOF != NULL){
+            usb_profile->class_drivers[i]->SOF();
+        }
     }
 }
 
-static void USB_Out_Transfer_Completed_Handler(__attribute__((unused)) uint8_t endpoint_number)
+static void USB_Suspend_Received_Handler(void)
 {
-    /* To be defined */
+    if(usb_device_handle->device_state == USB_DEVICE_STATE_SUSPENDED){
+        return;
+    }
+
+    usb_device_handle->resume_state = usb_device_handle->device_state;
+    usb_device_handle->device_state = USB_DEVICE_STATE_SUSPENDED;
+    usb_low_power = false;
+    usb_suspend_cycles = Cycle_Counter_Get();
+    /* The host did not resume the bus after a remote wakeup, a new input is needed to try again */
+    usb_remote_wakeup_stage = USB_REMOTE_WAKEUP_IDLE;
+}
+
+static void USB_Resume_Received_Handler(void)
+{
+    if(usb_device_handle->device_state != USB_DEVICE_STATE_SUSPENDED){
+        return;
+    }
+
+    usb_device_handle->device_state = usb_device_handle->resume_state;
+
+    if(usb_low_power){
+        usb_wakeup_latency += (Cycle_Counter_Get() - usb_wakeup_cycles)/(SystemCoreClock/1000000);
+    }
+    else{
+        usb_wakeup_latency = 0;
+    }
+    log_info("USB device resumed, wake-up latency %lu us", usb_wakeup_latency);
 }
 
 static void USB_Device_Configure(void)
 {
-    USB_driver.USB_Configure_IN_Endpoint(
-        (cfg_descriptor_combination.usb_mouse_endpoint_descriptor.bEndpointAddress & 0x0F),
-        (cfg_descriptor_combination.usb_mouse_endpoint_descriptor.bmAttributes & 0x03),
-        cfg_descriptor_combination.usb_mouse_endpoint_descriptor.wMaxPacketSize
-    );
+    for(uint8_t i = 0; i < usb_profile->class_driver_count; i++){
+        if(usb_profile->class_drivers[i]->Init != NULL){
+            usb_profile->class_drivers[i]->Init();
+        }
+    }
+}
 
-    /* For confirming the configuration send a status IN packet (view reference manual) */
-    USB_driver.USB_Write_Packet(
-        (cfg_descriptor_combination.usb_mouse_endpoint_descriptor.bEndpointAddress & 0x0F),
-        NULL,
-        0
-    );
+static void USB_Device_Deconfigure(void)
+{
+    for(uint8_t i = 0; i < usb_profile->class_driver_count; i++){
+        if(usb_profile->class_drivers[i]->Deinit != NULL){
+            usb_profile->class_drivers[i]->Deinit();
+        }
+    }
+}
+
+static void process_remote_wakeup(void)
+{
+    switch(usb_remote_wakeup_stage){
+        case USB_REMOTE_WAKEUP_REQUESTED:
+            if(usb_device_handle->device_state != USB_DEVICE_STATE_SUSPENDED){
+                /* The host resumed the bus before the remote wakeup was signaled */
+                usb_remote_wakeup_stage = USB_REMOTE_WAKEUP_IDLE;
+            }
+            /* The cycle counter stops in STOP mode, so once the device has slept the sleep is
+               taken as the rest of the idle time instead of waiting for it again */
+            else if(usb_low_power ||
+                    ((Cycle_Counter_Get() - usb_suspend_cycles) >=
+                     ((SystemCoreClock/1000)*USB_REMOTE_WAKEUP_IDLE_TIME))){
+                USB_driver.USB_Start_Remote_Wakeup();
+                usb_remote_wakeup_signal_cycles = Cycle_Counter_Get();
+                usb_remote_wakeup_stage = USB_REMOTE_WAKEUP_SIGNALING;
+                /* The host drives the resume after the signaling, the device is not suspended */
+                usb_device_handle->device_state = usb_device_handle->resume_state;
+            }
+            break;
+        case USB_REMOTE_WAKEUP_SIGNALING:
+            if((Cycle_Counter_Get() - usb_remote_wakeup_signal_cycles) >=
+               ((SystemCoreClock/1000)*USB_REMOTE_WAKEUP_SIGNAL_TIME)){
+                USB_driver.USB_Stop_Remote_Wakeup();
+                usb_remote_wakeup_stage = USB_REMOTE_WAKEUP_RESUMING;
+            }
+            break;
+        default:
+            /* do nothing */
+            break;
+    }
+}
+
+static void switch_device_mode(void)
+{
+    if(usb_device_handle->device_state == USB_DEVICE_STATE_CONFIGURED){
+        USB_Device_Deconfigure();
+    }
+    USB_driver.USB_Disconnect();
+    usb_disconnect_cycles = Cycle_Counter_Get();
+    usb_mode_switching = true;
+
+    usb_mode = usb_requested_mode;
+    usb_profile = &device_profiles[usb_mode];
+    usb_device_handle->in_data_size = 0;
+    usb_device_handle->out_data_size = 0;
+    usb_device_handle->control_out_callback = NULL;
+    usb_device_handle->configuration_value = 0;
+    usb_device_handle->remote_wakeup_enabled = false;
+    usb_device_handle->device_state = USB_DEVICE_STATE_DEFAULT;
+    usb_device_handle->control_transfer_stage = USB_CONTROL_STAGE_SETUP;
+    USB_driver.USB_Set_Device_Address(0);
+    log_info("Switching device mode to %u", (unsigned)usb_mode);
+}
+
+static void init_serial_number(void)
+{
+    static char const hex_digits[] = "0123456789ABCDEF";
+    uint32_t const* unique_id = (uint32_t const*)UID_BASE;
+    uint8_t digit = 0;
+
+    serial_number_string_descriptor.bLength = sizeof(USB_SerialNumberDescriptor_t);
+    serial_number_string_descriptor.bDescriptorType = USB_DESCRIPTOR_TYPE_STRING;
+
+    /* Print the three 32 bit words of the unique ID starting from the most significant nibble */
+    for(uint8_t word = 0; word < 3; word++){
+        for(int8_t shift = 28; shift >= 0; shift -= 4){
+            serial_number_string_descriptor.wString[digit++] =
+                hex_digits[(unique_id[word] >> shift) & 0x0F];
+        }
+    }
 }
 
 static void process_request(void)
@@ -219,51 +702,52 @@ static void process_request(void)
         case USB_BM_REQUEST_TYPE_TYPE_STANDARD | USB_BM_REQUEST_TYPE_RECIPIENT_DEVICE:
             process_standard_device_request(request);
             break;
-        case USB_BM_REQUEST_TYPE_TYPE_CLASS | USB_BM_REQUEST_TYPE_RECIPIENT_INTERFACE:
-            process_class_interface_request(request);
-            break;
         case USB_BM_REQUEST_TYPE_TYPE_STANDARD | USB_BM_REQUEST_TYPE_RECIPIENT_INTERFACE:
             process_standard_interface_request(request);
             break;
+        case USB_BM_REQUEST_TYPE_TYPE_STANDARD | USB_BM_REQUEST_TYPE_RECIPIENT_ENDPOINT:
+            process_standard_endpoint_request(request);
+            break;
+        case USB_BM_REQUEST_TYPE_TYPE_VENDOR | USB_BM_REQUEST_TYPE_RECIPIENT_DEVICE:
+            process_vendor_device_request(request);
+            break;
         default:
-            /* do nothing */
+            process_class_driver_request(request);
             break;
     }
 }
 
 static void process_standard_device_request(const USB_Request_t* request)
 {
-    uint8_t descriptor_type = 0;
-    uint16_t descriptor_length = 0;
     uint16_t device_address = 0;
-//    uint8_t descriptor_index = 0;     /* Can be needed for getting the descriptor index */
 
     switch(request->bRequest){
         case USB_STANDARD_GET_DESCRIPTOR:
             log_info("Standard Get Descriptor request received");
-            descriptor_type = request->wValue >> 8;
-            descriptor_length = request->wLength;
-            /* Can be needed for getting the descriptor index */
-//            descriptor_index = request->wValue & 0xFF;
-            switch(descriptor_type){
-                case USB_DESCRIPTOR_TYPE_DEVICE:
-                    log_info("- Get Device Descriptor");
-                    usb_device_handle->ptr_in_buffer = &device_descriptor;
-                    usb_device_handle->in_data_size = descriptor_length;
-                    log_info("Switching control transfer stage to IN-DATA");
-                    usb_device_handle->control_transfer_stage = USB_CONTROL_STAGE_DATA_IN;
-                    break;
-                case USB_DESCRIPTOR_TYPE_CONFIGURATION:
-                    log_info("- Get Configuration Descriptor");
-                    usb_device_handle->ptr_in_buffer = &cfg_descriptor_combination;
-                    usb_device_handle->in_data_size = descriptor_length;
-                    log_info("Switching control transfer stage to IN-DATA");
-                    usb_device_handle->control_transfer_stage = USB_CONTROL_STAGE_DATA_IN;
-                    break;
-                default:
-                    /* do nothing */
-                    break;
+            process_get_descriptor_request(request);
+            break;
+        case USB_STANDARD_GET_STATUS:
+            log_info("Standard Get Status request received");
+            usb_status = 0;
+            if(usb_profile->configuration_attributes & USB_CONFIG_ATTR_SELF_POWERED){
+                usb_status |= USB_DEVICE_STATUS_SELF_POWERED;
             }
+            if(usb_device_handle->remote_wakeup_enabled){
+                usb_status |= USB_DEVICE_STATUS_REMOTE_WAKEUP;
+            }
+            start_control_in_stage(&usb_status, sizeof(usb_status));
+            break;
+        case USB_STANDARD_CLEAR_FEATURE:
+        case USB_STANDARD_SET_FEATURE:
+            log_info("Standard Set or Clear Feature request received");
+            if((request->wValue != USB_FEATURE_DEVICE_REMOTE_WAKEUP) ||
+               !(usb_profile->configuration_attributes & USB_CONFIG_ATTR_REMOTE_WAKEUP)){
+                stall_control_transfer();
+                break;
+            }
+            usb_device_handle->remote_wakeup_enabled =
+                (request->bRequest == USB_STANDARD_SET_FEATURE);
+            USB_Control_Acknowledge();
             break;
         case USB_STANDARD_SET_ADDRESS:
             log_info("Standard Set Address request received");
@@ -275,44 +759,279 @@ static void process_standard_device_request(const USB_Request_t* request)
             break;
         case USB_STANDARD_SET_CONFIG:
             log_info("Standard Set Configuration request received");
-            usb_device_handle->configuration_value = request->wValue;
-            USB_Device_Configure();
-            usb_device_handle->device_state = USB_DEVICE_STATE_CONFIGURED;
+            if((request->wValue & 0xFF) > usb_profile->configuration_value){
+                stall_control_transfer();
+                break;
+            }
+            /* Selecting the current configuration again keeps the state of the class drivers, e.g.
+               a DFU download in progress */
+            if((request->wValue & 0xFF) == usb_device_handle->configuration_value){
+                USB_Control_Acknowledge();
+                break;
+            }
+            if(usb_device_handle->device_state == USB_DEVICE_STATE_CONFIGURED){
+                USB_Device_Deconfigure();
+                usb_device_handle->device_state = USB_DEVICE_STATE_ADDRESSED;
+            }
+            usb_device_handle->configuration_value = request->wValue & 0xFF;
+            if(usb_device_handle->configuration_value != 0){
+                USB_Device_Configure();
+                usb_device_handle->device_state = USB_DEVICE_STATE_CONFIGURED;
+            }
             log_info("Switching control transfer state to IN-STATUS");
             usb_device_handle->control_transfer_stage = USB_CONTROL_STAGE_STATUS_IN;
             break;
+        case USB_STANDARD_GET_CONFIG:
+            log_info("Standard Get Configuration request received");
+            start_control_in_stage(&usb_device_handle->configuration_value,
+                                   sizeof(usb_device_handle->configuration_value));
+            break;
         default:
-            /* do nothing */
+            stall_control_transfer();
             break;
     }
 }
 
-static void process_class_interface_request(const USB_Request_t* request)
+static void process_standard_interface_request(const USB_Request_t* request)
 {
     switch(request->bRequest){
-        case USB_HID_SETIDLE:
-            log_info("Switching control transfer stage to IN-STATUS");
-            usb_device_handle->control_transfer_stage = USB_CONTROL_STAGE_STATUS_IN;
+        case USB_STANDARD_GET_DESCRIPTOR:
+            log_info("Standard Interface Get Descriptor request received");
+            process_get_descriptor_request(request);
+            break;
+        case USB_STANDARD_GET_INTERFACE:
+        case USB_STANDARD_SET_INTERFACE:
+            log_info("Standard Get or Set Interface request received");
+            /* The interfaces only exist once the device is configured and none of them has
+               alternate settings, so the alternate setting 0 is the only valid one */
+            if((usb_device_handle->device_state != USB_DEVICE_STATE_CONFIGURED) ||
+               (request->wIndex >= usb_profile->interface_count)){
+                stall_control_transfer();
+            }
+            else if(request->bRequest == USB_STANDARD_GET_INTERFACE){
+                usb_status = 0;
+                start_control_in_stage(&usb_status, 1);
+            }
+            else if(request->wValue == 0){
+                USB_Control_Acknowledge();
+            }
+            else{
+                stall_control_transfer();
+            }
             break;
         default:
-            /* do nothing */
+            process_class_driver_request(request);
             break;
     }
 }
 
-static void process_standard_interface_request(const USB_Request_t* request)
+static void process_class_driver_request(const USB_Request_t* request)
 {
-    switch(request->wValue >> 8){
-        case USB_DESCRIPTOR_TYPE_HID_REPORT:
-            usb_device_handle->ptr_in_buffer = &hid_report_descriptor;
-            usb_device_handle->in_data_size = sizeof(hid_report_descriptor);
-            log_info("Switching control transfer stage to IN-STATUS");
-            usb_device_handle->control_transfer_stage = USB_CONTROL_STAGE_DATA_IN;
+    USB_Class_Driver_t const* class_driver = NULL;
+    uint8_t number = request->wIndex & 0xFF;
+
+    /* The class drivers only own their interfaces and endpoints once the device is configured */
+    if(usb_device_handle->device_state != USB_DEVICE_STATE_CONFIGURED){
+        log_info("Class request received while the device is not configured");
+        stall_control_transfer();
+        return;
+    }
+
+    switch(request->bmRequestType & USB_BM_REQUEST_TYPE_RECIPIENT_MASK){
+        case USB_BM_REQUEST_TYPE_RECIPIENT_INTERFACE:
+            if(number < usb_profile->interface_count){
+                class_driver = usb_profile->interface_class_drivers[number];
+            }
+            break;
+        case USB_BM_REQUEST_TYPE_RECIPIENT_ENDPOINT:
+            if(USB_ENDPOINT_NUMBER(number) < USB_ENDPOINT_COUNT){
+                class_driver = (number & USB_ENDPOINT_DIRECTION_IN) ?
+                               usb_profile->in_endpoint_class_drivers[USB_ENDPOINT_NUMBER(number)] :
+                               usb_profile->out_endpoint_class_drivers[USB_ENDPOINT_NUMBER(number)];
+            }
             break;
         default:
             /* do nothing */
             break;
     }
+
+    if((class_driver == NULL) || (class_driver->Setup == NULL) || !class_driver->Setup(request)){
+        log_info("Request not supported by any class driver");
+        stall_control_transfer();
+    }
+}
+
+static void process_standard_endpoint_request(const USB_Request_t* request)
+{
+    uint8_t endpoint_address = request->wIndex & 0xFF;
+    uint8_t endpoint_number = USB_ENDPOINT_NUMBER(endpoint_address);
+    USB_Class_Driver_t const* class_driver = NULL;
+
+    /* The endpoint 0 is valid from the Default state on, the other endpoints only exist once the
+       device is configured */
+    if((endpoint_number >= USB_ENDPOINT_COUNT) ||
+       ((endpoint_number != 0) &&
+        (usb_device_handle->device_state != USB_DEVICE_STATE_CONFIGURED))){
+        stall_control_transfer();
+        return;
+    }
+
+    if(endpoint_number != 0){
+        class_driver = (endpoint_address & USB_ENDPOINT_DIRECTION_IN) ?
+                       usb_profile->in_endpoint_class_drivers[endpoint_number] :
+                       usb_profile->out_endpoint_class_drivers[endpoint_number];
+    }
+    if((class_driver != NULL) && (class_driver->Setup != NULL) && class_driver->Setup(request)){
+        return;
+    }
+
+    switch(request->bRequest){
+        case USB_STANDARD_GET_STATUS:
+            log_info("Standard Endpoint Get Status request received");
+            /* The STALL of the endpoint 0 only answers a control transfer, it is never halted */
+            usb_status = 0;
+            if((endpoint_number != 0) && USB_driver.USB_Is_Endpoint_Stalled(endpoint_address)){
+                usb_status |= USB_ENDPOINT_STATUS_HALT;
+            }
+            start_control_in_stage(&usb_status, sizeof(usb_status));
+            break;
+        case USB_STANDARD_CLEAR_FEATURE:
+            log_info("Standard Clear Feature request received");
+            if(request->wValue != USB_FEATURE_ENDPOINT_HALT){
+                stall_control_transfer();
+                break;
+            }
+            if(endpoint_number != 0){
+                USB_driver.USB_Clear_Endpoint_Stall(endpoint_address);
+            }
+            USB_Control_Acknowledge();
+            break;
+        case USB_STANDARD_SET_FEATURE:
+            log_info("Standard Set Feature request received");
+            if((request->wValue != USB_FEATURE_ENDPOINT_HALT) || (endpoint_number == 0)){
+                stall_control_transfer();
+                break;
+            }
+            USB_driver.USB_Stall_Endpoint(endpoint_address);
+            USB_Control_Acknowledge();
+            break;
+        default:
+            stall_control_transfer();
+            break;
+    }
+}
+
+static void process_vendor_device_request(const USB_Request_t* request)
+{
+    if((request->bRequest == USB_MSOS20_VENDOR_CODE) &&
+       (request->wIndex == USB_MSOS20_DESCRIPTOR_INDEX) &&
+       (request->bmRequestType & USB_BM_REQUEST_TYPE_DIRECTION_TOHOST)){
+        log_info("MS OS 2.0 descriptor set request received");
+        start_control_in_stage(usb_profile->msos20_descriptor_set,
+                               usb_profile->msos20_descriptor_set_length);
+        return;
+    }
+
+    stall_control_transfer();
+}
+
+static void process_get_descriptor_request(const USB_Request_t* request)
+{
+    uint8_t descriptor_type = request->wValue >> 8;
+    uint8_t descriptor_index = request->wValue & 0xFF;
+    USB_DescriptorRegistryType_t const* registry_type = NULL;
+    USB_DescriptorEntry_t const* entry = NULL;
+    uint16_t position = 0;
+
+    log_info("- Get Descriptor type 0x%02X index %d", descriptor_type, descriptor_index);
+
+    if(descriptor_type < usb_profile->descriptor_type_count){
+        registry_type = &usb_profile->descriptor_registry[descriptor_type];
+        position = (registry_type->key == USB_DESCRIPTOR_KEY_INTERFACE) ?
+                   request->wIndex : descriptor_index;
+        if(position < registry_type->count){
+            entry = &registry_type->entries[position];
+        }
+    }
+
+    /* The whole key is checked, the position only selects the candidate entry */
+    if((entry == NULL) || (entry->descriptor == NULL) ||
+       (entry->bIndex != descriptor_index) || (entry->wIndex != request->wIndex)){
+        log_info("- Descriptor not found");
+        stall_control_transfer();
+        return;
+    }
+
+    start_control_in_stage(entry->descriptor, entry->wLength);
+}
+
+static void start_control_in_stage(void const* buffer, uint16_t size)
+{
+    USB_Request_t const* request = usb_device_handle->ptr_out_buffer;
+
+    /* The data of a host to device request would be sent in its STATUS stage */
+    if(!(request->bmRequestType & USB_BM_REQUEST_TYPE_DIRECTION_TOHOST)){
+        stall_control_transfer();
+        return;
+    }
+
+    usb_device_handle->ptr_in_buffer = buffer;
+    /* Never send more than the host asked for, nor more than the buffer holds */
+    usb_device_handle->in_data_size = MIN(size, request->wLength);
+    /* A zero length packet marks the end only when the host asked for more than it gets */
+    usb_device_handle->in_zero_length_packet =
+        (usb_device_handle->in_data_size < request->wLength) &&
+        ((usb_device_handle->in_data_size % device_descriptor.bMaxPacketSize0) == 0);
+    log_info("Switching control transfer stage to IN-DATA");
+    usb_device_handle->control_transfer_stage = USB_CONTROL_STAGE_DATA_IN;
+}
+
+static void start_control_out_stage(void* buffer,
+                                    uint16_t size,
+                                    USB_Control_Out_Callback_t callback)
+{
+    USB_Request_t const* request = usb_device_handle->ptr_out_buffer;
+
+    /* A device to host request would wait for data the host never sends */
+    if((request->bmRequestType & USB_BM_REQUEST_TYPE_DIRECTION_TOHOST) && (request->wLength != 0)){
+        stall_control_transfer();
+        return;
+    }
+
+    usb_device_handle->ptr_control_out_buffer = buffer;
+    usb_device_handle->control_out_buffer_size = size;
+    usb_device_handle->control_out_received = 0;
+    usb_device_handle->control_out_callback = callback;
+    usb_device_handle->out_data_size = request->wLength;
+
+    if(request->wLength == 0){
+        /* There is no DATA OUT stage, so the request is completed straight away */
+        callback(request, 0);
+        usb_device_handle->control_out_callback = NULL;
+        log_info("Switching control transfer stage to IN-STATUS");
+        usb_device_handle->control_transfer_stage = USB_CONTROL_STAGE_STATUS_IN;
+    }
+    else{
+        log_info("Switching control transfer stage to OUT-DATA");
+        usb_device_handle->control_transfer_stage = USB_CONTROL_STAGE_DATA_OUT;
+    }
+}
+
+static void stall_control_transfer(void)
+{
+    log_info("Stalling the control transfer");
+    USB_driver.USB_Stall_Control_Endpoint();
+    usb_device_handle->control_transfer_stage = USB_CONTROL_STAGE_SETUP;
+}
+
+static void discard_out_data(uint16_t byte_cnt)
+{
+    uint32_t scratch = 0;
+
+    /* Reading up to 4 bytes pops exactly one 32 bit word from the RxFIFO */
+    for(; byte_cnt > 0; byte_cnt -= MIN(byte_cnt, 4)){
+        USB_driver.USB_Read_Packet(&scratch, MIN(byte_cnt, 4));
+    }
 }
 
 static void process_control_transfer_stage(void)
@@ -323,6 +1042,9 @@ static void process_control_transfer_stage(void)
         case USB_CONTROL_STAGE_SETUP:
             /* do nothing */
             break;
+        case USB_CONTROL_STAGE_DATA_OUT:
+            /* do nothing, the data is stored as soon as it is received */
+            break;
         case USB_CONTROL_STAGE_DATA_IN:
             log_info("Processing IN-DATA stage");
             USB_driver.USB_Write_Packet(0, usb_device_handle->ptr_in_buffer, data_size);
@@ -330,7 +1052,8 @@ static void process_control_transfer_stage(void)
             usb_device_handle->ptr_in_buffer += data_size;
 
             if(usb_device_handle->in_data_size == 0){
-                if(data_size == device_descriptor.bMaxPacketSize0){
+                if((data_size == device_descriptor.bMaxPacketSize0) &&
+                   usb_device_handle->in_zero_length_packet){
                     log_info("Switching control stage to IN-DATA ZERO");
                     usb_device_handle->control_transfer_stage = USB_CONTROL_STAGE_DATA_IN_ZERO;
                 }
@@ -348,8 +1071,7 @@ static void process_control_transfer_stage(void)
             /* do nothing */
             break;
         case USB_CONTROL_STAGE_STATUS_OUT:
-            log_info("Switching control stage to SETUP");
-            usb_device_handle->control_transfer_stage = USB_CONTROL_STAGE_SETUP;
+            /* do nothing, the stage ends with the zero length packet sent by the host */
             break;
         case USB_CONTROL_STAGE_STATUS_IN:
             USB_driver.USB_Write_Packet(0, NULL, 0);
@@ -360,19 +1082,4 @@ static void process_control_transfer_stage(void)
             /* do nothing */
             break;
     }
-}
-
-static void write_mouse_report(void)
-{
-    log_debug("Sending USB HID mouse report");
-
-    HID_Report_t hid_report = {
-        .x = 5
-    };
-
-    USB_driver.USB_Write_Packet(
-        (cfg_descriptor_combination.usb_mouse_endpoint_descriptor.bEndpointAddress & 0x0F),
-        &hid_report,
-        sizeof(hid_report)
-    );
 }
\ No newline at end of file
@@ -6,6 +6,14 @@
 * Public Functions:
 *       - void USB_Device_Init(USB_Device_t* usb_device)
 *       - void USB_Device_Poll(void)
+*       - void USB_Control_Send(void const* buffer, uint16_t size)
+*       - void USB_Control_Receive(void* buffer, uint16_t size, USB_Control_Out_Callback_t callback)
+*       - void USB_Control_Acknowledge(void)
+*       - void USB_Device_Set_Mode(USBDeviceMode_t mode)
+*       - uint32_t USB_Device_Get_Wakeup_Latency(void)
+*       - bool USB_Device_Is_Suspended(void)
+*       - bool USB_Device_Remote_Wakeup(void)
+*       - uint32_t USB_Device_Get_Remote_Wakeup_Latency(void)
 */
 
 #ifndef USB_MIDDLEWARE_H
@@ -13,7 +21,9 @@
 
 #include "usb_driver.h"
 #include "usb_device.h"
+#include "usb_device_config.h"
 #include <stdint.h>
+#include <stdbool.h>
 
 /***********************************************************************************************************/
 /*                                       APIs Supported                                                    */
@@ -27,9 +37,75 @@
 void USB_Device_Init(USB_Device_t* usb_device);
 
 /**
- * @brief Function for polling the events of the USB.
+ * @brief Function for polling the events of the USB. While the bus is suspended the device is put in
+ *        low power mode, and this function only returns once the device wakes up.
  * @return void
  */
 void USB_Device_Poll(void);
 
+/**
+ * @brief Function for answering the current control request with a DATA IN stage, it is used by
+ *        the class drivers from its Setup callback.
+ * @param[in] buffer is a pointer to the data to be sent, it must remain valid until it is sent.
+ * @param[in] size is the size of the data in bytes, it is clamped to the wLength of the request.
+ * @return void
+ */
+void USB_Control_Send(void const* buffer, uint16_t size);
+
+/**
+ * @brief Function for answering the current control request with a DATA OUT stage, it is used by
+ *        the class drivers from its Setup callback.
+ * @param[in] buffer is a pointer to the buffer where the received data will be stored.
+ * @param[in] size is the size of the buffer in bytes, received data beyond it is discarded.
+ * @param[in] callback is the function called once the whole DATA OUT stage has been received.
+ * @return void
+ */
+void USB_Control_Receive(void* buffer, uint16_t size, USB_Control_Out_Callback_t callback);
+
+/**
+ * @brief Function for answering the current control request with just the IN STATUS stage, it is
+ *        used by the class drivers from its Setup callback.
+ * @return void
+ */
+void USB_Control_Acknowledge(void);
+
+/**
+ * @brief Function for switching the device to another mode (e.g. from the application to DFU mode).
+ *        The device is disconnected from the bus and connected again presenting the descriptors of
+ *        the new mode, so the host enumerates it again.
+ * @param[in] mode is the new mode of the device.
+ * @return void
+ * @note The switch is done from the next poll of the device, so it can be requested from a class
+ *       driver callback.
+ */
+void USB_Device_Set_Mode(USBDeviceMode_t mode);
+
+/**
+ * @brief Function for getting the wake-up latency of the last resume of the bus.
+ * @return the time in us from the wakeup of the core until the device was resumed, 0 if the device
+ *         did not enter low power mode while suspended.
+ */
+uint32_t USB_Device_Get_Wakeup_Latency(void);
+
+/**
+ * @brief Function for checking whether the bus is suspended, the endpoints can not be used then.
+ * @return true if the device is suspended.
+ */
+bool USB_Device_Is_Suspended(void);
+
+/**
+ * @brief Function for waking the host up because of an application input while the bus is
+ *        suspended. The resume is signaled from the poll once the bus has been idle long enough.
+ * @return true if the remote wakeup is signaled, false if the device is not suspended or the host
+ *         did not enable the remote wakeup.
+ */
+bool USB_Device_Remote_Wakeup(void);
+
+/**
+ * @brief Function for getting the latency of the last remote wakeup.
+ * @return the time in us from the request of the remote wakeup until the first start of frame
+ *         after the host resumed the bus.
+ */
+uint32_t USB_Device_Get_Remote_Wakeup_Latency(void);
+
 #endif /* USB_MIDDLEWARE_H */
\ No newline at end of file
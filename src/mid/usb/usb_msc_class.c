@@ -0,0 +1,651 @@
+/************************************************************************************************//**
+* @file usb_msc_class.c
+*
+* @brief File containing the Mass Storage (Bulk-Only Transport) class driver of the USB device,
+*        backed by a RAM disk.
+*
+* @note
+*       The data stages of READ(10) and WRITE(10) are transferred straight between the RAM disk and
+*       the FIFOs as multi-packet transfers, so the next packet is already in the FIFO when the
+*       previous one is completed.
+**/
+
+#include "usb_msc_class.h"
+#include "usb_middleware.h"
+#include "usb_driver.h"
+#include "usb_device_config.h"
+#include "helper_math.h"
+#include "cycle_counter.h"
+#include "logger.h"
+#include "stm32f4xx.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+/** @brief Number of frames (1 ms each) between two throughput reports */
+#define MSC_REPORT_PERIOD_FRAMES    1000
+
+/***************************************************************************************************/
+/*                                       Static Variables                                          */
+/***************************************************************************************************/
+
+/** @brief Storage of the RAM disk */
+static uint8_t msc_ram_disk[USB_MSC_BLOCK_COUNT*USB_MSC_BLOCK_SIZE] __attribute__((aligned(4)));
+
+/** @brief Buffer for the command block wrapper, it can hold a whole packet */
+static union
+{
+    USB_MSC_CBW_t cbw;
+    uint8_t packet[USB_MSC_PACKET_SIZE];
+}msc_command __attribute__((aligned(4)));
+/** @brief Size of the last packet received as command block wrapper */
+static uint16_t msc_command_size;
+/** @brief Command status wrapper of the current command */
+static USB_MSC_CSW_t msc_status;
+/** @brief Buffer for the data sent by the commands which do not access the RAM disk */
+static uint8_t msc_response[USB_MSC_PACKET_SIZE] __attribute__((aligned(4)));
+
+/** @brief State of the Bulk-Only Transport */
+static USBMSCState_t msc_state;
+/** @brief Next byte to be transferred in the data stage */
+static uint8_t* msc_data;
+/** @brief Bytes of the data stage not queued to the endpoint yet */
+static uint32_t msc_data_remaining;
+
+/** @brief Sense key reported by the next REQUEST SENSE */
+static uint8_t msc_sense_key;
+/** @brief Additional sense code reported by the next REQUEST SENSE */
+static uint8_t msc_sense_code;
+
+/** @brief Cycle counter value when the current READ(10) or WRITE(10) was received */
+static uint32_t msc_command_start;
+/** @brief Operation code of the current command */
+static uint8_t msc_command_opcode;
+/** @brief Bytes read by READ(10) commands during the current report period */
+static uint32_t msc_read_bytes;
+/** @brief Cycles spent in READ(10) commands during the current report period */
+static uint32_t msc_read_cycles;
+/** @brief Bytes written by WRITE(10) commands during the current report period */
+static uint32_t msc_write_bytes;
+/** @brief Cycles spent in WRITE(10) commands during the current report period */
+static uint32_t msc_write_cycles;
+/** @brief Frames elapsed in the current report period */
+static uint16_t msc_report_frames;
+
+/***************************************************************************************************/
+/*                                       Static Function Prototypes                                */
+/***************************************************************************************************/
+
+/**
+ * @brief Function for configuring the endpoints of the MSC interface.
+ * @return void
+ */
+static void msc_init(void);
+
+/**
+ * @brief Function for processing a request addressed to the MSC interface or its endpoints.
+ * @param[in] request is a pointer to the received request.
+ * @return true if the request is supported, false otherwise.
+ */
+static bool msc_setup(USB_Request_t const* request);
+
+/**
+ * @brief Function for managing a completed IN transfer of the MSC endpoint.
+ * @param[in] endpoint_number is the endpoint number for the IN transfer.
+ * @return void
+ */
+static void msc_data_in(uint8_t endpoint_number);
+
+/**
+ * @brief Function for popping a packet received on the MSC OUT endpoint.
+ * @param[in] endpoint_number is the endpoint number which received the packet.
+ * @param[in] byte_cnt is the size of the received packet in bytes.
+ * @return void
+ */
+static void msc_data_out(uint8_t endpoint_number, uint16_t byte_cnt);
+
+/**
+ * @brief Function for managing a completed OUT transfer of the MSC endpoint.
+ * @param[in] endpoint_number is the endpoint number for the OUT transfer.
+ * @return void
+ */
+static void msc_data_out_completed(uint8_t endpoint_number);
+
+/**
+ * @brief Function for reporting the throughput of READ(10) and WRITE(10) once per period.
+ * @return void
+ */
+static void msc_sof(void);
+
+/**
+ * @brief Function for validating a received command block wrapper and executing its command.
+ * @return void
+ */
+static void process_command_block(void);
+
+/**
+ * @brief Function for executing the SCSI command of the command block wrapper.
+ * @param[in] cb is a pointer to the SCSI command block.
+ * @return void
+ */
+static void process_scsi_command(uint8_t const* cb);
+
+/**
+ * @brief Function for executing the READ(10) and WRITE(10) commands.
+ * @param[in] cb is a pointer to the SCSI command block.
+ * @return void
+ */
+static void process_scsi_read_write(uint8_t const* cb);
+
+/**
+ * @brief Function for starting the DATA IN stage of the current command.
+ * @param[in] data is a pointer to the data to be sent, it must remain valid until it is sent.
+ * @param[in] size is the size of the data, if it is bigger than the length expected by the host
+ * only that length is sent and the command ends with a phase error.
+ * @return void
+ */
+static void start_data_in_stage(void* data, uint32_t size);
+
+/**
+ * @brief Function for starting the DATA OUT stage of the current command.
+ * @param[in] data is a pointer to the buffer where the received data will be stored.
+ * @param[in] size is the size of the data.
+ * @return void
+ */
+static void start_data_out_stage(void* data, uint32_t size);
+
+/**
+ * @brief Function for finishing a command without DATA stage (or after failing it).
+ * @param[in] status is the status reported in the command status wrapper.
+ * @return void
+ */
+static void finish_command(uint8_t status);
+
+/**
+ * @brief Function for failing the current command and storing the sense data for the host.
+ * @param[in] sense_key is the sense key reported by the next REQUEST SENSE.
+ * @param[in] sense_code is the additional sense code reported by the next REQUEST SENSE.
+ * @return void
+ */
+static void fail_command(uint8_t sense_key, uint8_t sense_code);
+
+/**
+ * @brief Function for sending the command status wrapper of the current command.
+ * @return void
+ */
+static void send_command_status(void);
+
+/**
+ * @brief Function for enabling the OUT endpoint for receiving the next command block wrapper.
+ * @return void
+ */
+static void wait_command_block(void);
+
+/**
+ * @brief Function for reading a big endian 16 bit field of a SCSI command block.
+ * @param[in] data is a pointer to the first byte of the field.
+ * @return the value of the field.
+ */
+static inline __attribute__((always_inline)) uint16_t read_be16(uint8_t const* data);
+
+/**
+ * @brief Function for reading a big endian 32 bit field of a SCSI command block.
+ * @param[in] data is a pointer to the first byte of the field.
+ * @return the value of the field.
+ */
+static inline __attribute__((always_inline)) uint32_t read_be32(uint8_t const* data);
+
+/**
+ * @brief Function for writing a big endian 32 bit field of a SCSI response.
+ * @param[in] data is a pointer to the first byte of the field.
+ * @param[in] value is the value of the field.
+ * @return void
+ */
+static inline __attribute__((always_inline)) void write_be32(uint8_t* data, uint32_t value);
+
+/***************************************************************************************************/
+/*                                       Global Variables                                          */
+/***************************************************************************************************/
+
+/**
+ * @brief Structure with the callbacks of the MSC class driver.
+ * @showinitializer
+ */
+const USB_Class_Driver_t USB_MSC_class = {
+    .Init = &msc_init,
+    .Deinit = NULL,
+    .Reset = NULL,
+    .Setup = &msc_setup,
+    .Data_In = &msc_data_in,
+    .Data_Out = &msc_data_out,
+    .Data_Out_Completed = &msc_data_out_completed,
+    .SOF = &msc_sof,
+    .Poll = NULL
+};
+
+/***************************************************************************************************/
+/*                                       Static Function Definitions                               */
+/***************************************************************************************************/
+
+static void msc_init(void)
+{
+    USB_driver.USB_Configure_IN_Endpoint(
+        USB_ENDPOINT_NUMBER(USB_MSC_IN_ENDPOINT),
+        USB_ENDPOINT_TYPE_BULK,
+        USB_MSC_PACKET_SIZE
+    );
+    USB_driver.USB_Configure_OUT_Endpoint(
+        USB_ENDPOINT_NUMBER(USB_MSC_OUT_ENDPOINT),
+        USB_ENDPOINT_TYPE_BULK,
+        USB_MSC_PACKET_SIZE
+    );
+
+    /* The cycle counter measures the throughput of the data stages */
+    Cycle_Counter_Init();
+
+    msc_sense_key = USB_SCSI_SENSE_NONE;
+    msc_sense_code = USB_SCSI_ASC_NONE;
+    wait_command_block();
+}
+
+static bool msc_setup(USB_Request_t const* request)
+{
+    static uint8_t const max_lun = 0;
+
+    if((request->bmRequestType & USB_BM_REQUEST_TYPE_TYPE_MASK) ==
+       USB_BM_REQUEST_TYPE_TYPE_STANDARD){
+        if((request->bRequest != USB_STANDARD_CLEAR_FEATURE) ||
+           (request->wValue != USB_FEATURE_ENDPOINT_HALT)){
+            return false;
+        }
+        /* After an invalid command the endpoints stay halted until the reset recovery */
+        if(msc_state != USB_MSC_STATE_RESET_RECOVERY){
+            USB_driver.USB_Clear_Endpoint_Stall(request->wIndex & 0xFF);
+            if(((request->wIndex & 0xFF) == USB_MSC_IN_ENDPOINT) &&
+               (msc_state == USB_MSC_STATE_STATUS_PENDING)){
+                send_command_status();
+            }
+        }
+        USB_Control_Acknowledge();
+        return true;
+    }
+
+    if((request->bmRequestType & USB_BM_REQUEST_TYPE_TYPE_MASK) != USB_BM_REQUEST_TYPE_TYPE_CLASS){
+        return false;
+    }
+
+    switch(request->bRequest){
+        case USB_MSC_GET_MAX_LUN:
+            USB_Control_Send(&max_lun, sizeof(max_lun));
+            return true;
+        case USB_MSC_BOT_RESET:
+            log_info("MSC Bulk-Only reset request received");
+            /* The halt of the endpoints is kept, the host clears it after the reset */
+            USB_driver.USB_Flush_TxFIFO(USB_ENDPOINT_NUMBER(USB_MSC_IN_ENDPOINT));
+            wait_command_block();
+            USB_Control_Acknowledge();
+            return true;
+        default:
+            return false;
+    }
+}
+
+static void msc_data_in(__attribute__((unused))uint8_t endpoint_number)
+{
+    uint32_t size = 0;
+
+    switch(msc_state){
+        case USB_MSC_STATE_DATA_IN:
+            if(msc_data_remaining > 0){
+                size = MIN(msc_data_remaining, USB_MSC_MAX_TRANSFER_SIZE);
+                USB_driver.USB_Write_Transfer(USB_ENDPOINT_NUMBER(USB_MSC_IN_ENDPOINT),
+                                              msc_data,
+                                              size);
+                msc_data += size;
+                msc_data_remaining -= size;
+            }
+            else if(msc_status.dCSWDataResidue > 0){
+                /* The host expects more data than the command has, the IN endpoint is halted and
+                   the status is sent once the host clears the halt */
+                USB_driver.USB_Stall_Endpoint(USB_MSC_IN_ENDPOINT);
+                msc_state = USB_MSC_STATE_STATUS_PENDING;
+            }
+            else{
+                send_command_status();
+            }
+            break;
+        case USB_MSC_STATE_STATUS:
+            size = msc_command.cbw.dCBWDataTransferLength - msc_status.dCSWDataResidue;
+            if(msc_command_opcode == USB_SCSI_READ_10){
+                msc_read_bytes += size;
+                msc_read_cycles += Cycle_Counter_Get() - msc_command_start;
+            }
+            else if(msc_command_opcode == USB_SCSI_WRITE_10){
+                msc_write_bytes += size;
+                msc_write_cycles += Cycle_Counter_Get() - msc_command_start;
+            }
+            wait_command_block();
+            break;
+        default:
+            /* do nothing */
+            break;
+    }
+}
+
+static void msc_data_out(__attribute__((unused))uint8_t endpoint_number, uint16_t byte_cnt)
+{
+    if(msc_state == USB_MSC_STATE_DATA_OUT){
+        /* The endpoint is enabled for the size of the data stage, so the packet always fits */
+        USB_driver.USB_Read_Packet(msc_data, byte_cnt);
+        msc_data += byte_cnt;
+    }
+    else{
+        /* A command block wrapper is never bigger than a packet */
+        USB_driver.USB_Read_Packet(msc_command.packet, byte_cnt);
+        msc_command_size = byte_cnt;
+    }
+}
+
+static void msc_data_out_completed(__attribute__((unused))uint8_t endpoint_number)
+{
+    uint32_t size = 0;
+
+    switch(msc_state){
+        case USB_MSC_STATE_COMMAND:
+            process_command_block();
+            break;
+        case USB_MSC_STATE_DATA_OUT:
+            if(msc_data_remaining > 0){
+                size = MIN(msc_data_remaining, USB_MSC_MAX_TRANSFER_SIZE);
+                USB_driver.USB_Enable_OUT_Endpoint(USB_ENDPOINT_NUMBER(USB_MSC_OUT_ENDPOINT),
+                                                   size);
+                msc_data_remaining -= size;
+            }
+            else{
+                if(msc_status.dCSWDataResidue > 0){
+                    /* The host has more data than the command expects */
+                    USB_driver.USB_Stall_Endpoint(USB_MSC_OUT_ENDPOINT);
+                }
+                send_command_status();
+            }
+            break;
+        default:
+            /* do nothing */
+            break;
+    }
+}
+
+static void msc_sof(void)
+{
+    uint64_t read_rate = 0;
+    uint64_t write_rate = 0;
+
+    if(++msc_report_frames < MSC_REPORT_PERIOD_FRAMES){
+        return;
+    }
+    msc_report_frames = 0;
+
+    if((msc_read_cycles == 0) && (msc_write_cycles == 0)){
+        return;
+    }
+
+    /* Rates in bytes per second while the commands were being executed */
+    if(msc_read_cycles > 0){
+        read_rate = ((uint64_t)msc_read_bytes*SystemCoreClock)/msc_read_cycles;
+    }
+    if(msc_write_cycles > 0){
+        write_rate = ((uint64_t)msc_write_bytes*SystemCoreClock)/msc_write_cycles;
+    }
+    log_info("MSC READ(10) %lu.%02lu MB/s, WRITE(10) %lu.%02lu MB/s",
+             (unsigned long)(read_rate/1000000), (unsigned long)((read_rate/10000) % 100),
+             (unsigned long)(write_rate/1000000), (unsigned long)((write_rate/10000) % 100));
+
+    msc_read_bytes = 0;
+    msc_read_cycles = 0;
+    msc_write_bytes = 0;
+    msc_write_cycles = 0;
+}
+
+static void process_command_block(void)
+{
+    USB_MSC_CBW_t const* cbw = &msc_command.cbw;
+
+    if((msc_command_size != sizeof(USB_MSC_CBW_t)) ||
+       (cbw->dCBWSignature != USB_MSC_CBW_SIGNATURE)){
+        log_error("Invalid MSC command block wrapper received");
+        USB_driver.USB_Stall_Endpoint(USB_MSC_IN_ENDPOINT);
+        USB_driver.USB_Stall_Endpoint(USB_MSC_OUT_ENDPOINT);
+        msc_state = USB_MSC_STATE_RESET_RECOVERY;
+        return;
+    }
+
+    msc_status.dCSWSignature = USB_MSC_CSW_SIGNATURE;
+    msc_status.dCSWTag = cbw->dCBWTag;
+    msc_status.dCSWDataResidue = cbw->dCBWDataTransferLength;
+    msc_status.bCSWStatus = USB_MSC_CSW_STATUS_PASSED;
+    msc_command_opcode = cbw->CBWCB[0];
+
+    if((cbw->bCBWLUN != 0) || (cbw->bCBWCBLength == 0) || (cbw->bCBWCBLength > 16)){
+        fail_command(USB_SCSI_SENSE_ILLEGAL_REQUEST, USB_SCSI_ASC_INVALID_FIELD_IN_CDB);
+        return;
+    }
+
+    process_scsi_command(cbw->CBWCB);
+}
+
+static void process_scsi_command(uint8_t const* cb)
+{
+    USB_SCSI_InquiryData_t* inquiry = (USB_SCSI_InquiryData_t*)msc_response;
+    USB_SCSI_SenseData_t* sense = (USB_SCSI_SenseData_t*)msc_response;
+
+    memset(msc_response, 0, sizeof(msc_response));
+
+    switch(cb[0]){
+        case USB_SCSI_TEST_UNIT_READY:
+        case USB_SCSI_START_STOP_UNIT:
+        case USB_SCSI_PREVENT_ALLOW_REMOVAL:
+        case USB_SCSI_VERIFY_10:
+        case USB_SCSI_SYNCHRONIZE_CACHE_10:
+            finish_command(USB_MSC_CSW_STATUS_PASSED);
+            break;
+        case USB_SCSI_REQUEST_SENSE:
+            sense->response_code = 0x70;    /* Current errors, fixed format */
+            sense->sense_key = msc_sense_key;
+            sense->additional_length = sizeof(USB_SCSI_SenseData_t) - 8;
+            sense->additional_sense_code = msc_sense_code;
+            msc_sense_key = USB_SCSI_SENSE_NONE;
+            msc_sense_code = USB_SCSI_ASC_NONE;
+            start_data_in_stage(msc_response, MIN(cb[4], sizeof(USB_SCSI_SenseData_t)));
+            break;
+        case USB_SCSI_INQUIRY:
+            /* The vital product data pages are not supported */
+            if(cb[1] & 0x01){
+                fail_command(USB_SCSI_SENSE_ILLEGAL_REQUEST, USB_SCSI_ASC_INVALID_FIELD_IN_CDB);
+                break;
+            }
+            inquiry->peripheral = 0x00;     /* Direct access block device */
+            inquiry->removable = 0x80;
+            inquiry->version = 0x04;        /* SPC-2 */
+            inquiry->response_data_format = 0x02;
+            inquiry->additional_length = sizeof(USB_SCSI_InquiryData_t) - 5;
+            memcpy(inquiry->vendor_id, "maherme ", sizeof(inquiry->vendor_id));
+            memcpy(inquiry->product_id, "RAM Disk        ", sizeof(inquiry->product_id));
+            memcpy(inquiry->product_revision, "1.00", sizeof(inquiry->product_revision));
+            start_data_in_stage(msc_response,
+                                MIN(read_be16(&cb[3]), sizeof(USB_SCSI_InquiryData_t)));
+            break;
+        case USB_SCSI_MODE_SENSE_6:
+            /* Only the header: no block descriptors, no pages and not write protected */
+            msc_response[0] = 3;
+            start_data_in_stage(msc_response, MIN(cb[4], 4));
+            break;
+        case USB_SCSI_READ_FORMAT_CAPACITIES:
+            /* Capacity list header followed by the current capacity descriptor */
+            msc_response[3] = 8;
+            write_be32(&msc_response[4], USB_MSC_BLOCK_COUNT);
+            write_be32(&msc_response[8], USB_MSC_BLOCK_SIZE);
+            msc_response[8] = 0x02;         /* Formatted media */
+            start_data_in_stage(msc_response, MIN(read_be16(&cb[7]), 12));
+            break;
+        case USB_SCSI_READ_CAPACITY_10:
+            write_be32(&msc_response[0], USB_MSC_BLOCK_COUNT - 1);
+            write_be32(&msc_response[4], USB_MSC_BLOCK_SIZE);
+            start_data_in_stage(msc_response, 8);
+            break;
+        case USB_SCSI_READ_10:
+        case USB_SCSI_WRITE_10:
+            process_scsi_read_write(cb);
+            break;
+        default:
+            log_info("SCSI command 0x%02X not supported", cb[0]);
+            fail_command(USB_SCSI_SENSE_ILLEGAL_REQUEST, USB_SCSI_ASC_INVALID_COMMAND);
+            break;
+    }
+}
+
+static void process_scsi_read_write(uint8_t const* cb)
+{
+    uint32_t block_address = read_be32(&cb[2]);
+    uint32_t block_count = read_be16(&cb[7]);
+    uint32_t size = block_count*USB_MSC_BLOCK_SIZE;
+
+    if((block_address > USB_MSC_BLOCK_COUNT) ||
+       (block_count > (USB_MSC_BLOCK_COUNT - block_address))){
+        fail_command(USB_SCSI_SENSE_ILLEGAL_REQUEST, USB_SCSI_ASC_LBA_OUT_OF_RANGE);
+        return;
+    }
+
+    msc_command_start = Cycle_Counter_Get();
+
+    if(cb[0] == USB_SCSI_READ_10){
+        start_data_in_stage(&msc_ram_disk[block_address*USB_MSC_BLOCK_SIZE], size);
+    }
+    else{
+        start_data_out_stage(&msc_ram_disk[block_address*USB_MSC_BLOCK_SIZE], size);
+    }
+}
+
+static void start_data_in_stage(void* data, uint32_t size)
+{
+    USB_MSC_CBW_t const* cbw = &msc_command.cbw;
+
+    /* When the host expects no data, it is a phase error only if the command has data */
+    if(cbw->dCBWDataTransferLength == 0){
+        finish_command((size == 0) ? USB_MSC_CSW_STATUS_PASSED : USB_MSC_CSW_STATUS_PHASE_ERROR);
+        return;
+    }
+
+    /* The host must expect data sent to it, otherwise it is a phase error */
+    if(!(cbw->bmCBWFlags & USB_MSC_CBW_DIRECTION_IN)){
+        finish_command(USB_MSC_CSW_STATUS_PHASE_ERROR);
+        return;
+    }
+
+    /* The host expects less data than the command has, it gets what it expects and a phase error */
+    if(cbw->dCBWDataTransferLength < size){
+        size = cbw->dCBWDataTransferLength;
+        msc_status.bCSWStatus = USB_MSC_CSW_STATUS_PHASE_ERROR;
+    }
+
+    msc_status.dCSWDataResidue = cbw->dCBWDataTransferLength - size;
+    msc_data = data;
+    msc_data_remaining = size;
+    msc_state = USB_MSC_STATE_DATA_IN;
+
+    /* The first chunk is queued here, the rest (and the status) from the IN completed event */
+    msc_data_in(USB_ENDPOINT_NUMBER(USB_MSC_IN_ENDPOINT));
+}
+
+static void start_data_out_stage(void* data, uint32_t size)
+{
+    USB_MSC_CBW_t const* cbw = &msc_command.cbw;
+
+    /* When the host sends no data, it is a phase error only if the command has data */
+    if(cbw->dCBWDataTransferLength == 0){
+        finish_command((size == 0) ? USB_MSC_CSW_STATUS_PASSED : USB_MSC_CSW_STATUS_PHASE_ERROR);
+        return;
+    }
+
+    /* The host must send the whole data of the command, otherwise it is a phase error */
+    if((cbw->bmCBWFlags & USB_MSC_CBW_DIRECTION_IN) || (cbw->dCBWDataTransferLength < size)){
+        finish_command(USB_MSC_CSW_STATUS_PHASE_ERROR);
+        return;
+    }
+
+    msc_status.dCSWDataResidue = cbw->dCBWDataTransferLength - size;
+    msc_data = data;
+    msc_data_remaining = size;
+    msc_state = USB_MSC_STATE_DATA_OUT;
+
+    /* The first chunk is enabled here, the rest (and the status) from the OUT completed event */
+    msc_data_out_completed(USB_ENDPOINT_NUMBER(USB_MSC_OUT_ENDPOINT));
+}
+
+static void finish_command(uint8_t status)
+{
+    USB_MSC_CBW_t const* cbw = &msc_command.cbw;
+
+    msc_status.bCSWStatus = status;
+    msc_command_opcode = 0;
+
+    if(cbw->dCBWDataTransferLength == 0){
+        send_command_status();
+    }
+    else if(cbw->bmCBWFlags & USB_MSC_CBW_DIRECTION_IN){
+        /* The host expects data, the IN endpoint is halted and the status is sent once the host
+           clears the halt */
+        USB_driver.USB_Stall_Endpoint(USB_MSC_IN_ENDPOINT);
+        msc_state = USB_MSC_STATE_STATUS_PENDING;
+    }
+    else{
+        /* The host has data for the command, the OUT endpoint is halted */
+        USB_driver.USB_Stall_Endpoint(USB_MSC_OUT_ENDPOINT);
+        send_command_status();
+    }
+}
+
+static void fail_command(uint8_t sense_key, uint8_t sense_code)
+{
+    msc_sense_key = sense_key;
+    msc_sense_code = sense_code;
+    finish_command(USB_MSC_CSW_STATUS_FAILED);
+}
+
+static void send_command_status(void)
+{
+    msc_state = USB_MSC_STATE_STATUS;
+    USB_driver.USB_Write_Packet(
+        USB_ENDPOINT_NUMBER(USB_MSC_IN_ENDPOINT),
+        &msc_status,
+        sizeof(msc_status)
+    );
+}
+
+static void wait_command_block(void)
+{
+    msc_state = USB_MSC_STATE_COMMAND;
+    msc_command_size = 0;
+    USB_driver.USB_Enable_OUT_Endpoint(
+        USB_ENDPOINT_NUMBER(USB_MSC_OUT_ENDPOINT),
+        sizeof(USB_MSC_CBW_t)
+    );
+}
+
+static inline __attribute__((always_inline)) uint16_t read_be16(uint8_t const* data)
+{
+    return (data[0] << 8) | data[1];
+}
+
+static inline __attribute__((always_inline)) uint32_t read_be32(uint8_t const* data)
+{
+    return ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) | (data[2] << 8) | data[3];
+}
+
+static inline __attribute__((always_inline)) void write_be32(uint8_t* data, uint32_t value)
+{
+    data[0] = value >> 24;
+    data[1] = value >> 16;
+    data[2] = value >> 8;
+    data[3] = value;
+}
@@ -0,0 +1,41 @@
+/************************************************************************************************//**
+* @file usb_msc_class.h
+*
+* @brief Header file containing the Mass Storage (Bulk-Only Transport) class driver of the USB
+*        device, backed by a RAM disk.
+*/
+
+#ifndef USB_MSC_CLASS_H
+#define USB_MSC_CLASS_H
+
+#include "usb_class.h"
+#include "usb_msc_standards.h"
+#include <stdint.h>
+
+/** @brief Size of the blocks of the RAM disk in bytes */
+#define USB_MSC_BLOCK_SIZE          512
+/** @brief Number of blocks of the RAM disk */
+#define USB_MSC_BLOCK_COUNT         128
+/** @brief Maximum size of the data queued to the endpoints at once (up to 1023 packets) */
+#define USB_MSC_MAX_TRANSFER_SIZE   32768
+
+/**
+ * @brief List of the states of the Bulk-Only Transport.
+ */
+typedef enum
+{
+    USB_MSC_STATE_COMMAND,          /**< @brief Waiting for a command block wrapper */
+    USB_MSC_STATE_DATA_IN,          /**< @brief Sending the data of a command */
+    USB_MSC_STATE_DATA_OUT,         /**< @brief Receiving the data of a command */
+    USB_MSC_STATE_STATUS,           /**< @brief Sending the command status wrapper */
+    USB_MSC_STATE_STATUS_PENDING,   /**< @brief Waiting for the host to clear the IN halt */
+    USB_MSC_STATE_RESET_RECOVERY    /**< @brief Invalid command, waiting for a reset recovery */
+}USBMSCState_t;
+
+/***************************************************************************************************/
+/*                                       Exported Variables                                        */
+/***************************************************************************************************/
+
+extern const USB_Class_Driver_t USB_MSC_class;
+
+#endif /* USB_MSC_CLASS_H */
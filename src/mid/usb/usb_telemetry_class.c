@@ -0,0 +1,301 @@
+/************************************************************************************************//**
+* @file usb_telemetry_class.c
+*
+* @brief File containing the vendor specific telemetry class driver of the USB device.
+*
+* Public Functions:
+*       - bool USB_Telemetry_Write(void const* record, uint8_t size)
+*       - void USB_Telemetry_Flush(void)
+*
+* @note
+*       For further information about functions refer to the corresponding header file.
+**/
+
+#include "usb_telemetry_class.h"
+#include "usb_driver.h"
+#include "usb_device_config.h"
+#include "ring_buffer.h"
+#include "helper_math.h"
+#include "helper_sections.h"
+#include "logger.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+_Static_assert((USB_TELEMETRY_BUFFER_SIZE & (USB_TELEMETRY_BUFFER_SIZE - 1)) == 0,
+               "The size of the telemetry buffer must be a power of two");
+_Static_assert(USB_TELEMETRY_FLUSH_THRESHOLD >= USB_TELEMETRY_PACKET_SIZE,
+               "The telemetry flush threshold must hold at least one packet");
+_Static_assert(USB_TELEMETRY_FLUSH_THRESHOLD <= USB_TELEMETRY_BUFFER_SIZE,
+               "The telemetry flush threshold must fit in the buffer");
+
+/** @brief Period of the telemetry statistics in frames (ms) */
+#define TELEMETRY_REPORT_PERIOD_FRAMES  1000
+
+/***************************************************************************************************/
+/*                                       Static Variables                                          */
+/***************************************************************************************************/
+
+/** @brief Storage of the ring buffer for the framed records */
+static uint8_t telemetry_storage[USB_TELEMETRY_BUFFER_SIZE] __attribute__((aligned(4))) CCM_BSS;
+/** @brief Ring buffer for the framed records */
+static Ring_Buffer_t telemetry_ring CCM_DATA = {telemetry_storage, USB_TELEMETRY_BUFFER_SIZE, 0, 0};
+
+/** @brief Flag indicating the endpoint of the telemetry interface is configured */
+static bool telemetry_configured;
+/** @brief Flag indicating a transfer is being sent on the IN endpoint */
+static bool telemetry_in_busy;
+/** @brief Amount of bytes of the ring buffer being sent in the current transfer */
+static uint32_t telemetry_in_flight_size;
+/** @brief Packet sent instead of the ring buffer when the packet straddles the end of the storage */
+static uint8_t telemetry_bounce_packet[USB_TELEMETRY_PACKET_SIZE] __attribute__((aligned(4)));
+/** @brief Sequence number of the next record */
+static uint8_t telemetry_sequence;
+/** @brief Number of frames received since the configuration */
+static uint32_t telemetry_frame;
+/**
+ * @brief Flag indicating there are records not delivered to the host yet. They are either pending
+ *        in the ring buffer or sent in full packets, which do not complete the read of the host.
+ */
+static bool telemetry_batch_open;
+/** @brief Frame in which the oldest record not delivered to the host was written */
+static uint32_t telemetry_batch_start;
+/** @brief Flag indicating the open batch is sent regardless of the threshold and ends short */
+static bool telemetry_flushing;
+
+/** @brief Number of frames since the statistics were logged */
+static uint16_t telemetry_report_frames;
+/** @brief Number of records queued since the statistics were logged */
+static uint32_t telemetry_records;
+/** @brief Number of payload bytes queued since the statistics were logged */
+static uint32_t telemetry_payload_bytes;
+/** @brief Number of bulk packets sent since the statistics were logged */
+static uint32_t telemetry_packets;
+/** @brief Number of records dropped since the statistics were logged */
+static uint32_t telemetry_dropped;
+
+/***************************************************************************************************/
+/*                                       Static Function Prototypes                                */
+/***************************************************************************************************/
+
+/**
+ * @brief Function for configuring the endpoint of the telemetry interface.
+ * @return void
+ */
+static void telemetry_init(void);
+
+/**
+ * @brief Function for releasing the telemetry interface when the configuration is lost.
+ * @return void
+ */
+static void telemetry_deinit(void);
+
+/**
+ * @brief Function for managing a completed transfer of the IN endpoint.
+ * @param[in] endpoint_number is the endpoint number for the IN transfer.
+ * @return void
+ */
+static void telemetry_data_in(uint8_t endpoint_number);
+
+/**
+ * @brief Function for checking the deadline of the open batch and logging the statistics, it is
+ *        called once per frame.
+ * @return void
+ */
+static void telemetry_sof(void);
+
+/**
+ * @brief Function for copying data into the ring buffer, wrapping around the end of the storage.
+ * @param[in] data is a pointer to the data to be copied.
+ * @param[in] size is the size of the data in bytes, the ring buffer must have room for it.
+ * @return void
+ */
+static void telemetry_copy_to_ring(void const* data, uint32_t size);
+
+/**
+ * @brief Function for queueing the next transfer of the ring buffer, if the IN endpoint is idle
+ *        and either the threshold has been reached or the batch is being flushed.
+ * @return void
+ */
+static void telemetry_start_in_transfer(void);
+
+/***************************************************************************************************/
+/*                                       Global Variables                                          */
+/***************************************************************************************************/
+
+/**
+ * @brief Structure with the callbacks of the telemetry class driver.
+ * @showinitializer
+ */
+const USB_Class_Driver_t USB_Telemetry_class = {
+    .Init = &telemetry_init,
+    .Deinit = &telemetry_deinit,
+    .Reset = NULL,
+    .Setup = NULL,
+    .Data_In = &telemetry_data_in,
+    .Data_Out = NULL,
+    .Data_Out_Completed = NULL,
+    .SOF = &telemetry_sof,
+    .Poll = NULL
+};
+
+/***************************************************************************************************/
+/*                                       Public API Definitions                                    */
+/***************************************************************************************************/
+
+bool USB_Telemetry_Write(void const* record, uint8_t size)
+{
+    uint8_t header[USB_TELEMETRY_RECORD_HEADER_SIZE] = {size, telemetry_sequence++};
+
+    /* The sequence number is consumed anyway, so the host sees the gap */
+    if(!telemetry_configured ||
+       (Ring_Buffer_Free(&telemetry_ring) < (USB_TELEMETRY_RECORD_HEADER_SIZE + size))){
+        telemetry_dropped++;
+        return false;
+    }
+
+    telemetry_copy_to_ring(header, sizeof(header));
+    telemetry_copy_to_ring(record, size);
+    telemetry_records++;
+    telemetry_payload_bytes += size;
+
+    if(!telemetry_batch_open){
+        telemetry_batch_open = true;
+        telemetry_batch_start = telemetry_frame;
+    }
+
+    telemetry_start_in_transfer();
+    return true;
+}
+
+void USB_Telemetry_Flush(void)
+{
+    if(telemetry_batch_open){
+        telemetry_flushing = true;
+        telemetry_start_in_transfer();
+    }
+}
+
+/***************************************************************************************************/
+/*                                       Static Function Definitions                               */
+/***************************************************************************************************/
+
+static void telemetry_init(void)
+{
+    USB_driver.USB_Configure_IN_Endpoint(
+        USB_ENDPOINT_NUMBER(USB_TELEMETRY_IN_ENDPOINT),
+        USB_ENDPOINT_TYPE_BULK,
+        USB_TELEMETRY_PACKET_SIZE
+    );
+
+    telemetry_configured = true;
+    telemetry_in_busy = false;
+    telemetry_sequence = 0;
+    telemetry_frame = 0;
+    telemetry_batch_open = false;
+    telemetry_flushing = false;
+}
+
+static void telemetry_deinit(void)
+{
+    telemetry_configured = false;
+    Ring_Buffer_Reset(&telemetry_ring);
+}
+
+static void telemetry_data_in(__attribute__((unused))uint8_t endpoint_number)
+{
+    Ring_Buffer_Read_Release(&telemetry_ring, telemetry_in_flight_size);
+    telemetry_in_busy = false;
+    telemetry_start_in_transfer();
+}
+
+static void telemetry_sof(void)
+{
+    telemetry_frame++;
+
+    if(telemetry_batch_open && !telemetry_flushing &&
+       ((telemetry_frame - telemetry_batch_start) >= USB_TELEMETRY_FLUSH_DEADLINE)){
+        telemetry_flushing = true;
+        telemetry_start_in_transfer();
+    }
+
+    if(++telemetry_report_frames < TELEMETRY_REPORT_PERIOD_FRAMES){
+        return;
+    }
+    telemetry_report_frames = 0;
+
+    if((telemetry_records == 0) && (telemetry_dropped == 0)){
+        return;
+    }
+
+    log_info("Telemetry %lu records/s, %lu payload bytes/s, %lu packets/s, %lu dropped",
+             (unsigned long)telemetry_records, (unsigned long)telemetry_payload_bytes,
+             (unsigned long)telemetry_packets, (unsigned long)telemetry_dropped);
+
+    telemetry_records = 0;
+    telemetry_payload_bytes = 0;
+    telemetry_packets = 0;
+    telemetry_dropped = 0;
+}
+
+static void telemetry_copy_to_ring(void const* data, uint32_t size)
+{
+    uint8_t const* source = data;
+    uint8_t* destination;
+    uint32_t chunk;
+
+    while(size > 0){
+        chunk = MIN(Ring_Buffer_Write_Acquire(&telemetry_ring, &destination), size);
+        memcpy(destination, source, chunk);
+        Ring_Buffer_Write_Commit(&telemetry_ring, chunk);
+        source += chunk;
+        size -= chunk;
+    }
+}
+
+static void telemetry_start_in_transfer(void)
+{
+    uint8_t const* data;
+    uint32_t pending, size;
+
+    if(!telemetry_configured || telemetry_in_busy || !telemetry_batch_open){
+        return;
+    }
+
+    pending = Ring_Buffer_Count(&telemetry_ring);
+    if(!telemetry_flushing && (pending < USB_TELEMETRY_FLUSH_THRESHOLD)){
+        return;
+    }
+
+    size = MIN(Ring_Buffer_Read_Acquire(&telemetry_ring, &data), USB_TELEMETRY_MAX_TRANSFER_SIZE);
+
+    /* A short packet completes the read of the host, so only the last transfer of a flush may end
+       with one. The data up to the end of the storage is sent in full packets and the packet
+       straddling it is copied into the bounce packet. Below the deadline the remainder waits for
+       more records. */
+    if((size < pending) && (size < USB_TELEMETRY_PACKET_SIZE)){
+        memcpy(telemetry_bounce_packet, data, size);
+        memcpy(&telemetry_bounce_packet[size], telemetry_storage,
+               MIN(pending, USB_TELEMETRY_PACKET_SIZE) - size);
+        data = telemetry_bounce_packet;
+        size = MIN(pending, USB_TELEMETRY_PACKET_SIZE);
+    }
+    else if((size < pending) || !telemetry_flushing){
+        size -= size % USB_TELEMETRY_PACKET_SIZE;
+    }
+
+    /* The read of the host only completes with a short packet, so the batch is delivered when its
+       last transfer ends with one. A flush ending with a full packet is followed by a zero length
+       packet, which is sent when nothing is pending. */
+    if((size == pending) && ((size % USB_TELEMETRY_PACKET_SIZE) != 0 || (size == 0))){
+        telemetry_batch_open = false;
+        telemetry_flushing = false;
+    }
+
+    telemetry_in_busy = true;
+    telemetry_in_flight_size = size;
+    telemetry_packets += (size == 0) ? 1 :
+                         (size + USB_TELEMETRY_PACKET_SIZE - 1)/USB_TELEMETRY_PACKET_SIZE;
+    USB_driver.USB_Write_Transfer(USB_ENDPOINT_NUMBER(USB_TELEMETRY_IN_ENDPOINT), data, size);
+}
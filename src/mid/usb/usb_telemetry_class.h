@@ -0,0 +1,62 @@
+/************************************************************************************************//**
+* @file usb_telemetry_class.h
+*
+* @brief Header file containing the vendor specific telemetry class driver of the USB device, which
+*        streams small application records to the host over a bulk IN endpoint.
+*
+* Public Functions:
+*       - bool USB_Telemetry_Write(void const* record, uint8_t size)
+*       - void USB_Telemetry_Flush(void)
+*
+* @note
+*       Each record is framed as a byte with the size of the payload, a byte with a sequence number
+*       and the payload itself. The records are packed back to back into full bulk packets, a
+*       record may span several packets, so the host reads the endpoint as a byte stream. The
+*       sequence number increases by one per record, also for the records dropped because the
+*       buffer was full, so the host can detect the losses.
+*/
+
+#ifndef USB_TELEMETRY_CLASS_H
+#define USB_TELEMETRY_CLASS_H
+
+#include "usb_class.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/** @brief Size of the ring buffer for the framed records, it must be a power of two */
+#define USB_TELEMETRY_BUFFER_SIZE           4096
+/** @brief Maximum size of the data queued to the endpoint at once */
+#define USB_TELEMETRY_MAX_TRANSFER_SIZE     1024
+/** @brief Amount of pending bytes which makes the records be sent without waiting the deadline */
+#define USB_TELEMETRY_FLUSH_THRESHOLD       512
+/** @brief Maximum time in frames (ms) a record waits in the buffer before being sent */
+#define USB_TELEMETRY_FLUSH_DEADLINE        10
+/** @brief Size of the framing added to each record (size and sequence number) */
+#define USB_TELEMETRY_RECORD_HEADER_SIZE    2
+
+/***************************************************************************************************/
+/*                                       Exported Variables                                        */
+/***************************************************************************************************/
+
+extern const USB_Class_Driver_t USB_Telemetry_class;
+
+/***************************************************************************************************/
+/*                                       APIs Supported                                            */
+/***************************************************************************************************/
+
+/**
+ * @brief Function for queueing a record to be sent to the host.
+ * @param[in] record is a pointer to the payload of the record.
+ * @param[in] size is the size of the payload in bytes.
+ * @return true if the record has been queued, false if it has been dropped because the buffer is
+ *         full or the device is not configured.
+ */
+bool USB_Telemetry_Write(void const* record, uint8_t size);
+
+/**
+ * @brief Function for sending the queued records without waiting for the threshold or the deadline.
+ * @return void
+ */
+void USB_Telemetry_Flush(void);
+
+#endif /* USB_TELEMETRY_CLASS_H */
@@ -42,6 +42,17 @@ defined in linker script */
 .word _sbss
 /* end address for the .bss section. defined in linker script */
 .word _ebss
+/* start address for the initialization values of the .ccmdata section.
+defined in linker script */
+.word _siccmdata
+/* start address for the .ccmdata section. defined in linker script */
+.word _sccmdata
+/* end address for the .ccmdata section. defined in linker script */
+.word _eccmdata
+/* start address for the .ccmbss section. defined in linker script */
+.word _sccmbss
+/* end address for the .ccmbss section. defined in linker script */
+.word _eccmbss
 
 /**
  * @brief  This is the code that gets called when the processor first
@@ -61,7 +72,8 @@ Reset_Handler:
 /* Call the clock system intitialization function.*/
   bl  SystemInit
 
-/* Copy the data segment initializers from flash to SRAM */
+/* Copy the data segment initializers from flash to SRAM, the .RamFunc functions are copied with
+   them */
   ldr r0, =_sdata
   ldr r1, =_edata
   ldr r2, =_sidata
@@ -78,6 +90,23 @@ LoopCopyDataInit:
   cmp r4, r1
   bcc CopyDataInit
 
+/* Copy the ccmdata segment initializers from flash to CCM RAM */
+  ldr r0, =_sccmdata
+  ldr r1, =_eccmdata
+  ldr r2, =_siccmdata
+  movs r3, #0
+  b LoopCopyCcmDataInit
+
+CopyCcmDataInit:
+  ldr r4, [r2, r3]
+  str r4, [r0, r3]
+  adds r3, r3, #4
+
+LoopCopyCcmDataInit:
+  adds r4, r0, r3
+  cmp r4, r1
+  bcc CopyCcmDataInit
+
 /* Zero fill the bss segment. */
   ldr r2, =_sbss
   ldr r4, =_ebss
@@ -92,6 +121,20 @@ LoopFillZerobss:
   cmp r2, r4
   bcc FillZerobss
 
+/* Zero fill the ccmbss segment. */
+  ldr r2, =_sccmbss
+  ldr r4, =_eccmbss
+  movs r3, #0
+  b LoopFillZeroCcmbss
+
+FillZeroCcmbss:
+  str  r3, [r2]
+  adds r2, r2, #4
+
+LoopFillZeroCcmbss:
+  cmp r2, r4
+  bcc FillZeroCcmbss
+
 /* Call static constructors */
   bl __libc_init_array
 /* Call the application's entry point.*/
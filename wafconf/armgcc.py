@@ -6,6 +6,8 @@ def find_armgcc(conf):
     conf.find_program("arm-none-eabi-ar", var="AR")
     conf.find_program("arm-none-eabi-gcc", var="LINK_CC")
     conf.find_program("arm-none-eabi-objcopy", var="OBJCOPY")
+    conf.find_program("arm-none-eabi-size", var="SIZE")
+    conf.find_program("arm-none-eabi-objdump", var="OBJDUMP")
     conf.find_program("arm-none-eabi-gcc", var="CC")
     conf.find_program("arm-none-eabi-g++", var="CXX")
     conf.find_program("arm-none-eabi-c++", var="LINK_CXX")
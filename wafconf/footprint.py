@@ -0,0 +1,43 @@
+import glob
+import os
+from waflib import Logs, Task, TaskGen
+import footprint_report
+
+# Report the footprint of the application after linking it and check the budgets of its modules
+
+class footprint(Task.Task):
+    "Reports the flash and RAM used by the modules of the application"
+    color = 'BLUE'
+
+    def run(self):
+        elf = self.inputs[0].abspath()
+        map_path = os.path.splitext(elf)[0] + '.map'
+        stack_usage = sorted(glob.glob(os.path.join(self.generator.bld.variant_dir, '**', '*.su'),
+                                       recursive=True))
+        try:
+            summary, lines, errors = footprint_report.report(elf, map_path, stack_usage,
+                                                             self.modules, self.budgets)
+        except (footprint_report.FootprintError, OSError) as error:
+            self.err_msg = str(error)
+            return 1
+        self.outputs[0].write('\n'.join(lines) + '\n')
+        Logs.info('\n'.join(['Footprint of the %s variant (bytes):' % self.generator.bld.variant] +
+                            summary))
+        if errors:
+            self.err_msg = 'Footprint budget exceeded:\n    ' + '\n    '.join(errors)
+            return 1
+        return 0
+
+    def sig_vars(self):
+        "The modules and the budgets are dependencies too"
+        Task.Task.sig_vars(self)
+        self.m.update(repr((self.modules, sorted(self.budgets.items()))).encode())
+
+@TaskGen.feature('footprint')
+@TaskGen.before_method('process_source')
+def process_footprint(self):
+    task = self.create_task('footprint', self.to_nodes(self.source),
+                            self.path.find_or_declare(self.target))
+    task.modules = getattr(self, 'modules', [])
+    task.budgets = getattr(self, 'budgets', {})
+    self.source = []
@@ -0,0 +1,359 @@
+#! /usr/bin/env python
+# encoding: utf-8
+
+"""
+Footprint report of the application.
+
+It reads the map file written by the linker, the section headers and the symbol table of the ELF
+and the stack usage files written by the compiler with -fstack-usage, and reports:
+    - The flash and RAM used by each module, a module being a set of sources or input sections
+      (e.g. the descriptors are the constant data of usb_device_descriptor.h, which is included
+      by the middleware), and the largest stack frame of its functions.
+    - The flash, RAM and stack frame of each symbol.
+    - The space reserved by the linker script (heap, stack and alignment), which belongs to no
+      module.
+
+The flash of a section is its load image, so the initialized data and the functions copied to RAM
+at startup use both flash and RAM. The build fails if a module or the total exceeds its budget.
+
+Usage: footprint_report.py <elf> <map> [<stack usage file>]...
+"""
+
+import bisect
+import fnmatch
+import os
+import re
+import struct
+import sys
+
+# Sources of the objects in the map file: the build appends the index of the task generator
+OBJECT_SOURCE = re.compile(r'^(.*\.(?:c|s|S))\.\d+\.o$')
+HEX = r'0x[0-9a-fA-F]+'
+OUTPUT_SECTION = re.compile(r'^(\.\S+)?\s+(%s)\s+(%s)(?:\s+load address (%s))?\s*$' %
+                            (HEX, HEX, HEX))
+INPUT_SECTION = re.compile(r'^ (\.\S+|COMMON)?\s+(%s)\s+(%s)\s+(\S.*)$' % (HEX, HEX))
+REGION = re.compile(r'^(\S+)\s+(%s)\s+(%s)' % (HEX, HEX))
+SHT_SYMTAB = 2
+SHT_NOBITS = 8
+SHN_ABS = 0xFFF1
+STT_FUNC = 2
+EM_ARM = 40
+
+
+class FootprintError(Exception):
+    pass
+
+
+class Section:
+    def __init__(self, name, address, size, source, output):
+        self.name = name
+        self.address = address
+        self.size = size
+        self.source = source
+        self.output = output
+
+
+class Symbol:
+    def __init__(self, module, name, flash, ram, frame):
+        self.module = module
+        self.name = name
+        self.flash = flash
+        self.ram = ram
+        self.frame = frame
+
+
+def object_source(path):
+    """Returns the source of an object of the map file, or the archive member of a library."""
+    match = OBJECT_SOURCE.match(path)
+    if match:
+        return match.group(1)
+    return os.path.basename(path)
+
+
+def read_map(map_path):
+    """Returns the memory regions, the output sections and the input sections of a map file."""
+    with open(map_path) as f:
+        lines = f.read().splitlines()
+
+    regions = {}
+    outputs = []
+    inputs = []
+    stage = None
+    pending = None
+    for line in lines:
+        if line.startswith('Memory Configuration'):
+            stage = 'regions'
+            continue
+        if line.startswith('Linker script and memory map'):
+            stage = 'sections'
+            continue
+        if stage == 'regions':
+            match = REGION.match(line)
+            if match and match.group(1) != '*default*':
+                regions[match.group(1)] = (int(match.group(2), 16), int(match.group(3), 16))
+            continue
+        if stage != 'sections':
+            continue
+
+        # Long section names are written alone, their address and size go in the next line
+        if pending:
+            line = pending + line
+            pending = None
+        if re.match(r'^ ?\.\S+$', line) or line == ' COMMON':
+            pending = line
+            continue
+
+        match = OUTPUT_SECTION.match(line)
+        if match and match.group(1):
+            load = match.group(4)
+            outputs.append({
+                'name': match.group(1),
+                'address': int(match.group(2), 16),
+                'size': int(match.group(3), 16),
+                'load': int(load, 16) if load else int(match.group(2), 16),
+            })
+            continue
+        match = INPUT_SECTION.match(line)
+        if match and match.group(1) and outputs and int(match.group(3), 16):
+            inputs.append(Section(match.group(1), int(match.group(2), 16),
+                                  int(match.group(3), 16), object_source(match.group(4).strip()),
+                                  outputs[-1]))
+
+    if not regions:
+        raise FootprintError('%s: no memory configuration' % map_path)
+    return regions, outputs, inputs
+
+
+class Elf:
+    """Sections and symbols of a little endian ELF file: the names of the sections without contents
+    in the file (.bss and NOLOAD sections), the address, size and name of the sized symbols sorted
+    by address, the functions by address and the values of the absolute symbols (e.g. the sizes
+    set by the linker script)."""
+
+    def __init__(self, path):
+        with open(path, 'rb') as f:
+            self.data = data = f.read()
+        if data[:4] != b'\x7fELF' or data[5] != 1:
+            raise FootprintError('%s: not a little endian ELF file' % path)
+        if data[4] == 1:
+            header, section, symbol = '<HHIIIIIHHHHHH', '<IIIIIIIIII', '<IIIBBH'
+        else:
+            header, section, symbol = '<HHIQQQIHHHHHH', '<IIQQQQIIQQ', '<IBBHQQ'
+        fields = struct.unpack_from(header, data, 16)
+        self.machine, shoff = fields[1], fields[5]
+        shentsize, shnum, shstrndx = fields[10:]
+
+        self.headers = [struct.unpack_from(section, data, shoff + i*shentsize)
+                        for i in range(shnum)]
+        self.nobits = set()
+        self.symbols = []
+        self.functions = {}
+        self.absolute = {}
+        for section_name, kind, _, _, offset, section_size, link, _, _, entsize in self.headers:
+            if kind == SHT_NOBITS:
+                self.nobits.add(self.string(shstrndx, section_name))
+            if kind != SHT_SYMTAB:
+                continue
+            for index in range(section_size//entsize):
+                entry = struct.unpack_from(symbol, data, offset + index*entsize)
+                if data[4] == 1:
+                    name, value, size, info, _, shndx = entry
+                else:
+                    name, info, _, shndx, value, size = entry
+                name = self.string(link, name)
+                if shndx == SHN_ABS:
+                    self.absolute[name] = value
+                # Undefined, absolute and common symbols are not placed in a section
+                if not size or shndx == 0 or shndx >= 0xFF00:
+                    continue
+                if (info & 0xF) == STT_FUNC:
+                    # The address of a Thumb function has the bit 0 set
+                    if self.machine == EM_ARM:
+                        value &= ~1
+                    self.functions.setdefault(value, name)
+                self.symbols.append((value, size, name))
+        self.symbols.sort()
+
+    def string(self, table, offset):
+        start = self.headers[table][4] + offset
+        return self.data[start:self.data.index(b'\0', start)].decode()
+
+    def function_at(self, pointer):
+        "Returns the name of the function of a pointer, or None"
+        return self.functions.get(pointer & ~1 if self.machine == EM_ARM else pointer)
+
+    def pointers(self, address, size):
+        """Returns the pointers in the contents of the file from an address, e.g. the initial values
+        of a table of functions."""
+        width, pointer = (4, 'I') if self.data[4] == 1 else (8, 'Q')
+        for _, kind, _, section_address, offset, section_size, _, _, _, _ in self.headers:
+            if kind != SHT_NOBITS and section_address <= address and \
+               address + size <= section_address + section_size:
+                start = offset + address - section_address
+                return list(struct.unpack_from('<%d%s' % (size//width, pointer), self.data, start))
+        return []
+
+
+def read_stack_usage(paths):
+    """Returns the stack frame of each function of the stack usage files, as a dictionary indexed
+    by (source file name, function) and by function alone, with the frame size and its qualifier
+    (static, dynamic or bounded)."""
+    frames = {}
+    for path in paths:
+        with open(path) as f:
+            for line in f:
+                fields = line.rstrip('\n').split('\t')
+                if len(fields) != 3:
+                    continue
+                location, size, qualifier = fields
+                source = os.path.basename(location.split(':')[0])
+                function = location.split(':')[-1]
+                frame = (int(size), qualifier.split(',')[0])
+                for key in ((source, function), function):
+                    if key not in frames or frames[key][0] < frame[0]:
+                        frames[key] = frame
+    return frames
+
+
+def module_of(section, modules):
+    """Returns the first module whose patterns match the source or the name of a section."""
+    for module, patterns in modules:
+        for pattern in patterns:
+            if fnmatch.fnmatch(section.source, pattern) or fnmatch.fnmatch(section.name, pattern):
+                return module
+    return 'other'
+
+
+def region_of(address, regions):
+    for name, (origin, length) in regions.items():
+        if origin <= address < origin + length:
+            return name
+    return None
+
+
+def analyse(regions, outputs, inputs, nobits, symbols, frames, modules):
+    """Returns the symbols of the input sections and the footprint of each module."""
+    flash = [name for name in regions if 'FLASH' in name.upper()]
+
+    def usage(output, size):
+        "Flash and RAM used by the bytes of an output section"
+        vma = region_of(output['address'], regions)
+        lma = None if output['name'] in nobits else region_of(output['load'], regions)
+        return (size if lma in flash else 0, size if vma and vma not in flash else 0)
+
+    addresses = [symbol[0] for symbol in symbols]
+    result = []
+    for section in inputs:
+        # Sections out of the memory regions, e.g. the debug information, are not loaded
+        if usage(section.output, section.size) == (0, 0):
+            continue
+        module = module_of(section, modules)
+        source = os.path.basename(section.source)
+        covered = 0
+        first = bisect.bisect_left(addresses, section.address)
+        last = bisect.bisect_left(addresses, section.address + section.size)
+        previous = None
+        for address, size, name in symbols[first:last]:
+            # Aliases (e.g. the default interrupt handlers) are counted once
+            if address == previous:
+                continue
+            previous = address
+            size = min(size, section.address + section.size - address)
+            frame = frames.get((source, name), frames.get(name))
+            result.append(Symbol(module, name, *usage(section.output, size), frame=frame))
+            covered += size
+        if covered < section.size:
+            # Literals, padding and sections without symbols (e.g. the startup code)
+            result.append(Symbol(module, '[%s %s]' % (section.source, section.name),
+                                 *usage(section.output, section.size - covered), frame=None))
+
+    footprint = {}
+    for symbol in result:
+        entry = footprint.setdefault(symbol.module, {'flash': 0, 'ram': 0, 'frame': None})
+        entry['flash'] += symbol.flash
+        entry['ram'] += symbol.ram
+        if symbol.frame and (not entry['frame'] or entry['frame'][0] < symbol.frame[0]):
+            entry['frame'] = (symbol.frame[0], symbol.name)
+
+    total = {'flash': 0, 'ram': 0, 'frame': None}
+    for output in outputs:
+        section_flash, section_ram = usage(output, output['size'])
+        total['flash'] += section_flash
+        total['ram'] += section_ram
+    footprint['reserved'] = {
+        'flash': total['flash'] - sum(entry['flash'] for entry in footprint.values()),
+        'ram': total['ram'] - sum(entry['ram'] for entry in footprint.values()),
+        'frame': None,
+    }
+    footprint['total'] = total
+    return result, footprint
+
+
+def check_budgets(footprint, budgets):
+    """Returns the errors of the modules exceeding their budgets."""
+    errors = []
+    for module, budget in sorted(budgets.items()):
+        entry = footprint.get(module, {'flash': 0, 'ram': 0})
+        for memory in ('flash', 'ram'):
+            if memory in budget and entry[memory] > budget[memory]:
+                errors.append('%s uses %d bytes of %s, over its budget of %d bytes' %
+                              (module, entry[memory], memory, budget[memory]))
+    return errors
+
+
+def format_summary(footprint, modules, budgets):
+    order = [module for module, _ in modules] + ['other', 'reserved', 'total']
+    lines = ['    %-12s %8s %8s %8s %8s  %s' %
+             ('module', 'flash', 'budget', 'ram', 'budget', 'largest frame')]
+    for module in order:
+        entry = footprint.get(module, {'flash': 0, 'ram': 0, 'frame': None})
+        budget = budgets.get(module, {})
+        frame = '%d %s' % entry['frame'] if entry['frame'] else '-'
+        lines.append('    %-12s %8d %8s %8d %8s  %s' %
+                     (module, entry['flash'], budget.get('flash', '-'), entry['ram'],
+                      budget.get('ram', '-'), frame))
+    return lines
+
+
+def format_symbols(symbols, modules):
+    order = [module for module, _ in modules] + ['other']
+    lines = ['    %-12s %8s %8s %8s  %s' % ('module', 'flash', 'ram', 'frame', 'symbol')]
+    for symbol in sorted(symbols, key=lambda s: (order.index(s.module), -s.flash - s.ram, s.name)):
+        frame = '%d%s' % (symbol.frame[0], '' if symbol.frame[1] == 'static' else '+') \
+            if symbol.frame else '-'
+        lines.append('    %-12s %8d %8d %8s  %s' %
+                     (symbol.module, symbol.flash, symbol.ram, frame, symbol.name))
+    return lines
+
+
+def report(elf_path, map_path, stack_usage_paths, modules, budgets):
+    """Returns the summary, the full report and the budget errors of an application."""
+    regions, outputs, inputs = read_map(map_path)
+    elf = Elf(elf_path)
+    frames = read_stack_usage(stack_usage_paths)
+    result, footprint = analyse(regions, outputs, inputs, elf.nobits, elf.symbols, frames,
+                                modules)
+    summary = format_summary(footprint, modules, budgets)
+    lines = ['Footprint of %s (bytes)' % os.path.basename(elf_path), ''] + summary + ['']
+    if not stack_usage_paths:
+        lines += ['No stack usage files, the frames are unknown', '']
+    lines += ['Symbols (frame sizes marked with + are dynamic or bounded)', '']
+    lines += format_symbols(result, modules)
+    return summary, lines, check_budgets(footprint, budgets)
+
+
+def main(argv):
+    if len(argv) < 3:
+        sys.stderr.write(__doc__)
+        return 2
+    try:
+        _, lines, _ = report(argv[1], argv[2], argv[3:], [], {})
+    except FootprintError as error:
+        sys.stderr.write('%s\n' % error)
+        return 1
+    sys.stdout.write('\n'.join(lines) + '\n')
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
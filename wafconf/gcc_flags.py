@@ -3,20 +3,37 @@ from waflib.Configure import conf
 # Add misc gcc flags
 
 common_flags = [
-    "-g",
-    "-O0",
     "-ffunction-sections",
     "-fdata-sections",
+    "-fstack-usage",
     "-Wall",
     "-Wunused-parameter",
 ]
 
+# Optimization flags of the build variants, the release ones are also passed to the linker for the
+# link time optimization
+variant_flags = {
+    "debug": ["-g", "-O0"],
+    "release": ["-g", "-O2", "-flto"],
+    "release_size": ["-g", "-Os", "-flto"],
+}
+
 @conf
 def add_gcc_flags(conf):
-    conf.env.CPPFLAGS = common_flags
-    conf.env.ASFLAGS = common_flags
+    conf.env.CPPFLAGS = list(common_flags)
+    conf.env.ASFLAGS = list(common_flags)
     conf.env.CFLAGS = ["-std=c11"]
     conf.env.CXXFLAGS = ["-std=c++17"]
 
+@conf
+def add_variant_flags(conf, variant):
+    # append_value copies the lists shared with the parent environment before modifying them
+    flags = variant_flags[variant]
+    conf.env.append_value("CPPFLAGS", flags)
+    conf.env.append_value("ASFLAGS", [flag for flag in flags if flag != "-flto"])
+    if "-flto" in flags:
+        # The code is generated at link time, so the stack usage is written then too
+        conf.env.append_value("LINKFLAGS", flags + ["-fstack-usage"])
+
 def configure(conf):
-    conf.add_gcc_flags()
\ No newline at end of file
+    conf.add_gcc_flags()
@@ -0,0 +1,41 @@
+import ast
+from waflib import Task, TaskGen
+import hid_report_compiler
+
+# Compile the HID report specification into a header at build time
+
+class hid_report(Task.Task):
+    "Compiles a HID report specification into a C header"
+    color   = 'BLUE'
+    ext_out = ['.h'] # generated before compiling the c files
+
+    def run(self):
+        try:
+            hid_report_compiler.generate(self.inputs[0].abspath(), self.outputs[0].abspath(),
+                                         [node.abspath() for node in self.include_nodes])
+        except hid_report_compiler.SpecError as error:
+            self.err_msg = '%s: %s' % (self.inputs[0].relpath(), error)
+            return 1
+        return 0
+
+    def scan(self):
+        "The usage headers read by the specification and the compiler are dependencies too"
+        spec = ast.literal_eval(self.inputs[0].read())
+        nodes = [self.compiler_node]
+        for header in spec.get('headers', []):
+            for directory in self.include_nodes:
+                node = directory.find_resource(header)
+                if node:
+                    nodes.append(node)
+                    break
+        return (nodes, [])
+
+@TaskGen.feature('hid_report')
+@TaskGen.before_method('process_source')
+def process_hid_report(self):
+    includes = [self.path.find_dir(path) for path in self.to_list(getattr(self, 'includes', []))]
+    task = self.create_task('hid_report', self.to_nodes(self.source),
+                            self.path.find_or_declare(self.target))
+    task.include_nodes = [node for node in includes if node]
+    task.compiler_node = self.bld.root.find_resource(hid_report_compiler.__file__)
+    self.source = []
@@ -0,0 +1,452 @@
+#! /usr/bin/env python
+# encoding: utf-8
+
+"""
+Compiler of HID report specifications.
+
+It reads a declarative specification of the reports of a HID interface (a Python literal, see
+src/mid/usb/usb_hid_reports.hidspec) and writes a C header with:
+    - The constants and the report IDs of the specification.
+    - A packed structure per report, with static asserts of its size and of the offset of each
+      member, so the layout seen by the C code is the one declared in the report descriptor.
+    - The table USB_HID_INPUT_REPORTS(REPORT) with the input reports.
+    - The bytes of the report descriptor (USB_HID_REPORT_DESCRIPTOR).
+
+The reports are checked to be tightly packed: every field wider than a byte starts on a byte
+boundary and every report ends on one, otherwise the compilation fails.
+
+Usage: hid_report_compiler.py <spec> <header> [-I<include dir>]...
+"""
+
+import ast
+import os
+import re
+import sys
+
+# Tags of the items of the report descriptor (type bits included)
+MAIN_INPUT = 0x80
+MAIN_OUTPUT = 0x90
+MAIN_COLLECTION = 0xA0
+MAIN_FEATURE = 0xB0
+MAIN_END_COLLECTION = 0xC0
+GLOBAL_USAGE_PAGE = 0x04
+GLOBAL_LOGICAL_MINIMUM = 0x14
+GLOBAL_LOGICAL_MAXIMUM = 0x24
+GLOBAL_UNIT_EXPONENT = 0x54
+GLOBAL_UNIT = 0x64
+GLOBAL_REPORT_SIZE = 0x74
+GLOBAL_REPORT_ID = 0x84
+GLOBAL_REPORT_COUNT = 0x94
+LOCAL_USAGE = 0x08
+LOCAL_USAGE_MINIMUM = 0x18
+LOCAL_USAGE_MAXIMUM = 0x28
+
+MAIN_ITEMS = {'input': MAIN_INPUT, 'output': MAIN_OUTPUT, 'feature': MAIN_FEATURE}
+COLLECTIONS = {'physical': 0x00, 'application': 0x01, 'logical': 0x02}
+FLAGS = {
+    'constant': 0x01,
+    'variable': 0x02,
+    'relative': 0x04,
+    'wrap': 0x08,
+    'nonlinear': 0x10,
+    'no_preferred': 0x20,
+    'null_state': 0x40,
+    'volatile': 0x80,
+}
+ITEM_NAMES = {
+    MAIN_INPUT: 'Input',
+    MAIN_OUTPUT: 'Output',
+    MAIN_COLLECTION: 'Collection',
+    MAIN_FEATURE: 'Feature',
+    MAIN_END_COLLECTION: 'End Collection',
+    GLOBAL_USAGE_PAGE: 'Usage Page',
+    GLOBAL_LOGICAL_MINIMUM: 'Logical Minimum',
+    GLOBAL_LOGICAL_MAXIMUM: 'Logical Maximum',
+    GLOBAL_UNIT_EXPONENT: 'Unit Exponent',
+    GLOBAL_UNIT: 'Unit',
+    GLOBAL_REPORT_SIZE: 'Report Size',
+    GLOBAL_REPORT_ID: 'Report ID',
+    GLOBAL_REPORT_COUNT: 'Report Count',
+    LOCAL_USAGE: 'Usage',
+    LOCAL_USAGE_MINIMUM: 'Usage Minimum',
+    LOCAL_USAGE_MAXIMUM: 'Usage Maximum',
+}
+SIGNED_ITEMS = (GLOBAL_LOGICAL_MINIMUM, GLOBAL_LOGICAL_MAXIMUM)
+
+
+class SpecError(Exception):
+    pass
+
+
+def read_header_constants(header, include_dirs):
+    """Returns the numeric #define of a header found in the include directories."""
+    for directory in include_dirs:
+        path = os.path.join(directory, header)
+        if os.path.isfile(path):
+            break
+    else:
+        raise SpecError('header %s not found' % header)
+
+    constants = {}
+    pattern = re.compile(r'^\s*#define\s+(\w+)\s+(0[xX][0-9a-fA-F]+|\d+)\b')
+    with open(path) as f:
+        for line in f:
+            match = pattern.match(line)
+            if match:
+                constants[match.group(1)] = int(match.group(2), 0)
+    return constants
+
+
+def evaluate(value, names):
+    """Evaluates a value of the specification: a number, a name or a simple expression of them."""
+    if isinstance(value, int):
+        return value
+
+    def walk(node):
+        if isinstance(node, ast.Expression):
+            return walk(node.body)
+        if isinstance(node, ast.Constant) and isinstance(node.value, int):
+            return node.value
+        if isinstance(node, ast.Name):
+            if node.id not in names:
+                raise SpecError('unknown name %s' % node.id)
+            return names[node.id]
+        if isinstance(node, ast.UnaryOp) and isinstance(node.op, ast.USub):
+            return -walk(node.operand)
+        if isinstance(node, ast.BinOp):
+            operations = {
+                ast.Add: lambda a, b: a + b,
+                ast.Sub: lambda a, b: a - b,
+                ast.Mult: lambda a, b: a * b,
+                ast.FloorDiv: lambda a, b: a // b,
+                ast.BitOr: lambda a, b: a | b,
+                ast.LShift: lambda a, b: a << b,
+            }
+            if type(node.op) in operations:
+                return operations[type(node.op)](walk(node.left), walk(node.right))
+        raise SpecError('unsupported expression %r' % value)
+
+    return walk(ast.parse(str(value), mode='eval'))
+
+
+def encode_item(tag, value):
+    """Returns the bytes of a short item, with the smallest data size holding the value."""
+    if value is None:
+        return [tag]
+    if tag in SIGNED_ITEMS:
+        if -0x80 <= value <= 0x7F:
+            size = 1
+        elif -0x8000 <= value <= 0x7FFF:
+            size = 2
+        else:
+            size = 4
+    else:
+        if value < 0:
+            raise SpecError('%s can not be negative' % ITEM_NAMES[tag])
+        size = 1 if value <= 0xFF else 2 if value <= 0xFFFF else 4
+    data = (value & ((1 << (8*size)) - 1)).to_bytes(size, 'little')
+    return [tag | {1: 1, 2: 2, 4: 3}[size]] + list(data)
+
+
+class Member(object):
+    """Member of the C structure of a report."""
+    def __init__(self, name, ctype, offset, count=1):
+        self.name = name
+        self.ctype = ctype
+        self.offset = offset
+        self.count = count
+
+
+class Report(object):
+    """Report being compiled, it holds the layout of its structure."""
+    def __init__(self, spec, kind, type_name):
+        self.spec = spec
+        self.kind = kind
+        self.type_name = type_name
+        self.members = []
+        self.bits = 0
+        self.pending_bits = 0
+        self.pending_name = None
+        self.reserved = 0
+
+    def add_bits(self, name, bits):
+        """Adds a field narrower than a byte, packed with the next ones into uint8_t members."""
+        if self.pending_bits == 0:
+            self.pending_start = self.bits
+        if self.pending_name is None:
+            self.pending_name = name
+        self.pending_bits += bits
+        self.bits += bits
+        if self.pending_bits % 8 == 0:
+            self.flush()
+
+    def flush(self):
+        if self.pending_bits == 0:
+            return
+        if self.pending_bits % 8 != 0:
+            raise SpecError('report %s: fields from bit %d to bit %d do not fill whole bytes' %
+                            (self.spec['name'], self.pending_start, self.bits - 1))
+        name = self.pending_name
+        if name is None:
+            name = 'reserved%s' % (self.reserved if self.reserved else '')
+            self.reserved += 1
+        self.members.append(Member(name, 'uint8_t', self.pending_start//8, self.pending_bits//8))
+        self.pending_bits = 0
+        self.pending_name = None
+
+    def add_member(self, member_name, ctype, bits, count=1):
+        self.flush()
+        if self.bits % 8 != 0:
+            raise SpecError('report %s: member %s does not start on a byte boundary' %
+                            (self.spec['name'], member_name))
+        self.members.append(Member(member_name, ctype, self.bits//8, count))
+        self.bits += bits*count
+
+
+class Compiler(object):
+    def __init__(self, spec, names):
+        self.spec = spec
+        self.names = names
+        self.descriptor = []
+        # The units are 0 until a field sets them
+        self.globals = {GLOBAL_UNIT_EXPONENT: 0, GLOBAL_UNIT: 0}
+        self.comments = {}
+        self.depth = 0
+        self.structures = []
+        self.reports = []
+
+    def value(self, value):
+        return evaluate(value, self.names)
+
+    def item(self, tag, value=None, comment=None):
+        if tag == MAIN_END_COLLECTION:
+            self.depth -= 1
+        text = ITEM_NAMES[tag]
+        if value is not None:
+            text += ' (%s)' % (comment if comment is not None else value)
+        self.descriptor.append((encode_item(tag, value), '    '*self.depth + text))
+        if tag == MAIN_COLLECTION:
+            self.depth += 1
+
+    def global_item(self, tag, value, comment=None):
+        """Global items are only emitted when their value changes, they keep it for next items."""
+        if self.globals.get(tag) != value:
+            self.globals[tag] = value
+            self.comments[tag] = comment
+            self.item(tag, value, comment)
+
+    def usages(self, spec):
+        if 'usage_page' in spec:
+            self.global_item(GLOBAL_USAGE_PAGE, self.value(spec['usage_page']), spec['usage_page'])
+        for usage in spec.get('usages', [spec['usage']] if 'usage' in spec else []):
+            self.item(LOCAL_USAGE, self.value(usage), usage)
+        if 'usage_minimum' in spec:
+            self.item(LOCAL_USAGE_MINIMUM, self.value(spec['usage_minimum']), spec['usage_minimum'])
+            self.item(LOCAL_USAGE_MAXIMUM, self.value(spec['usage_maximum']), spec['usage_maximum'])
+
+    def field(self, report, spec):
+        if 'collection' in spec:
+            self.collection(report, spec)
+            return
+
+        size = self.value(spec['size'])
+        count = self.value(spec.get('count', 1))
+        flags = 0
+        if 'padding' in spec:
+            flags = FLAGS['constant']
+        else:
+            for flag in spec.get('flags', ['variable']):
+                flags |= FLAGS[flag]
+            self.usages(spec)
+            minimum, maximum = (self.value(v) for v in spec['logical'])
+            self.global_item(GLOBAL_LOGICAL_MINIMUM, minimum, spec['logical'][0])
+            self.global_item(GLOBAL_LOGICAL_MAXIMUM, maximum, spec['logical'][1])
+            unit_exponent = self.value(spec.get('unit_exponent', 0))
+            unit = self.value(spec.get('unit', 0))
+            self.global_item(GLOBAL_UNIT_EXPONENT, unit_exponent, '0x%X' % unit_exponent)
+            self.global_item(GLOBAL_UNIT, unit, '0x%X' % unit)
+        self.global_item(GLOBAL_REPORT_SIZE, size)
+        self.global_item(GLOBAL_REPORT_COUNT, count)
+        self.item(MAIN_ITEMS[report.kind], flags, '0x%02X' % flags)
+
+        # Layout of the members in the structure
+        name = spec.get('name')
+        if ('padding' in spec) or (size not in (8, 16, 32)):
+            report.add_bits(name, size*count)
+            return
+        ctype = ('int%d_t' if minimum < 0 else 'uint%d_t') % size
+        if isinstance(name, list):
+            if len(name) != count:
+                raise SpecError('report %s: %d names for %d fields' %
+                                (report.spec['name'], len(name), count))
+            for member_name in name:
+                report.add_member(member_name, ctype, size)
+        else:
+            report.add_member(name, ctype, size, count)
+
+    def collection(self, report, spec):
+        repeat = self.value(spec.get('repeat', 1))
+        if 'type' in spec:
+            # The fields of the collection are a structure of their own
+            inner = Report(dict(spec, name=spec['type']), report.kind, spec['type'])
+            # The items of the first repetition are copied, so they can not rely on the global state
+            # left by the previous items, not even on the usage page of the collection
+            usage_page = self.globals.get(GLOBAL_USAGE_PAGE)
+            usage_page_comment = self.comments.get(GLOBAL_USAGE_PAGE)
+            self.globals = {}
+            start = len(self.descriptor)
+            if 'usage_page' not in spec and usage_page is not None:
+                self.global_item(GLOBAL_USAGE_PAGE, usage_page, usage_page_comment)
+            self.usages(spec)
+            self.item(MAIN_COLLECTION, COLLECTIONS[spec['collection']], spec['collection'])
+            for field in spec['fields']:
+                self.field(inner, field)
+            self.item(MAIN_END_COLLECTION)
+            inner.flush()
+            if inner.bits % 8 != 0:
+                raise SpecError('collection %s does not end on a byte boundary' % spec['type'])
+            # The global state is the same after each repetition
+            self.descriptor.extend(self.descriptor[start:]*(repeat - 1))
+            if not any(s.type_name == inner.type_name for s in self.structures):
+                self.structures.append(inner)
+            report.add_member(spec['name'], inner.type_name, inner.bits, repeat)
+        else:
+            if repeat != 1:
+                raise SpecError('a repeated collection needs a type')
+            self.usages(spec)
+            self.item(MAIN_COLLECTION, COLLECTIONS[spec['collection']], spec['collection'])
+            for field in spec['fields']:
+                self.field(report, field)
+            self.item(MAIN_END_COLLECTION)
+
+    def compile(self):
+        for application in self.spec['collections']:
+            self.usages(application)
+            self.item(MAIN_COLLECTION, COLLECTIONS['application'], 'application')
+            for report_spec in application['reports']:
+                type_name = 'HID_%s_Report_t' % '_'.join(
+                    part.capitalize() for part in report_spec['name'].split('_'))
+                report = Report(report_spec, report_spec.get('kind', 'input'), type_name)
+                report_id = self.value(report_spec['id'])
+                if not 0 < report_id <= 0xFF:
+                    raise SpecError('report %s: invalid report ID' % report_spec['name'])
+                # An ID can be shared by reports of different kinds, not by two of the same kind
+                for other in self.reports:
+                    if (other.kind == report.kind) and (self.value(other.spec['id']) == report_id):
+                        raise SpecError('reports %s and %s: same %s report ID %d' %
+                                        (other.spec['name'], report_spec['name'], report.kind,
+                                         report_id))
+                self.global_item(GLOBAL_REPORT_ID, report_id)
+                report.add_member('report_id', 'uint8_t', 8)
+                for field in report_spec['fields']:
+                    self.field(report, field)
+                report.flush()
+                if report.bits % 8 != 0:
+                    raise SpecError('report %s does not end on a byte boundary' %
+                                    report_spec['name'])
+                self.structures.append(report)
+                self.reports.append(report)
+            self.item(MAIN_END_COLLECTION)
+
+
+def c_member(member):
+    if member.count == 1:
+        return '    %s %s;' % (member.ctype, member.name)
+    return '    %s %s[%d];' % (member.ctype, member.name, member.count)
+
+
+def generate(spec_path, header_path, include_dirs):
+    with open(spec_path) as f:
+        spec = ast.literal_eval(f.read())
+
+    names = {}
+    for header in spec.get('headers', []):
+        names.update(read_header_constants(header, include_dirs))
+    constants = []
+    for name, value in spec.get('constants', []):
+        names[name] = evaluate(value, names)
+        constants.append(name)
+    report_ids = []
+    for application in spec['collections']:
+        for report in application['reports']:
+            name = 'USB_HID_REPORT_ID_%s' % report['name'].upper()
+            names[name] = evaluate(report['id'], names)
+            report_ids.append(name)
+
+    compiler = Compiler(spec, names)
+    compiler.compile()
+
+    guard = os.path.basename(header_path).upper().replace('.', '_')
+    lines = [
+        '/*',
+        ' * Generated by wafconf/hid_report_compiler.py from %s, do not edit.' %
+        os.path.basename(spec_path),
+        ' */',
+        '',
+        '#ifndef %s' % guard,
+        '#define %s' % guard,
+        '',
+        '#include <stdint.h>',
+        '#include <stddef.h>',
+        '',
+    ]
+    for name in constants + report_ids:
+        value = names[name]
+        lines.append(('#define %-40s 0x%02X' if name.startswith('HID_') else '#define %-40s %d') %
+                     (name, value))
+    lines.append('')
+
+    for structure in compiler.structures:
+        lines.append('typedef struct')
+        lines.append('{')
+        lines += [c_member(member) for member in structure.members]
+        lines.append('} __attribute__((__packed__)) %s;' % structure.type_name)
+        lines.append('_Static_assert(sizeof(%s) == %d, "Size of %s");' %
+                     (structure.type_name, structure.bits//8, structure.type_name))
+        for member in structure.members:
+            lines.append('_Static_assert(offsetof(%s, %s) == %d, "Offset of %s.%s");' %
+                         (structure.type_name, member.name, member.offset,
+                          structure.type_name, member.name))
+        lines.append('')
+
+    entries = ['REPORT(%s, USB_HID_REPORT_ID_%s, %s, %d)' %
+               (report.spec['name'], report.spec['name'].upper(), report.type_name,
+                compiler.value(report.spec.get('priority', 0)))
+               for report in compiler.reports if report.kind == 'input']
+    lines.append('#define USB_HID_INPUT_REPORTS(REPORT) \\')
+    lines += ['    %s%s' % (entry, ' \\' if i < len(entries) - 1 else '')
+              for i, entry in enumerate(entries)]
+    lines.append('')
+
+    size = sum(len(item) for item, _ in compiler.descriptor)
+    lines.append('#define USB_HID_REPORT_DESCRIPTOR_SIZE %d' % size)
+    lines.append('#define USB_HID_REPORT_DESCRIPTOR \\')
+    for i, (item, comment) in enumerate(compiler.descriptor):
+        data = ''.join('0x%02X, ' % byte for byte in item)
+        if i == len(compiler.descriptor) - 1:
+            data = data.rstrip(', ')
+        lines.append('    %-32s/* %-52s */%s' %
+                     (data, comment, ' \\' if i < len(compiler.descriptor) - 1 else ''))
+    lines.append('')
+    lines.append('#endif /* %s */' % guard)
+
+    with open(header_path, 'w') as f:
+        f.write('\n'.join(lines) + '\n')
+
+
+def main(argv):
+    include_dirs = [arg[2:] for arg in argv[1:] if arg.startswith('-I')]
+    paths = [arg for arg in argv[1:] if not arg.startswith('-I')]
+    if len(paths) != 2:
+        sys.stderr.write(__doc__)
+        return 2
+    try:
+        generate(paths[0], paths[1], include_dirs)
+    except SpecError as error:
+        sys.stderr.write('%s: %s\n' % (paths[0], error))
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
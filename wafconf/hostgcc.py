@@ -0,0 +1,27 @@
+from waflib.Configure import conf
+
+# Configure the gcc of the development machine, for the programs which run on the host (e.g. the
+# benchmark of the USB stack). It is optional, the firmware is built without it
+
+@conf
+def find_hostgcc(conf):
+    conf.find_program("gcc", var="CC", mandatory=False)
+    if not conf.env.CC:
+        return
+    conf.find_program("gcc", var="LINK_CC")
+    conf.env.CC_NAME = "gcc"
+
+    conf.get_cc_version(conf.env.CC, gcc=True)
+
+def configure(conf):
+    conf.load("c_config")
+    conf.find_hostgcc()
+    conf.cc_add_flags()
+    conf.link_add_flags()
+
+    conf.env.CC_TGT_F    = ['-c', '-o']
+    conf.env.CCLNK_TGT_F = ['-o']
+    conf.env.CPPPATH_ST  = '-I%s'
+    conf.env.DEFINES_ST  = '-D%s'
+    conf.env.LIB_ST      = '-l%s' # template for adding libs
+    conf.env.LIBPATH_ST  = '-L%s' # template for adding libpaths
@@ -0,0 +1,283 @@
+#! /usr/bin/env python
+# encoding: utf-8
+
+"""
+Worst-case stack usage of the entry points of the application.
+
+It builds the call graph of the application from the disassembly of the ELF (objdump -d), takes
+the stack frame of each function from the stack usage files written by the compiler with
+-fstack-usage, or from the prologue of the functions compiled without it (the C library), and
+reports for each entry point the deepest path of the call graph and its stack usage.
+
+The targets of the calls through function pointers can not be read from the disassembly, they
+are given as rules (caller, callees). The first rule whose pattern matches the caller (its name,
+or <source file>:<name> for the functions with stack usage) gives its callees: the functions
+matching a pattern, the functions stored in the tables matching a pattern prefixed with & (e.g.
+&USB_driver) and not the functions matching a pattern prefixed with !. The bound of an entry point
+is incomplete if it reaches an indirect call without a rule, a function without a known frame, a
+frame of dynamic size or a recursion, which are reported.
+
+Usage: stack_report.py <elf> [--objdump=<objdump>] [--entry=<function>]... [<stack usage file>]...
+"""
+
+import fnmatch
+import re
+import subprocess
+import sys
+from footprint_report import Elf, FootprintError, EM_ARM, read_stack_usage
+
+FUNCTION = re.compile(r'^([0-9a-f]+) <(.+)>:$')
+TARGET = re.compile(r'<([^>+]+)(\+0x[0-9a-f]+)?>')
+REGISTER = re.compile(r'^(r\d+|sb|sl|fp|ip)$')
+CONDITIONS = ('eq', 'ne', 'cs', 'hs', 'cc', 'lo', 'mi', 'pl', 'vs', 'vc', 'hi', 'ls', 'ge', 'lt',
+              'gt', 'le', 'al')
+CALLS = ('bl', 'blx', 'call', 'callq')
+BRANCHES = ['b', 'jmp'] + ['b' + condition for condition in CONDITIONS]
+# The instructions of the prologue of a function and the number of them which are looked at
+PROLOGUE_LENGTH = 8
+
+
+class Function:
+    def __init__(self, name):
+        self.name = name
+        self.calls = set()
+        self.indirect = False
+        self.instructions = []
+
+
+def read_disassembly(objdump, elf_path, elf):
+    """Returns the functions of the disassembly of an ELF, with the functions they call directly,
+    whether they call through function pointers and the instructions of their prologue."""
+    try:
+        output = subprocess.check_output(objdump + ['-d', elf_path], universal_newlines=True)
+    except (OSError, subprocess.CalledProcessError) as error:
+        raise FootprintError('%s: %s' % (elf_path, error))
+
+    names = set(elf.functions.values())
+    functions = {}
+    function = None
+    for line in output.splitlines():
+        match = FUNCTION.match(line)
+        if match:
+            # The labels inside a function (e.g. the loops of the startup code) are not functions
+            if elf.function_at(int(match.group(1), 16)) == match.group(2) or function is None:
+                function = functions.setdefault(match.group(2), Function(match.group(2)))
+            continue
+        fields = line.split('\t')
+        if function is None or len(fields) < 3 or not fields[0].strip().endswith(':'):
+            continue
+        instruction = '\t'.join(fields[2:]).split(None, 1)
+        mnemonic = instruction[0].split('.')[0]
+        operands = instruction[1].strip() if len(instruction) > 1 else ''
+        if len(function.instructions) < PROLOGUE_LENGTH:
+            function.instructions.append((mnemonic, operands))
+
+        target = TARGET.search(operands)
+        if mnemonic in CALLS or mnemonic == 'bx':
+            if target and not target.group(2):
+                function.calls.add(target.group(1))
+            elif REGISTER.match(operands) or operands.startswith('*'):
+                function.indirect = True
+        elif mnemonic in BRANCHES and target and not target.group(2) and \
+                target.group(1) != function.name and target.group(1) in names:
+            # Tail call
+            function.calls.add(target.group(1))
+    return functions
+
+
+def registers(operands):
+    "Returns the number of registers of a register list, e.g. {r4-r7, lr}"
+    match = re.search(r'\{(.*)\}', operands)
+    if not match:
+        return 0, 'r'
+    count = 0
+    kind = 'r'
+    for item in match.group(1).split(','):
+        bounds = re.findall(r'([a-z]+)(\d+)', item)
+        if len(bounds) == 2:
+            count += int(bounds[1][1]) - int(bounds[0][1]) + 1
+        else:
+            count += 1
+        if bounds:
+            kind = bounds[0][0]
+    return count, kind
+
+
+def prologue_frame(function):
+    """Returns the stack frame set up by the prologue of an ARM function and whether its size is
+    dynamic: the registers pushed and the space reserved by subtracting from the stack pointer."""
+    frame = 0
+    dynamic = False
+    for mnemonic, operands in function.instructions:
+        if mnemonic == 'push' or (mnemonic == 'stmdb' and operands.startswith('sp!')):
+            frame += 4*registers(operands)[0]
+        elif mnemonic == 'vpush' or (mnemonic == 'vstmdb' and operands.startswith('sp!')):
+            count, kind = registers(operands)
+            frame += (8 if kind == 'd' else 4)*count
+        elif mnemonic in ('sub', 'subw') and operands.startswith('sp,'):
+            immediate = re.search(r'#(\d+)', operands)
+            if immediate:
+                frame += int(immediate.group(1))
+            else:
+                dynamic = True
+        elif mnemonic in CALLS or mnemonic in BRANCHES:
+            break
+    return frame, dynamic
+
+
+def resolve_indirect_calls(functions, rules, elf, sources):
+    """Adds the callees given by the rules to the functions calling through function pointers,
+    and returns the functions without a rule."""
+    tables = {}
+    for address, size, name in elf.symbols:
+        targets = [elf.function_at(pointer) for pointer in elf.pointers(address, size)]
+        tables[name] = set(target for target in targets if target)
+
+    unresolved = []
+    for function in functions.values():
+        if not function.indirect:
+            continue
+        caller = '%s:%s' % (sources.get(function.name, ''), function.name)
+        for callers, callees in rules:
+            if fnmatch.fnmatch(function.name, callers) or fnmatch.fnmatch(caller, callers):
+                break
+        else:
+            unresolved.append(function.name)
+            continue
+        targets = set()
+        for pattern in callees:
+            if pattern.startswith('&'):
+                for table in fnmatch.filter(tables, pattern[1:]):
+                    targets |= tables[table]
+            elif pattern.startswith('!'):
+                targets -= set(fnmatch.filter(targets, pattern[1:]))
+            else:
+                targets |= set(fnmatch.filter(functions, pattern))
+        function.calls |= targets
+    return sorted(unresolved)
+
+
+def analyse(functions, frames, elf, entry_points, unresolved):
+    """Returns for each entry point its stack usage, its deepest path with the frame of each
+    function, and the issues making its bound incomplete."""
+    known = {}
+    issues = dict((name, ['indirect call without a rule']) for name in unresolved)
+    for name, function in functions.items():
+        # Calls from flash to RAM functions go through veneers, which use no stack
+        veneer = re.match(r'^__(.+)_veneer$', name)
+        if veneer:
+            function.calls.add(veneer.group(1))
+            known[name] = 0
+        elif name in frames:
+            known[name] = frames[name][0]
+            if frames[name][1] == 'dynamic':
+                issues.setdefault(name, []).append('dynamic frame')
+        elif elf.machine == EM_ARM:
+            known[name], dynamic = prologue_frame(function)
+            if dynamic:
+                issues.setdefault(name, []).append('dynamic frame')
+        else:
+            issues.setdefault(name, []).append('unknown frame')
+            known[name] = 0
+
+    memo = {}
+    active = set()
+    recursion = set()
+
+    def deepest(name):
+        "Returns the stack usage of the deepest path from a function and the path"
+        if name in memo:
+            return memo[name]
+        if name in active:
+            recursion.add(name)
+            return 0, []
+        if name not in functions:
+            issues[name] = ['not found']
+            return 0, [(name, 0)]
+        active.add(name)
+        usage, path = 0, []
+        for callee in sorted(functions[name].calls):
+            callee_usage, callee_path = deepest(callee)
+            if callee_usage > usage or not path:
+                usage, path = callee_usage, callee_path
+        active.discard(name)
+        memo[name] = (known[name] + usage, [(name, known[name])] + path)
+        return memo[name]
+
+    def reachable(name):
+        seen = set()
+        pending = [name]
+        while pending:
+            current = pending.pop()
+            if current in seen:
+                continue
+            seen.add(current)
+            if current in functions:
+                pending += functions[current].calls
+        return seen
+
+    result = []
+    for entry in entry_points:
+        usage, path = deepest(entry)
+        reached = reachable(entry)
+        entry_issues = ['%s: %s' % (name, issue) for name in sorted(reached & set(issues))
+                        for issue in issues[name]]
+        entry_issues += ['%s: recursion, counted once' % name
+                         for name in sorted(reached & recursion)]
+        result.append((entry, usage, path, entry_issues))
+    return result
+
+
+def report(elf_path, objdump, stack_usage_paths, entry_points, indirect_calls):
+    """Returns the summary, the full report and the warnings of the stack usage of the entry
+    points of an application."""
+    elf = Elf(elf_path)
+    functions = read_disassembly(objdump, elf_path, elf)
+    frames = read_stack_usage(stack_usage_paths)
+    sources = dict((key[1], key[0]) for key in frames if isinstance(key, tuple))
+    frames = dict((key, value) for key, value in frames.items() if not isinstance(key, tuple))
+    unresolved = resolve_indirect_calls(functions, indirect_calls, elf, sources)
+    result = analyse(functions, frames, elf, entry_points, unresolved)
+
+    stack_size = elf.absolute.get('_Min_Stack_Size')
+    summary = ['    %-24s %8s  %s' % ('entry point', 'usage', 'bound')]
+    warnings = []
+    for entry, usage, _, issues in result:
+        summary.append('    %-24s %8d  %s' %
+                       (entry, usage, 'incomplete' if issues else 'complete'))
+        if stack_size is not None and usage > stack_size:
+            warnings.append('%s uses %d bytes of stack, over the %d bytes reserved by the linker '
+                            'script' % (entry, usage, stack_size))
+    if stack_size is not None:
+        summary.append('    %-24s %8d' % ('reserved', stack_size))
+
+    lines = ['Worst-case stack usage of %s (bytes)' % elf_path, ''] + summary + ['']
+    for entry, usage, path, issues in result:
+        lines.append('Deepest path of %s:' % entry)
+        lines += ['    %8d  %s' % (frame, name) for name, frame in path]
+        if issues:
+            lines.append('Incomplete bound:')
+            lines += ['    %s' % issue for issue in issues]
+        lines.append('')
+    return summary, lines, warnings
+
+
+def main(argv):
+    objdump = [arg[10:] for arg in argv[1:] if arg.startswith('--objdump=')]
+    entry_points = [arg[8:] for arg in argv[1:] if arg.startswith('--entry=')]
+    paths = [arg for arg in argv[1:] if not arg.startswith('--')]
+    if not paths:
+        sys.stderr.write(__doc__)
+        return 2
+    try:
+        _, lines, warnings = report(paths[0], objdump[:1] or ['arm-none-eabi-objdump'], paths[1:],
+                                    entry_points or ['Reset_Handler'], [])
+    except FootprintError as error:
+        sys.stderr.write('%s\n' % error)
+        return 1
+    sys.stdout.write('\n'.join(lines + warnings) + '\n')
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
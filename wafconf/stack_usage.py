@@ -0,0 +1,42 @@
+import glob
+import os
+from waflib import Logs, Task, TaskGen
+import footprint_report
+import stack_report
+
+# Report the worst-case stack usage of the entry points of the application after linking it
+
+class stack_usage(Task.Task):
+    "Reports the worst-case stack usage of the entry points of the application"
+    color = 'BLUE'
+
+    def run(self):
+        elf = self.inputs[0].abspath()
+        stack_usage = sorted(glob.glob(os.path.join(self.generator.bld.variant_dir, '**', '*.su'),
+                                       recursive=True))
+        try:
+            summary, lines, warnings = stack_report.report(elf, self.env.OBJDUMP, stack_usage,
+                                                           self.entry_points, self.indirect_calls)
+        except (footprint_report.FootprintError, OSError) as error:
+            self.err_msg = str(error)
+            return 1
+        self.outputs[0].write('\n'.join(lines) + '\n')
+        Logs.info('\n'.join(['Worst-case stack usage of the %s variant (bytes):' %
+                             self.generator.bld.variant] + summary))
+        for warning in warnings:
+            Logs.warn(warning)
+        return 0
+
+    def sig_vars(self):
+        "The entry points and the indirect calls are dependencies too"
+        Task.Task.sig_vars(self)
+        self.m.update(repr((self.entry_points, self.indirect_calls)).encode())
+
+@TaskGen.feature('stack_usage')
+@TaskGen.before_method('process_source')
+def process_stack_usage(self):
+    task = self.create_task('stack_usage', self.to_nodes(self.source),
+                            self.path.find_or_declare(self.target))
+    task.entry_points = getattr(self, 'entry_points', [])
+    task.indirect_calls = getattr(self, 'indirect_calls', [])
+    self.source = []